@@ -0,0 +1,73 @@
+#!/bin/sh
+# Measure end-to-end throughput of wcecabinfo for every output mode.
+#
+# Generates a corpus of COUNT synthetic inputs with dist/gen000: bare .000
+# files and stored, MSZIP and LZX cabinets, small, mid-sized and large, some
+# with Japanese strings. Then runs wcecabinfo over the corpus in text, JSON,
+# compact JSON, NDJSON and .reg mode and prints files and megabytes of input
+# per second. The best of RUNS runs is reported for every mode.
+#
+# Usage: bench/bench.sh [-n COUNT] [-r RUNS] [-J THREADS]
+
+set -e
+
+COUNT=400
+RUNS=3
+JOBS=1
+WCECABINFO=${WCECABINFO:-dist/wcecabinfo}
+GEN000=${GEN000:-dist/gen000}
+
+while getopts "n:r:J:" opt; do
+    case $opt in
+        n) COUNT=$OPTARG ;;
+        r) RUNS=$OPTARG ;;
+        J) JOBS=$OPTARG ;;
+        *) exit 1 ;;
+    esac
+done
+
+CORPUS=$(mktemp -d)
+trap 'rm -rf "$CORPUS"' EXIT
+
+# Cycle through the containers and three shapes, seeded by the index so the
+# corpus is the same on every run
+i=0
+while [ $i -lt "$COUNT" ]; do
+    case $((i % 4)) in
+        0) container=none ext=000 ;;
+        1) container=stored ext=cab ;;
+        2) container=mszip ext=cab ;;
+        3) container=lzx ext=cab ;;
+    esac
+    case $((i / 4 % 3)) in
+        0) shape="-s 32 -d 8 -f 40 -H 4 -k 20 -l 4" ;;
+        1) shape="-s 256 -d 64 -f 500 -H 16 -k 250 -l 20 -j 25" ;;
+        2) shape="-s 2048 -d 512 -f 8000 -H 64 -k 4000 -l 200 -p 65536" ;;
+    esac
+    dir="$CORPUS/$((i % 16))"
+    mkdir -p "$dir"
+    # shellcheck disable=SC2086
+    "$GEN000" $shape -c $container -r $i "$dir/$i.$ext"
+    i=$((i + 1))
+done
+
+bytes=$(find "$CORPUS" -type f -exec cat {} + | wc -c)
+echo "corpus: $COUNT files, $bytes bytes, $JOBS threads"
+printf "%-12s %10s %10s %10s\n" mode seconds files/s MB/s
+
+for mode in text -j "-j -C" -n -r; do
+    args=$mode
+    [ "$mode" = text ] && args=
+    best=
+    run=0
+    while [ $run -lt "$RUNS" ]; do
+        start=$(date +%s.%N)
+        # shellcheck disable=SC2086
+        "$WCECABINFO" -J "$JOBS" $args "$CORPUS" >/dev/null
+        end=$(date +%s.%N)
+        best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 != "" && $3 < t) t = $3; printf "%.4f", t }')
+        run=$((run + 1))
+    done
+    printf "%-12s " "$mode"
+    echo "$best $COUNT $bytes" | awk '{ printf "%10.4f %10.0f %10.1f\n", $1, $2 / $1, $3 / $1 / 1e6 }'
+done
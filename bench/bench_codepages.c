@@ -0,0 +1,230 @@
+/*
+ * Benchmark for the built-in codepage transcoders.
+ *
+ * For every codepage, builds a set of short strings like the names and paths
+ * of a .000 file, mixing ASCII runs with characters of the codepage, and
+ * converts them to UTF-8 once with iconv and once with the built-in tables.
+ * The iconv descriptor is opened once and reused, as the library did before
+ * the built-in tables, so only the conversion itself is compared.
+ *
+ * The built-in tables follow Windows, which decodes a few characters
+ * differently from glibc's iconv. These known differences are left out of the
+ * strings. Any other string that iconv decodes differently is counted as a
+ * mismatch, and mismatches make the benchmark fail, so it doubles as a check
+ * of the tables.
+ *
+ * The last row, under its own header, compares the old byte loop that checks
+ * whether a string needs converting with the vectorized scan, on printable
+ * ASCII strings. It has nothing to do with iconv.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <iconv.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/codepage.h"
+#include "bench.h"
+
+#define NUM_STRINGS 20000
+#define MAX_STRING 64
+#define ROUNDS 20
+
+/** Characters from first to last, the lead byte in the high byte for double
+ * byte characters, that Windows and glibc's iconv decode differently */
+typedef struct known_difference {
+    codepage cp;
+    uint16_t first;
+    uint16_t last;
+} known_difference;
+
+static const known_difference KNOWN_DIFFERENCES[] = {
+    /* Bytes that Windows maps to U+0080 and the private use area, and iconv rejects */
+    {CODEPAGE_932, 0x80, 0x80},
+    {CODEPAGE_932, 0xA0, 0xA0},
+    {CODEPAGE_932, 0xFD, 0xFF},
+    /* ETEN extensions, which Windows maps to kana and symbols, and iconv to the private use area */
+    {CODEPAGE_950, 0xC6A1, 0xC7FE},
+};
+
+/**
+ * @brief Check whether a character is a known difference from iconv
+ */
+static bool is_known_difference(codepage cp, uint16_t c) {
+    for (size_t i = 0; i < sizeof(KNOWN_DIFFERENCES) / sizeof(KNOWN_DIFFERENCES[0]); i++) {
+        if (KNOWN_DIFFERENCES[i].cp == cp && c >= KNOWN_DIFFERENCES[i].first && c <= KNOWN_DIFFERENCES[i].last) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Collect the byte sequences of all characters of a codepage from
+ * 0x80, except the known differences from iconv
+ *
+ * @param cp codepage
+ * @param chars array to fill with sequences of 1 or 2 bytes, 0 terminated
+ * @return int number of sequences
+ */
+static int collect_chars(codepage cp, uint8_t (*chars)[3]) {
+    const codepage_table *table = &CODEPAGE_TABLES[cp];
+    int num = 0;
+
+    for (int byte = 0x80; byte < 0x100; byte++) {
+        uint16_t c = table->high[byte - 0x80];
+        if (c == CODEPAGE_LEAD) {
+            const uint16_t *row = table->dbcs + (table->rows[byte - 0x80] - 1) * CODEPAGE_ROW_SIZE;
+            for (int trail = CODEPAGE_TRAIL_MIN; trail <= CODEPAGE_TRAIL_MAX; trail++) {
+                if (row[trail - CODEPAGE_TRAIL_MIN] && !is_known_difference(cp, byte << 8 | trail)) {
+                    chars[num][0] = byte;
+                    chars[num][1] = trail;
+                    chars[num++][2] = 0;
+                }
+            }
+        } else if (c && !is_known_difference(cp, byte)) {
+            chars[num][0] = byte;
+            chars[num++][1] = 0;
+        }
+    }
+    return num;
+}
+
+/**
+ * @brief Build a string of ASCII runs and characters of a codepage
+ */
+static size_t build_string(char *str, uint8_t (*chars)[3], int numchars) {
+    size_t len = 0;
+    size_t target = 8 + rand() % (MAX_STRING - 8);
+
+    while (len + 2 < target) {
+        if (rand() % 2) {
+            int run = 1 + rand() % 6;
+            for (int i = 0; i < run && len + 2 < target; i++) {
+                str[len++] = 'a' + rand() % 26;
+            }
+        } else {
+            const uint8_t *c = chars[rand() % numchars];
+            for (int i = 0; c[i]; i++) {
+                str[len++] = c[i];
+            }
+        }
+    }
+    str[len] = '\0';
+    return len;
+}
+
+/**
+ * @brief The check for strings that need converting, as it was before the
+ * vectorized scan
+ */
+static int is_ascii_loop(const char *str) {
+    int str_is_ascii = 1;
+    for (const uint8_t *ptr = (const uint8_t *)str; *ptr; ptr++) {
+        if (*ptr < 0x20 || *ptr > 0x7F) {
+            str_is_ascii = 0;
+        }
+    }
+    return str_is_ascii;
+}
+
+int main() {
+    static uint8_t chars[65536][3];
+    char (*strings)[MAX_STRING + 1] = malloc(NUM_STRINGS * sizeof(*strings));
+    size_t *lengths = malloc(NUM_STRINGS * sizeof(size_t));
+    char iconv_out[MAX_STRING * 4], builtin_out[MAX_STRING * 3];
+    int failed = 0;
+
+    printf("%-8s %12s %12s %12s %12s %10s\n", "codepage", "iconv ns", "builtin ns", "iconv MB/s", "builtin MB/s", "mismatch");
+    for (int cp = 0; cp < NUM_CODEPAGES; cp++) {
+        int numchars = collect_chars(cp, chars);
+        size_t bytes = 0;
+        for (int i = 0; i < NUM_STRINGS; i++) {
+            lengths[i] = build_string(strings[i], chars, numchars);
+            bytes += lengths[i];
+        }
+
+        iconv_t icv = iconv_open("UTF-8", codepage_name(cp));
+        if (icv == (iconv_t)-1) {
+            printf("%-8s iconv does not support this codepage\n", codepage_name(cp));
+            continue;
+        }
+
+        int mismatches = 0;
+        double start = bench_now();
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = 0; i < NUM_STRINGS; i++) {
+                char *in = strings[i], *out = iconv_out;
+                size_t in_len = lengths[i], out_len = sizeof(iconv_out);
+                iconv(icv, NULL, NULL, NULL, NULL);
+                iconv(icv, &in, &in_len, &out, &out_len);
+            }
+        }
+        double iconv_time = bench_now() - start;
+
+        start = bench_now();
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = 0; i < NUM_STRINGS; i++) {
+                codepage_to_utf8(cp, strings[i], lengths[i], builtin_out);
+            }
+        }
+        double builtin_time = bench_now() - start;
+
+        for (int i = 0; i < NUM_STRINGS; i++) {
+            char *in = strings[i], *out = iconv_out;
+            size_t in_len = lengths[i], out_len = sizeof(iconv_out);
+            iconv(icv, NULL, NULL, NULL, NULL);
+            ssize_t iconv_len = iconv(icv, &in, &in_len, &out, &out_len) == (size_t)-1 ? -1 : out - iconv_out;
+            ssize_t builtin_len = codepage_to_utf8(cp, strings[i], lengths[i], builtin_out);
+            if (iconv_len != builtin_len || (builtin_len > 0 && memcmp(iconv_out, builtin_out, builtin_len))) {
+                mismatches++;
+            }
+        }
+        iconv_close(icv);
+
+        double conversions = (double)NUM_STRINGS * ROUNDS;
+        printf("%-8s %12.1f %12.1f %12.1f %12.1f %10d\n", codepage_name(cp), iconv_time * 1e9 / conversions, builtin_time * 1e9 / conversions,
+               bytes * ROUNDS / iconv_time / 1e6, bytes * ROUNDS / builtin_time / 1e6, mismatches);
+        failed |= mismatches != 0;
+    }
+
+    /* Printable ASCII strings, which are not converted at all */
+    size_t bytes = 0;
+    for (int i = 0; i < NUM_STRINGS; i++) {
+        lengths[i] = 8 + rand() % (MAX_STRING - 8);
+        for (size_t j = 0; j < lengths[i]; j++) {
+            strings[i][j] = 0x20 + rand() % 0x5F;
+        }
+        strings[i][lengths[i]] = '\0';
+        bytes += lengths[i];
+    }
+    int loop_ascii = 0, span_ascii = 0;
+    double start = bench_now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < NUM_STRINGS; i++) {
+            loop_ascii += is_ascii_loop(strings[i]);
+        }
+    }
+    double loop_time = bench_now() - start;
+    start = bench_now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < NUM_STRINGS; i++) {
+            size_t len = strlen(strings[i]);
+            span_ascii += codepage_ascii_span(strings[i], len) == len;
+        }
+    }
+    double span_time = bench_now() - start;
+    double checks = (double)NUM_STRINGS * ROUNDS;
+    printf("\n%-8s %12s %12s %12s %12s %10s\n", "check", "loop ns", "span ns", "loop MB/s", "span MB/s", "mismatch");
+    printf("%-8s %12.1f %12.1f %12.1f %12.1f %10d\n", "ASCII", loop_time * 1e9 / checks, span_time * 1e9 / checks, bytes * ROUNDS / loop_time / 1e6,
+           bytes * ROUNDS / span_time / 1e6, loop_ascii != span_ascii);
+    failed |= loop_ascii != span_ascii;
+
+    free(strings);
+    free(lengths);
+    if (failed) {
+        fprintf(stderr, "Mismatch between iconv and the built-in tables\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
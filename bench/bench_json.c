@@ -0,0 +1,255 @@
+/*
+ * Benchmark for the streaming JSON writer.
+ *
+ * Builds a .000 file with bench/synth.c with a few thousand files and
+ * registry entries and prints its JSON record over and over, once by building
+ * a cJSON tree and printing it with cJSON_Print(), which is how records used
+ * to be printed, and once with the streaming writer into a reused output
+ * buffer. Both the
+ * pretty and the compact output are compared. The outputs of both ways are
+ * checked to be identical.
+ *
+ * Allocations are counted by wrapping malloc, calloc and realloc at link
+ * time. cJSON allocates every node and key with the default hooks used here.
+ * The command line tool used to route these to the arena of the file, which
+ * makes them cheaper but does not make them fewer.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/cjson/cJSON.h"
+#include "../src/jsonwriter.h"
+#include "../src/readbytes.h"
+#include "../src/wcecabinfo.h"
+#include "bench.h"
+#include "synth.h"
+
+#define NUM_FILES 2000
+#define NUM_REGKEYS 1000
+#define NUM_LINKS 50
+#define ROUNDS 50
+
+/** Number of allocations made since the last reset */
+static size_t allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size) {
+    allocations++;
+    return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+/**
+ * @brief Add a Windows CE version to a cJSON object
+ */
+static void cjson_version(cJSON *object, const char *key, uint32_t major, uint32_t minor) {
+    char buffer[24];
+
+    if (!major) return;
+    cJSON *version = cJSON_CreateObject();
+    cJSON_AddItemToObject(version, "major", cJSON_CreateNumber(major));
+    cJSON_AddItemToObject(version, "minor", cJSON_CreateNumber(minor));
+    sprintf(buffer, "%u.%u", major, minor);
+    cJSON_AddItemToObject(version, "stringValue", cJSON_CreateString(buffer));
+    cJSON_AddItemToObject(object, key, version);
+}
+
+/**
+ * @brief Format binary registry data, for the cJSON record
+ */
+static char *cjson_hex(wcecab *doc, const char *prefix, const uint8_t *data, uint16_t len) {
+    char *val = wcecab_alloc(doc, strlen(prefix) + len * 3 + 1);
+    char *dst = val + sprintf(val, "%s", prefix);
+    for (uint16_t i = 0; i < len; i++) {
+        dst += sprintf(dst, i ? ",%02X" : "%02X", data[i]);
+    }
+    return val;
+}
+
+/**
+ * @brief Build the record of a file as a cJSON tree, as before the streaming
+ * writer
+ */
+static cJSON *cjson_record(wcecab *doc) {
+    const CE_CAB_000_HEADER *cabheader = wcecab_header(doc);
+    const wcecab_model *model = wcecab_get_model(doc);
+    const char *codepage = wcecab_codepage(doc);
+    const char *architecture = wcecab_architecture_name(cabheader->TargetArchitecture);
+    const char **unsupported = wcecab_unsupported(doc);
+    cJSON *cabJson = cJSON_CreateObject();
+
+    cJSON_AddStringToObject(cabJson, "appName", wcecab_to_utf8(doc, wcecab_app_name(doc)));
+    cJSON_AddStringToObject(cabJson, "provider", wcecab_to_utf8(doc, wcecab_provider(doc)));
+    cJSON_AddItemToObject(cabJson, "codepage", codepage ? cJSON_CreateString(codepage) : cJSON_CreateNull());
+    cJSON_AddItemToObject(cabJson, "architecture", architecture ? cJSON_CreateString(architecture) : cJSON_CreateNull());
+    if (*unsupported) {
+        cJSON *unsupportedJson = cJSON_CreateArray();
+        for (int i = 0; unsupported[i] && strlen(unsupported[i]); i++) {
+            cJSON_AddItemToArray(unsupportedJson, cJSON_CreateString(unsupported[i]));
+        }
+        cJSON_AddItemToObject(cabJson, "unsupported", unsupportedJson);
+    }
+    cjson_version(cabJson, "minCeVersion", cabheader->MinCEVersionMajor, cabheader->MinCEVersionMinor);
+    cjson_version(cabJson, "maxCeVersion", cabheader->MaxCEVersionMajor, cabheader->MaxCEVersionMinor);
+    if (cabheader->MinCEBuildNumber) {
+        cJSON_AddItemToObject(cabJson, "minCeBuildNumber", cJSON_CreateNumber(cabheader->MinCEBuildNumber));
+    }
+    if (cabheader->MaxCEBuildNumber) {
+        cJSON_AddItemToObject(cabJson, "maxCeBuildNumber", cJSON_CreateNumber(cabheader->MaxCEBuildNumber));
+    }
+
+    cJSON *directoriesJson = cJSON_CreateArray();
+    for (uint32_t row = 0; row < model->dirs.count; row++) {
+        cJSON *directoryItem = cJSON_CreateObject();
+        cJSON_AddItemToObject(directoryItem, "id", cJSON_CreateNumber(model->dirs.id[row]));
+        cJSON_AddItemToObject(directoryItem, "path", cJSON_CreateString(wcecab_to_utf8(doc, wcecab_dir_path(doc, model->dirs.id[row]))));
+        cJSON_AddItemToArray(directoriesJson, directoryItem);
+    }
+    cJSON_AddItemToObject(cabJson, "directories", directoriesJson);
+
+    static const struct {
+        uint32_t mask;
+        const char *key;
+    } flags[] = {{0x80000000, "isReferenceCountingSharedFile"}, {0x40000000, "ignoreCabFileDate"}, {0x20000000, "doNotOverWriteIfTargetIsNewer"},
+                 {0x10000000, "selfRegisterDll"}, {0x0400, "doNotCopyUnlessTargetExists"}, {0x0010, "overWriteTargetIfExists"},
+                 {0x0002, "doNotSkip"}, {0x0001, "warnIfSkipped"}};
+    cJSON *filesJson = cJSON_CreateArray();
+    for (uint32_t row = 0; row < model->files.count; row++) {
+        cJSON *fileItem = cJSON_CreateObject();
+        cJSON_AddItemToObject(fileItem, "id", cJSON_CreateNumber(model->files.id[row]));
+        cJSON_AddItemToObject(fileItem, "name", cJSON_CreateString(wcecab_to_utf8(doc, wcecab_model_at(model, model->files.name[row]))));
+        cJSON_AddItemToObject(fileItem, "directory", cJSON_CreateString(wcecab_to_utf8(doc, wcecab_dir_path(doc, model->files.directory[row]))));
+        for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+            if (model->files.flags[row] & flags[i].mask) {
+                cJSON_AddItemToObject(fileItem, flags[i].key, cJSON_CreateTrue());
+            }
+        }
+        cJSON_AddItemToArray(filesJson, fileItem);
+    }
+    cJSON_AddItemToObject(cabJson, "files", filesJson);
+
+    cJSON *registryEntriesJson = cJSON_CreateArray();
+    const wcecab_regkey_table *regkeys = &model->regkeys;
+    for (uint32_t row = 0; row < regkeys->count; row++) {
+        const char *name = wcecab_model_at(model, regkeys->name[row]);
+        const char *value = wcecab_model_at(model, regkeys->data[row]);
+        char *val = NULL;
+
+        cJSON *regKeyItem = cJSON_CreateObject();
+        cJSON_AddItemToObject(regKeyItem, "path", cJSON_CreateString(wcecab_to_utf8(doc, wcecab_hive_path(doc, regkeys->hive[row]))));
+        cJSON_AddItemToObject(regKeyItem, "name", *name ? cJSON_CreateString(wcecab_to_utf8(doc, name)) : cJSON_CreateNull());
+        cJSON_AddItemToObject(regKeyItem, "dataType", cJSON_CreateString(wcecab_reg_datatype(regkeys->flags[row])));
+        switch (regkeys->flags[row] & TYPE_REG_MASK) {
+            case TYPE_REG_DWORD:
+                val = wcecab_alloc(doc, 16);
+                sprintf(val, "dword:%08X", read_uint32_le((const unsigned char *)value));
+                break;
+            case TYPE_REG_SZ:
+                val = (char *)wcecab_to_utf8(doc, value);
+                break;
+            case TYPE_REG_MULTI_SZ:
+                val = cjson_hex(doc, "hex(7):", (const uint8_t *)value, regkeys->datalength[row]);
+                break;
+            case TYPE_REG_BINARY:
+                val = cjson_hex(doc, "hex:", (const uint8_t *)value, regkeys->datalength[row]);
+                break;
+        }
+        cJSON_AddItemToObject(regKeyItem, "value", cJSON_CreateString(val));
+        cJSON_AddItemToArray(registryEntriesJson, regKeyItem);
+    }
+    cJSON_AddItemToObject(cabJson, "registryEntries", registryEntriesJson);
+
+    cJSON *linksJson = cJSON_CreateArray();
+    for (uint32_t row = 0; row < model->links.count; row++) {
+        cJSON *linkItem = cJSON_CreateObject();
+        cJSON_AddBoolToObject(linkItem, "isFile", model->links.type[row]);
+        cJSON_AddNumberToObject(linkItem, "targetId", model->links.target[row]);
+        cJSON_AddStringToObject(linkItem, "linkPath", wcecab_to_utf8(doc, wcecab_link_path(doc, row)));
+        cJSON_AddStringToObject(linkItem, "targetPath",
+                                wcecab_to_utf8(doc, model->links.type[row] ? wcecab_file_path(doc, model->links.target[row])
+                                                                           : wcecab_dir_path(doc, model->links.target[row])));
+        cJSON_AddItemToArray(linksJson, linkItem);
+    }
+    cJSON_AddItemToObject(cabJson, "links", linksJson);
+    return cabJson;
+}
+
+int main() {
+    synth_options opts;
+    size_t size;
+    synth_defaults(&opts);
+    opts.files = NUM_FILES;
+    opts.regkeys = NUM_REGKEYS;
+    opts.links = NUM_LINKS;
+    uint8_t *file = synth_000(&opts, &size);
+    if (!file) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+    wcecab *doc = wcecab_new();
+    outbuf out = {0};
+
+    printf("%-8s %14s %14s %14s %14s %12s\n", "format", "cJSON rec/s", "writer rec/s", "cJSON allocs", "writer allocs", "bytes");
+    for (int pretty = 1; pretty >= 0; pretty--) {
+        double cjson_time = 0, writer_time = 0;
+        size_t cjson_allocs = 0, writer_allocs = 0;
+        size_t length = 0;
+
+        for (int round = 0; round < ROUNDS; round++) {
+            // The file is opened for each way, so both build all paths
+            if (wcecab_open_buffer(doc, file, size) != WCECAB_OK) {
+                fprintf(stderr, "%s\n", wcecab_error(doc));
+                return EXIT_FAILURE;
+            }
+            allocations = 0;
+            double start = bench_now();
+            cJSON *tree = cjson_record(doc);
+            char *printed = pretty ? cJSON_Print(tree) : cJSON_PrintUnformatted(tree);
+            cJSON_Delete(tree);
+            cjson_time += bench_now() - start;
+            cjson_allocs += allocations;
+            wcecab_close(doc);
+
+            wcecab_open_buffer(doc, file, size);
+            allocations = 0;
+            start = bench_now();
+            json_writer json;
+            out.length = 0;
+            json_init(&json, &out, pretty);
+            json_write_record(&json, doc, NULL);
+            writer_time += bench_now() - start;
+            writer_allocs += allocations;
+            wcecab_close(doc);
+
+            if (strlen(printed) != out.length || memcmp(printed, out.data, out.length)) {
+                fprintf(stderr, "Mismatch between cJSON and writer output\n");
+                return EXIT_FAILURE;
+            }
+            length = out.length;
+            free(printed);
+        }
+
+        printf("%-8s %14.1f %14.1f %14.1f %14.1f %12zu\n", pretty ? "pretty" : "compact", ROUNDS / cjson_time, ROUNDS / writer_time,
+               (double)cjson_allocs / ROUNDS, (double)writer_allocs / ROUNDS, length);
+    }
+
+    free(out.data);
+    wcecab_free(doc);
+    free(file);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,268 @@
+/*
+ * Microbenchmarks of the hot functions of the parser and the output writers.
+ *
+ * Builds a synthetic installer with bench/synth.c, a quarter of its strings in
+ * Japanese, and calls each function over and over for at least MIN_SECONDS,
+ * reporting the time per operation. Functions whose results the library
+ * caches per file, or allocates from the arena of the file, need a freshly
+ * opened file on every call. They are timed together with opening the file,
+ * and the time of opening it, plus detecting the codepage where the function
+ * needs it, is subtracted.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/codepage.h"
+#include "../src/jsonwriter.h"
+#include "../src/mscab.h"
+#include "../src/outbuf.h"
+#include "../src/regwriter.h"
+#include "../src/wcecabinfo.h"
+#include "bench.h"
+#include "synth.h"
+
+/** Shortest time each function is called for */
+#define MIN_SECONDS 0.25
+
+/** Inputs of the benchmarks */
+typedef struct bench_context {
+    /** Context to open the file with */
+    wcecab *doc;
+    /** 000 file */
+    uint8_t *file;
+    size_t size;
+    /** The 000 file in a stored, MSZIP and LZX cabinet */
+    uint8_t *cabs[3];
+    size_t cabsizes[3];
+    mscab_decoder decoder;
+    /** Output of the writers, reused */
+    outbuf out;
+} bench_context;
+
+/** Function under test, returning the number of operations it did */
+typedef size_t (*bench_fn)(bench_context *ctx);
+
+/** Result of a function, kept so that its calls are not optimized away */
+static volatile uintptr_t sink;
+
+static void open_file(bench_context *ctx) {
+    if (wcecab_open_buffer(ctx->doc, ctx->file, ctx->size) != WCECAB_OK) {
+        fprintf(stderr, "Error: %s\n", wcecab_error(ctx->doc));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static size_t extract(bench_context *ctx, int cab) {
+    mscab_file extracted;
+    if (mscab_extract_000(&ctx->decoder, ctx->cabs[cab], ctx->cabsizes[cab], &extracted) != MSCAB_OK) {
+        fprintf(stderr, "Error: extraction failed\n");
+        exit(EXIT_FAILURE);
+    }
+    sink = (uintptr_t)extracted.data;
+    return extracted.size;
+}
+
+static size_t bench_extract_stored(bench_context *ctx) {
+    return extract(ctx, 0);
+}
+
+static size_t bench_extract_mszip(bench_context *ctx) {
+    return extract(ctx, 1);
+}
+
+static size_t bench_extract_lzx(bench_context *ctx) {
+    return extract(ctx, 2);
+}
+
+static size_t bench_open(bench_context *ctx) {
+    open_file(ctx);
+    return 1;
+}
+
+static size_t bench_open_detect(bench_context *ctx) {
+    open_file(ctx);
+    sink = (uintptr_t)wcecab_codepage(ctx->doc);
+    return 1;
+}
+
+static size_t bench_string(bench_context *ctx) {
+    const wcecab_model *model = wcecab_get_model(ctx->doc);
+    for (uint32_t row = 0; row < model->strings.count; row++) {
+        sink = (uintptr_t)wcecab_string(ctx->doc, model->strings.id[row]);
+    }
+    return model->strings.count;
+}
+
+static size_t bench_ascii_span(bench_context *ctx) {
+    const wcecab_model *model = wcecab_get_model(ctx->doc);
+    for (uint32_t row = 0; row < model->strings.count; row++) {
+        sink = codepage_ascii_span(wcecab_model_at(model, model->strings.offset[row]), model->strings.length[row]);
+    }
+    return model->strings.count;
+}
+
+static size_t bench_hex_encode(bench_context *ctx) {
+    const wcecab_model *model = wcecab_get_model(ctx->doc);
+    char buffer[3 * UINT16_MAX];
+    size_t bytes = 0;
+    for (uint32_t row = 0; row < model->regkeys.count; row++) {
+        const uint8_t *data = (const uint8_t *)wcecab_model_at(model, model->regkeys.data[row]);
+        sink = (uintptr_t)hex_encode(buffer, data, model->regkeys.datalength[row]);
+        bytes += model->regkeys.datalength[row];
+    }
+    return bytes;
+}
+
+static size_t bench_file_path(bench_context *ctx) {
+    open_file(ctx);
+    const wcecab_model *model = wcecab_get_model(ctx->doc);
+    for (uint32_t row = 0; row < model->files.count; row++) {
+        sink = (uintptr_t)wcecab_file_path(ctx->doc, model->files.id[row]);
+    }
+    return model->files.count;
+}
+
+static size_t bench_hive_path(bench_context *ctx) {
+    open_file(ctx);
+    const wcecab_model *model = wcecab_get_model(ctx->doc);
+    for (uint32_t row = 0; row < model->hives.count; row++) {
+        sink = (uintptr_t)wcecab_hive_path(ctx->doc, model->hives.id[row]);
+    }
+    return model->hives.count;
+}
+
+static size_t bench_to_utf8(bench_context *ctx) {
+    bench_open_detect(ctx);
+    const wcecab_model *model = wcecab_get_model(ctx->doc);
+    for (uint32_t row = 0; row < model->strings.count; row++) {
+        sink = (uintptr_t)wcecab_to_utf8(ctx->doc, wcecab_model_at(model, model->strings.offset[row]));
+    }
+    return model->strings.count;
+}
+
+static size_t write_json(bench_context *ctx, bool pretty) {
+    json_writer json;
+    bench_open_detect(ctx);
+    ctx->out.length = 0;
+    json_init(&json, &ctx->out, pretty);
+    json_write_record(&json, ctx->doc, NULL);
+    return 1;
+}
+
+static size_t bench_json_pretty(bench_context *ctx) {
+    return write_json(ctx, true);
+}
+
+static size_t bench_json_compact(bench_context *ctx) {
+    return write_json(ctx, false);
+}
+
+static size_t bench_reg(bench_context *ctx) {
+    bench_open_detect(ctx);
+    ctx->out.length = 0;
+    reg_write_record(&ctx->out, ctx->doc, NULL);
+    return 1;
+}
+
+/** A benchmark */
+typedef struct bench {
+    const char *name;
+    bench_fn fn;
+    /** Unit of the operations */
+    const char *unit;
+    /** Function whose time is subtracted, NULL for none */
+    bench_fn baseline;
+    /** true if the document has to be open before the first call */
+    bool needs_open;
+} bench;
+
+static const bench BENCHES[] = {
+    {"extract stored", bench_extract_stored, "byte", NULL, false},
+    {"extract mszip", bench_extract_mszip, "byte", NULL, false},
+    {"extract lzx", bench_extract_lzx, "byte", NULL, false},
+    {"open", bench_open, "file", NULL, false},
+    {"detect codepage", bench_open_detect, "file", bench_open, false},
+    {"string lookup", bench_string, "string", NULL, true},
+    {"ascii span", bench_ascii_span, "string", NULL, true},
+    {"hex encode", bench_hex_encode, "byte", NULL, true},
+    {"file path", bench_file_path, "path", bench_open, false},
+    {"hive path", bench_hive_path, "path", bench_open, false},
+    {"to utf8", bench_to_utf8, "string", bench_open_detect, false},
+    {"json pretty", bench_json_pretty, "record", bench_open_detect, false},
+    {"json compact", bench_json_compact, "record", bench_open_detect, false},
+    {"reg", bench_reg, "record", bench_open_detect, false},
+};
+
+/**
+ * @brief Call a function for at least MIN_SECONDS
+ *
+ * @param ctx inputs
+ * @param fn function
+ * @param ops set to the number of operations per call
+ * @return double seconds per call
+ */
+static double measure(bench_context *ctx, bench_fn fn, size_t *ops) {
+    size_t calls = 0;
+    double start, elapsed;
+
+    // Warm up caches and buffers
+    *ops = fn(ctx);
+    start = bench_now();
+    do {
+        fn(ctx);
+        calls++;
+        elapsed = bench_now() - start;
+    } while (elapsed < MIN_SECONDS);
+    return elapsed / calls;
+}
+
+int main() {
+    bench_context ctx = {0};
+    synth_options opts;
+
+    synth_defaults(&opts);
+    opts.strings = 1024;
+    opts.dirs = 256;
+    opts.files = 4000;
+    opts.hives = 64;
+    opts.regkeys = 2000;
+    opts.links = 100;
+    opts.cp932 = 25;
+
+    ctx.file = synth_000(&opts, &ctx.size);
+    for (int i = 0; i < 3; i++) {
+        ctx.cabs[i] = ctx.file ? synth_cab(ctx.file, ctx.size, SYNTH_STORED + i, 0, opts.seed, &ctx.cabsizes[i]) : NULL;
+    }
+    if (!ctx.file || !ctx.cabs[0] || !ctx.cabs[1] || !ctx.cabs[2] || !(ctx.doc = wcecab_new())) {
+        fprintf(stderr, "Error: out of memory\n");
+        return EXIT_FAILURE;
+    }
+    mscab_decoder_init(&ctx.decoder);
+
+    printf("%u strings, %u dirs, %u files, %u hives, %u registry entries, %u links, %zu bytes\n", opts.strings, opts.dirs, opts.files, opts.hives, opts.regkeys, opts.links,
+           ctx.size);
+    printf("%-16s %12s %14s\n", "benchmark", "ns/op", "ops/s");
+    for (size_t i = 0; i < sizeof(BENCHES) / sizeof(BENCHES[0]); i++) {
+        const bench *b = &BENCHES[i];
+        size_t ops, baselineops;
+        double seconds, baseline = 0;
+
+        if (b->needs_open) open_file(&ctx);
+        seconds = measure(&ctx, b->fn, &ops);
+        if (b->baseline) baseline = measure(&ctx, b->baseline, &baselineops);
+        seconds = seconds > baseline ? seconds - baseline : 0;
+        printf("%-16s %12.2f %14.0f %ss\n", b->name, seconds * 1e9 / ops, seconds ? ops / seconds : 0, b->unit);
+    }
+
+    wcecab_free(ctx.doc);
+    mscab_decoder_free(&ctx.decoder);
+    free(ctx.out.data);
+    free(ctx.file);
+    for (int i = 0; i < 3; i++) {
+        free(ctx.cabs[i]);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/*
+ * Throughput benchmark for the in-process CAB extraction path.
+ *
+ * Extracts the .000 file from the given cabinet repeatedly and reports the
+ * throughput in MB/s of cabinet input. If cabextract is available, the same
+ * cabinet is extracted through `cabextract --pipe` for comparison.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/mscab.h"
+#include "bench.h"
+
+static void *read_file(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    void *data = malloc(*size);
+    if (fread(data, 1, *size, fp) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    return data;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: bench_mszip FILE.cab [ITERATIONS]\n");
+        return EXIT_FAILURE;
+    }
+    const char *path = argv[1];
+    int iterations = argc > 2 ? atoi(argv[2]) : 1000;
+
+    size_t size;
+    void *cab = read_file(path, &size);
+    if (!cab) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    mscab_decoder decoder;
+    mscab_decoder_init(&decoder);
+
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        mscab_file extracted;
+        int status = mscab_extract_000(&decoder, cab, size, &extracted);
+        if (status != MSCAB_OK) {
+            fprintf(stderr, "%s: %s\n", path, mscab_strerror(status));
+            return EXIT_FAILURE;
+        }
+    }
+    double elapsed = bench_now() - start;
+    mscab_decoder_free(&decoder);
+    printf("native      %8d iterations  %10.3f ms/file  %10.2f MB/s\n", iterations, elapsed * 1e3 / iterations, size * (double)iterations / elapsed / 1e6);
+
+    if (system("which cabextract > /dev/null 2>&1")) {
+        printf("cabextract  not found, skipped\n");
+        return EXIT_SUCCESS;
+    }
+
+    char *cmd = malloc(256 + strlen(path));
+    sprintf(cmd, "cabextract --pipe --filter \"*.000\" \"%s\" > /dev/null", path);
+    int external_iterations = iterations < 100 ? iterations : 100;
+    start = bench_now();
+    for (int i = 0; i < external_iterations; i++) {
+        if (system(cmd)) {
+            fprintf(stderr, "cabextract failed\n");
+            return EXIT_FAILURE;
+        }
+    }
+    elapsed = bench_now() - start;
+    printf("cabextract  %8d iterations  %10.3f ms/file  %10.2f MB/s\n", external_iterations, elapsed * 1e3 / external_iterations, size * (double)external_iterations / elapsed / 1e6);
+    free(cmd);
+    return EXIT_SUCCESS;
+}
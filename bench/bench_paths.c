@@ -0,0 +1,99 @@
+/*
+ * Microbenchmark for building paths from spec arrays.
+ *
+ * Builds .000 files with bench/synth.c whose directories have specs of 1, 8
+ * and 64 components, and times joining the components of every spec. The path builder of the
+ * library is compared with a strcat loop, which is how paths used to be
+ * built. strcat rescans the path built so far for every component, so its
+ * cost per component grows with the depth of the path, while the builder
+ * copies every component once. The strcat buffers are sized to fit the
+ * longest path, the old fixed 256 bytes would overflow at 64 components.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/wcecabinfo.h"
+#include "bench.h"
+#include "synth.h"
+
+#define NUM_STRINGS 256
+#define NUM_DIRS 4096
+/** Length of a string of bench/synth.c, "Folder00001", and a separator */
+#define COMPONENT_LENGTH 12
+#define ROUNDS 20
+
+/**
+ * @brief Join a spec with a strcat loop, as before the path builder
+ */
+static char *strcat_spec(wcecab *doc, const uint16_t *spec, uint16_t speclength, size_t bufsize) {
+    char *buf = malloc(bufsize);
+    strcpy(buf, "");
+    for (size_t i = 0; i < speclength / sizeof(uint16_t) - 1; i++) {
+        if (i) {
+            strcat(buf, "\\");
+        }
+        strcat(buf, wcecab_string(doc, spec[i]));
+    }
+    return buf;
+}
+
+int main() {
+    static const int components[] = {1, 8, 64};
+    wcecab *doc = wcecab_new();
+
+    printf("%10s %14s %14s %14s %14s\n", "components", "strcat ns", "builder ns", "strcat ns/c", "builder ns/c");
+    for (size_t c = 0; c < sizeof(components) / sizeof(components[0]); c++) {
+        synth_options opts = {.strings = NUM_STRINGS, .dirs = NUM_DIRS, .components = components[c], .seed = components[c]};
+        size_t size;
+        uint8_t *file = synth_000(&opts, &size);
+        size_t bufsize = components[c] * COMPONENT_LENGTH + 1;
+        if (!file) {
+            fprintf(stderr, "Out of memory\n");
+            return EXIT_FAILURE;
+        }
+        double strcat_time = 0, builder_time = 0;
+        size_t strcat_len = 0, builder_len = 0;
+
+        for (int round = 0; round < ROUNDS; round++) {
+            if (wcecab_open_buffer(doc, file, size) != WCECAB_OK) {
+                fprintf(stderr, "%s\n", wcecab_error(doc));
+                return EXIT_FAILURE;
+            }
+            const wcecab_model *model = wcecab_get_model(doc);
+            const wcecab_dir_table *dirs = &model->dirs;
+
+            double start = bench_now();
+            for (uint32_t row = 0; row < dirs->count; row++) {
+                const uint16_t *spec = (const uint16_t *)wcecab_model_at(model, dirs->spec[row]);
+                char *path = strcat_spec(doc, spec, dirs->speclength[row], bufsize);
+                strcat_len += strlen(path);
+                free(path);
+            }
+            strcat_time += bench_now() - start;
+
+            /* Paths are not memoized by wcecab_spec_path, every call builds one */
+            start = bench_now();
+            for (uint32_t row = 0; row < dirs->count; row++) {
+                const uint16_t *spec = (const uint16_t *)wcecab_model_at(model, dirs->spec[row]);
+                builder_len += strlen(wcecab_spec_path(doc, spec, dirs->speclength[row]));
+            }
+            builder_time += bench_now() - start;
+            wcecab_close(doc);
+        }
+
+        if (strcat_len != builder_len) {
+            fprintf(stderr, "Mismatch between strcat and builder paths\n");
+            return EXIT_FAILURE;
+        }
+        double paths = (double)NUM_DIRS * ROUNDS;
+        printf("%10d %14.1f %14.1f %14.2f %14.2f\n", components[c], strcat_time * 1e9 / paths, builder_time * 1e9 / paths, strcat_time * 1e9 / paths / components[c],
+               builder_time * 1e9 / paths / components[c]);
+        free(file);
+    }
+
+    wcecab_free(doc);
+    return EXIT_SUCCESS;
+}
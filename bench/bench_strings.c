@@ -0,0 +1,92 @@
+/*
+ * Benchmark for string id lookups.
+ *
+ * Builds .000 files with bench/synth.c with a growing number of strings, and
+ * one directory per string whose spec refers to three random string ids.
+ * Resolving the paths of all directories is timed once through the library,
+ * which looks strings up in the index built when the file is opened, and once
+ * through a linear scan of the STRINGS section for every id, which is how
+ * lookups used to work. The scan grows quadratically with the number of
+ * strings, the index linearly.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/wcecabinfo.h"
+#include "bench.h"
+#include "synth.h"
+
+#define SPEC_COMPONENTS 3
+
+/**
+ * @brief Find a string by scanning the STRINGS section
+ */
+static const char *scan_string(const uint8_t *file, uint16_t stringid) {
+    const CE_CAB_000_HEADER *header = (const CE_CAB_000_HEADER *)file;
+    const uint8_t *entry = file + header->OffsetStrings;
+    for (int i = 0; i < header->NumEntriesString; i++) {
+        const CE_CAB_000_STRING_ENTRY *stringentry = (const CE_CAB_000_STRING_ENTRY *)entry;
+        if (stringentry->Id == stringid) return &(stringentry->String);
+        entry += offsetof(CE_CAB_000_STRING_ENTRY, String) + stringentry->StringLength;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int maxstrings = argc > 1 ? atoi(argv[1]) : 16000;
+    wcecab *doc = wcecab_new();
+
+    printf("%8s %12s %12s %14s %14s\n", "strings", "scan ms", "index ms", "scan ns/id", "index ns/id");
+    for (int numstrings = 1000; numstrings <= maxstrings && numstrings <= 65535; numstrings *= 2) {
+        synth_options opts = {.strings = numstrings, .dirs = numstrings, .components = SPEC_COMPONENTS, .seed = numstrings};
+        size_t size;
+        uint8_t *file = synth_000(&opts, &size);
+        if (!file) {
+            fprintf(stderr, "Out of memory\n");
+            return EXIT_FAILURE;
+        }
+        const CE_CAB_000_HEADER *header = (const CE_CAB_000_HEADER *)file;
+        const CE_CAB_000_DIRECTORY_ENTRY *direntry;
+        wcecab_iter it;
+        size_t scanned = 0, indexed = 0;
+        double lookups = (double)numstrings * SPEC_COMPONENTS;
+
+        /* Linear scan for every component, as before the index */
+        double start = bench_now();
+        const uint8_t *entry = file + header->OffsetDirs;
+        for (int i = 0; i < header->NumEntriesDirs; i++) {
+            direntry = (const CE_CAB_000_DIRECTORY_ENTRY *)entry;
+            for (int j = 0; j < SPEC_COMPONENTS; j++) {
+                scanned += strlen(scan_string(file, (&direntry->Spec)[j]));
+            }
+            entry += offsetof(CE_CAB_000_DIRECTORY_ENTRY, Spec) + direntry->SpecLength;
+        }
+        double scan = bench_now() - start;
+
+        /* Library, including building the index when the file is opened */
+        start = bench_now();
+        if (wcecab_open_buffer(doc, file, size) != WCECAB_OK) {
+            fprintf(stderr, "%s\n", wcecab_error(doc));
+            return EXIT_FAILURE;
+        }
+        wcecab_iter_init(doc, WCECAB_SECTION_DIRS, &it);
+        while ((direntry = wcecab_iter_next(&it))) {
+            indexed += strlen(wcecab_spec_path(doc, &direntry->Spec, direntry->SpecLength)) + 1;
+        }
+        double index = bench_now() - start;
+        wcecab_close(doc);
+
+        if (indexed != scanned + numstrings * SPEC_COMPONENTS) {
+            fprintf(stderr, "Mismatch between scanned and indexed paths\n");
+            return EXIT_FAILURE;
+        }
+        printf("%8d %12.3f %12.3f %14.1f %14.1f\n", numstrings, scan * 1e3, index * 1e3, scan * 1e9 / lookups, index * 1e9 / lookups);
+        free(file);
+    }
+
+    wcecab_free(doc);
+    return EXIT_SUCCESS;
+}
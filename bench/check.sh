@@ -0,0 +1,98 @@
+#!/bin/sh
+# Check that wcecabinfo prints the same records for a .000 file and for the
+# same file extracted from a cabinet.
+#
+# Generates .000 files of several shapes with dist/gen000, some with Japanese
+# strings, empty sections or ids of missing entries, and wraps each of them in a stored, an MSZIP and
+# an LZX cabinet, some with a payload file decompressed before the .000 file.
+# The JSON, compact JSON and .reg output of every cabinet, printed once
+# without and twice with a result cache, must be identical to the output of
+# the bare file. Every output mode must also succeed for a file with ids of
+# missing entries, and print these as unknown, and the .reg output of a file
+# without registry keys must have its header. Exits with status 1 after
+# reporting all failures.
+#
+# Usage: bench/check.sh
+
+set -e
+
+WCECABINFO=${WCECABINFO:-dist/wcecabinfo}
+GEN000=${GEN000:-dist/gen000}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+failed=0
+
+# Compare the output of a mode for a file with the output for the bare file
+check() {
+    name=$1
+    file=$2
+    shift 2
+    "$WCECABINFO" "$@" "$WORK/$name.000" >"$WORK/expected" 2>&1 || true
+    for cached in no first second; do
+        if [ $cached = no ]; then
+            "$WCECABINFO" "$@" "$file" >"$WORK/actual" 2>&1 || true
+        else
+            "$WCECABINFO" --cache "$WORK/cache" "$@" "$file" >"$WORK/actual" 2>&1 || true
+        fi
+        if ! cmp -s "$WORK/expected" "$WORK/actual"; then
+            echo "FAIL: $(basename "$file") $* (cache: $cached)"
+            diff "$WORK/expected" "$WORK/actual" | head -n 10
+            failed=1
+        fi
+    done
+}
+
+seed=1
+for shape in "-s 32 -d 8 -f 40 -H 4 -k 20 -l 4" \
+    "-s 256 -d 64 -f 500 -H 16 -k 250 -l 20 -j 25" \
+    "-s 2048 -d 512 -f 8000 -H 64 -k 4000 -l 200 -j 5" \
+    "-s 0 -d 0 -f 0 -H 0 -k 0 -l 0" \
+    "-s 64 -d 16 -f 100 -H 8 -k 100 -l 20 -x 20"; do
+    name=shape$seed
+    # shellcheck disable=SC2086
+    "$GEN000" $shape -r $seed "$WORK/$name.000"
+    for container in stored mszip lzx; do
+        for payload in 0 100000; do
+            cab="$WORK/$name-$container-$payload.cab"
+            # shellcheck disable=SC2086
+            "$GEN000" $shape -r $seed -c $container -p $payload "$cab"
+            for mode in -j "-j -C" -r; do
+                # shellcheck disable=SC2086
+                check $name "$cab" $mode
+            done
+        done
+    done
+    seed=$((seed + 1))
+done
+
+# The text output has no paths, the others print the missing ones as unknown
+"$GEN000" -s 64 -d 16 -f 100 -H 8 -k 100 -l 20 -x 20 "$WORK/dangling.000"
+for mode in text -j -n -r; do
+    args=$mode
+    [ "$mode" = text ] && args=
+    status=0
+    # shellcheck disable=SC2086
+    "$WCECABINFO" $args "$WORK/dangling.000" >"$WORK/actual" 2>&1 || status=$?
+    if [ $status -ne 0 ] || { [ "$mode" != text ] && ! grep -q unknown "$WORK/actual"; }; then
+        echo "FAIL: dangling.000 $mode (status: $status)"
+        head -n 10 "$WORK/actual"
+        failed=1
+    fi
+done
+
+# A file without registry keys still prints the header of a .reg file
+"$GEN000" -s 32 -d 8 -f 40 -H 4 -k 0 -l 4 "$WORK/nokeys.000"
+status=0
+"$WCECABINFO" -r "$WORK/nokeys.000" >"$WORK/actual" 2>&1 || status=$?
+if [ $status -ne 0 ] || [ "$(head -n 1 "$WORK/actual")" != REGEDIT4 ]; then
+    echo "FAIL: nokeys.000 -r (status: $status)"
+    head -n 10 "$WORK/actual"
+    failed=1
+fi
+
+if [ $failed -ne 0 ]; then
+    exit 1
+fi
+echo "check: all outputs match"
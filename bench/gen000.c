@@ -0,0 +1,126 @@
+/*
+ * Generator of synthetic .000 and .cab files for benchmarks.
+ *
+ * Writes a 000 file with the given number of entries per section, optionally
+ * wrapped in a CAB file with a stored, MSZIP or LZX compressed folder. The
+ * same options and seed always give the same file.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "synth.h"
+
+static void usage(int status) {
+    fputs(
+        "Usage: gen000 [-s N] [-d N] [-f N] [-H N] [-k N] [-l N] [-j PERCENT] [-x PERCENT] [-c CONTAINER] [-p BYTES] [-r SEED] FILE\n"
+        "Write a synthetic .000 file, or a .cab file holding one, to FILE.\n"
+        "\n"
+        "  -s N          number of strings (default 256)\n"
+        "  -d N          number of directories (default 64)\n"
+        "  -f N          number of files (default 500)\n"
+        "  -H N          number of registry hives (default 16)\n"
+        "  -k N          number of registry entries (default 250)\n"
+        "  -l N          number of links (default 20)\n"
+        "                every section holds at most 65535 entries\n"
+        "  -j PERCENT    percentage of strings in Japanese, CP932 (default 0)\n"
+        "  -x PERCENT    percentage of files, registry entries and links referring to a missing\n"
+        "                directory, hive or file (default 0)\n"
+        "  -c CONTAINER  none, stored, mszip or lzx (default none)\n"
+        "  -p BYTES      size of a file stored in the cabinet before the .000 file (default 0)\n"
+        "  -r SEED       seed of the random contents (default 1)\n",
+        status ? stderr : stdout);
+    exit(status);
+}
+
+/**
+ * @brief Parse a number of entries
+ */
+static uint32_t parse_count(const char *arg, char option) {
+    char *end;
+    unsigned long value = strtoul(arg, &end, 10);
+    if (!*arg || *end || value > SYNTH_MAX_ENTRIES) {
+        fprintf(stderr, "Error: -%c takes a number from 0 to %d: %s\n", option, SYNTH_MAX_ENTRIES, arg);
+        exit(EXIT_FAILURE);
+    }
+    return value;
+}
+
+int main(int argc, char **argv) {
+    synth_options opts;
+    synth_compression compression = SYNTH_NONE;
+    size_t payload = 0;
+    int c;
+
+    synth_defaults(&opts);
+    while ((c = getopt(argc, argv, "s:d:f:H:k:l:j:x:c:p:r:h")) != -1) {
+        switch (c) {
+            case 's':
+                opts.strings = parse_count(optarg, c);
+                break;
+            case 'd':
+                opts.dirs = parse_count(optarg, c);
+                break;
+            case 'f':
+                opts.files = parse_count(optarg, c);
+                break;
+            case 'H':
+                opts.hives = parse_count(optarg, c);
+                break;
+            case 'k':
+                opts.regkeys = parse_count(optarg, c);
+                break;
+            case 'l':
+                opts.links = parse_count(optarg, c);
+                break;
+            case 'j':
+                opts.cp932 = atoi(optarg);
+                break;
+            case 'x':
+                opts.dangling = atoi(optarg);
+                break;
+            case 'c':
+                if (synth_compression_from_name(optarg, &compression)) {
+                    fprintf(stderr, "Error: unknown container: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                payload = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                opts.seed = strtoul(optarg, NULL, 10);
+                break;
+            case 'h':
+                usage(EXIT_SUCCESS);
+                break;
+            default:
+                usage(EXIT_FAILURE);
+        }
+    }
+    if (optind != argc - 1) usage(EXIT_FAILURE);
+
+    size_t size;
+    uint8_t *file = synth_000(&opts, &size);
+    if (file && compression != SYNTH_NONE) {
+        uint8_t *cab = synth_cab(file, size, compression, payload, opts.seed, &size);
+        free(file);
+        file = cab;
+    }
+    if (!file) {
+        fprintf(stderr, "Error: out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *out = fopen(argv[optind], "wb");
+    if (!out || fwrite(file, 1, size, out) != size || fclose(out)) {
+        fprintf(stderr, "Error: %s: %s\n", argv[optind], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    free(file);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Measure how wcecabinfo -J scales with the number of threads.
+#
+# Builds a synthetic corpus from the given sample .cab and .000 files, each
+# copied COPIES times, then times a JSON run over the corpus for every thread
+# count and prints the wall time, speedup and parallel efficiency relative to
+# a single thread. The best of RUNS runs is reported for every thread count.
+#
+# Usage: bench/scaling.sh [-n COPIES] [-r RUNS] [-t "THREADS..."] SAMPLE...
+
+set -e
+
+COPIES=200
+RUNS=3
+THREADS="1 2 4 8 16 32 64"
+WCECABINFO=${WCECABINFO:-dist/wcecabinfo}
+
+while getopts "n:r:t:" opt; do
+    case $opt in
+        n) COPIES=$OPTARG ;;
+        r) RUNS=$OPTARG ;;
+        t) THREADS=$OPTARG ;;
+        *) exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ]; then
+    echo "Usage: $0 [-n COPIES] [-r RUNS] [-t \"THREADS...\"] SAMPLE..." >&2
+    exit 1
+fi
+
+CORPUS=$(mktemp -d)
+trap 'rm -rf "$CORPUS"' EXIT
+
+# Spread the copies over subdirectories, so the directory walk is exercised too
+for sample in "$@"; do
+    name=$(basename "$sample")
+    i=0
+    while [ $i -lt "$COPIES" ]; do
+        dir="$CORPUS/$((i % 16))"
+        mkdir -p "$dir"
+        cp "$sample" "$dir/$i-$name"
+        i=$((i + 1))
+    done
+done
+
+echo "corpus: $(find "$CORPUS" -type f | wc -l) files, $(du -sh "$CORPUS" | cut -f1), $(nproc) CPUs"
+printf "%8s %10s %8s %10s\n" threads seconds speedup efficiency
+
+base=
+for threads in $THREADS; do
+    best=
+    run=0
+    while [ $run -lt "$RUNS" ]; do
+        start=$(date +%s.%N)
+        "$WCECABINFO" -J "$threads" -j "$CORPUS" >/dev/null
+        end=$(date +%s.%N)
+        best=$(echo "$start $end $best" | awk '{ t = $2 - $1; if ($3 != "" && $3 < t) t = $3; printf "%.4f", t }')
+        run=$((run + 1))
+    done
+    [ -n "$base" ] || base=$best
+    echo "$threads $best $base" | awk '{ printf "%8d %10.4f %8.2f %9.0f%%\n", $1, $2, $3 / $2, 100 * $3 / $2 / $1 }'
+done
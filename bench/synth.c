@@ -0,0 +1,760 @@
+/*
+ * Synthetic 000 and CAB files for benchmarks.
+ *
+ * The 000 files have the layout of real ones, with every section sized as
+ * requested. The CAB writer has minimal MSZIP and LZX encoders: a greedy
+ * LZ77 match finder, fixed Huffman codes for MSZIP and one verbatim block per
+ * frame for LZX. They compress worse than the Microsoft tools, but produce
+ * valid streams with literals and matches, which is what the decoders spend
+ * their time on.
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "../src/WinCECab000Header.h"
+#include "synth.h"
+
+/** Most components of a generated spec */
+#define SPEC_MAX_COMPONENTS 4
+/** Upper bound of the size of the header and its strings */
+#define HEADER_BOUND 256
+/** Upper bounds of the size of an entry of the sections without specs */
+#define STRING_BOUND 40
+#define FILE_BOUND 32
+#define REGKEY_BOUND 64
+
+/** Upper bound of the size of a compressed CFDATA block */
+#define BLOCK_BOUND 65535
+
+/** Bits of the hash of three bytes that starts a match */
+#define LZ_HASH_BITS 15
+/** Candidates checked per position */
+#define LZ_MAX_CHAIN 16
+
+/** Window size of LZX folders as a power of two */
+#define LZX_WINDOW_BITS 16
+/** Position slots of the window size */
+#define LZX_POSITION_SLOTS 32
+/** Symbols of the main tree */
+#define LZX_MAIN_SIZE (256 + LZX_POSITION_SLOTS * 8)
+/** Symbols of the length tree */
+#define LZX_LENGTH_SIZE 249
+/** Symbols of the pretree */
+#define LZX_PRETREE_SIZE 20
+/** Longest LZX match */
+#define LZX_MAX_MATCH 257
+/** Block type of verbatim blocks */
+#define LZX_BLOCK_VERBATIM 1
+
+/** Longest deflate match */
+#define DEFLATE_MAX_MATCH 258
+
+/** "プログラム" in CP932 */
+#define JAPANESE_NAME "\x83\x76\x83\x8D\x83\x4F\x83\x89\x83\x80"
+/** "設定" in CP932 */
+#define JAPANESE_VALUE "\x90\xDD\x92\xE8"
+
+static const uint16_t DEFLATE_LENGTH_BASE[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t DEFLATE_LENGTH_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DEFLATE_DIST_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DEFLATE_DIST_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static const uint8_t LZX_EXTRA[LZX_POSITION_SLOTS] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14};
+
+/** A literal, or a match of earlier data */
+typedef struct lz_token {
+    /** Length of the match, 0 for a literal */
+    uint16_t length;
+    /** Distance of the match, or the literal byte */
+    uint16_t distance;
+} lz_token;
+
+/** State of the match finder, reused for all blocks */
+typedef struct lz_state {
+    /** Last position of each hash, -1 for none */
+    int32_t head[1 << LZ_HASH_BITS];
+    /** Previous position with the same hash as each position */
+    int32_t prev[MS_CAB_MAX_BLOCK_SIZE];
+    /** Tokens of the current block */
+    lz_token tokens[MS_CAB_MAX_BLOCK_SIZE];
+} lz_state;
+
+/** Tree lengths of the previous LZX block, the trees are sent as deltas */
+typedef struct lzx_state {
+    uint8_t main[LZX_MAIN_SIZE];
+    uint8_t length[LZX_LENGTH_SIZE];
+    /** true once the stream header was written */
+    bool started;
+} lzx_state;
+
+/** Bit stream being written */
+typedef struct bit_writer {
+    uint8_t *data;
+    size_t length;
+    uint64_t bits;
+    int count;
+} bit_writer;
+
+/**
+ * @brief Get the next number of a xorshift random generator
+ */
+static uint32_t next_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * @brief Get a random number below n, 0 if n is 0
+ */
+static uint32_t random_below(uint32_t *state, uint32_t n) {
+    return n ? next_random(state) % n : 0;
+}
+
+static void put16(uint8_t **ptr, uint16_t value) {
+    memcpy(*ptr, &value, sizeof(value));
+    *ptr += sizeof(value);
+}
+
+/**
+ * @brief Get a random id from 1 to count, or count + 1, which does not exist,
+ * for the given percentage of dangling ids
+ */
+static uint16_t random_id(uint32_t *state, uint32_t count, int dangling) {
+    if (dangling && (int)random_below(state, 100) < dangling) return count + 1;
+    return count ? 1 + random_below(state, count) : 0;
+}
+
+/**
+ * @brief Put a string with its terminating 0
+ *
+ * @return size_t length including the terminating 0
+ */
+static size_t put_string(uint8_t **ptr, const char *str) {
+    size_t len = strlen(str) + 1;
+    memcpy(*ptr, str, len);
+    *ptr += len;
+    return len;
+}
+
+/**
+ * @brief Put a spec of random string ids, with its length and terminated by 0
+ */
+static void put_spec(uint8_t **ptr, uint32_t *state, const synth_options *opts) {
+    uint32_t components = 0;
+    if (opts->strings) {
+        components = opts->components ? opts->components : 1 + random_below(state, SPEC_MAX_COMPONENTS);
+    }
+    put16(ptr, 2 * (components + 1));
+    for (uint32_t i = 0; i < components; i++) {
+        put16(ptr, 1 + random_below(state, opts->strings));
+    }
+    put16(ptr, 0);
+}
+
+void synth_defaults(synth_options *opts) {
+    opts->strings = 256;
+    opts->dirs = 64;
+    opts->files = 500;
+    opts->hives = 16;
+    opts->regkeys = 250;
+    opts->links = 20;
+    opts->components = 0;
+    opts->cp932 = 0;
+    opts->dangling = 0;
+    opts->seed = 1;
+}
+
+uint8_t *synth_000(const synth_options *opts, size_t *size) {
+    size_t spec_bound = 2 * ((size_t)(opts->components > SPEC_MAX_COMPONENTS ? opts->components : SPEC_MAX_COMPONENTS) + 2);
+    size_t bound = HEADER_BOUND + opts->strings * STRING_BOUND + opts->dirs * (2 + spec_bound) + opts->files * FILE_BOUND +
+                   opts->hives * (6 + spec_bound) + opts->regkeys * REGKEY_BOUND + opts->links * (10 + spec_bound);
+    uint32_t state = opts->seed ? opts->seed : 1;
+    char buffer[64];
+
+    uint8_t *file = calloc(1, bound);
+    if (!file) return NULL;
+    CE_CAB_000_HEADER *header = (CE_CAB_000_HEADER *)file;
+    uint8_t *ptr = file + sizeof(CE_CAB_000_HEADER);
+
+    header->AsciiSignature = CE_CAB_000_HEADER_SIGNATURE;
+    header->Unknown3 = 1;
+    header->TargetArchitecture = CE_CAB_000_ARCH_STRONGARM;
+    header->MinCEVersionMajor = 3;
+    header->MaxCEVersionMajor = 5;
+    header->MaxCEBuildNumber = 0xFFFFFFFF;
+
+    // The header strings need 16-bit offsets, they come first
+    header->OffsetAppname = ptr - file;
+    header->LengthAppname = put_string(&ptr, opts->cp932 ? JAPANESE_NAME : "Synthetic");
+    header->OffsetProvider = ptr - file;
+    header->LengthProvider = put_string(&ptr, "Bench");
+    header->OffsetUnsupported = ptr - file;
+    header->LengthUnsupported = put_string(&ptr, "HPC");
+    header->LengthUnsupported += put_string(&ptr, "JUPITER");
+
+    header->OffsetStrings = ptr - file;
+    header->NumEntriesString = opts->strings;
+    for (uint32_t i = 0; i < opts->strings; i++) {
+        bool japanese = (int)random_below(&state, 100) < opts->cp932;
+        snprintf(buffer, sizeof(buffer), japanese ? JAPANESE_NAME "%05u" : "Folder%05u", i + 1);
+        put16(&ptr, i + 1);
+        put16(&ptr, strlen(buffer) + 1);
+        put_string(&ptr, buffer);
+    }
+
+    header->OffsetDirs = ptr - file;
+    header->NumEntriesDirs = opts->dirs;
+    for (uint32_t i = 0; i < opts->dirs; i++) {
+        put16(&ptr, i + 1);
+        put_spec(&ptr, &state, opts);
+    }
+
+    header->OffsetFiles = ptr - file;
+    header->NumEntriesFiles = opts->files;
+    for (uint32_t i = 0; i < opts->files; i++) {
+        snprintf(buffer, sizeof(buffer), "File%05u.dll", i + 1);
+        put16(&ptr, i + 1);
+        put16(&ptr, random_id(&state, opts->dirs, opts->dangling));
+        put16(&ptr, 0);
+        put16(&ptr, random_below(&state, 2) ? 0x0013 : 0x0002);
+        put16(&ptr, random_below(&state, 4) ? 0 : 0x4000);
+        put16(&ptr, strlen(buffer) + 1);
+        put_string(&ptr, buffer);
+    }
+
+    header->OffsetRegHives = ptr - file;
+    header->NumEntriesRegHives = opts->hives;
+    for (uint32_t i = 0; i < opts->hives; i++) {
+        put16(&ptr, i + 1);
+        put16(&ptr, 1 + i % 4);
+        put16(&ptr, 0);
+        put_spec(&ptr, &state, opts);
+    }
+
+    header->OffsetRegKeys = ptr - file;
+    header->NumEntriesRegKeys = opts->regkeys;
+    for (uint32_t i = 0; i < opts->regkeys; i++) {
+        static const uint32_t types[] = {TYPE_REG_SZ, TYPE_REG_DWORD, TYPE_REG_BINARY, TYPE_REG_MULTI_SZ};
+        uint32_t type = types[i % 4];
+        uint8_t *datalength;
+
+        put16(&ptr, i + 1);
+        put16(&ptr, random_id(&state, opts->hives, opts->dangling));
+        put16(&ptr, 0);
+        put16(&ptr, type & 0xFFFF);
+        put16(&ptr, type >> 16);
+        datalength = ptr;
+        ptr += sizeof(uint16_t);
+
+        uint8_t *data = ptr;
+        snprintf(buffer, sizeof(buffer), "Key%05u", i + 1);
+        put_string(&ptr, buffer);
+        if (type == TYPE_REG_SZ) {
+            bool japanese = (int)random_below(&state, 100) < opts->cp932;
+            snprintf(buffer, sizeof(buffer), japanese ? JAPANESE_VALUE "%05u" : "\\Program Files\\App%05u.exe", i);
+            put_string(&ptr, buffer);
+        } else if (type == TYPE_REG_MULTI_SZ) {
+            snprintf(buffer, sizeof(buffer), "Value%05u", i);
+            put_string(&ptr, buffer);
+            put_string(&ptr, "Other");
+            *ptr++ = '\0';
+        } else {
+            int length = type == TYPE_REG_DWORD ? 4 : 16;
+            for (int j = 0; j < length; j++) {
+                *ptr++ = next_random(&state);
+            }
+        }
+        put16(&datalength, ptr - data);
+    }
+
+    header->OffsetLinks = ptr - file;
+    header->NumEntriesLinks = opts->links;
+    for (uint32_t i = 0; i < opts->links; i++) {
+        put16(&ptr, i + 1);
+        put16(&ptr, 0);
+        put16(&ptr, random_below(&state, 18));
+        put16(&ptr, random_id(&state, opts->files, opts->dangling));
+        put16(&ptr, 1);
+        put_spec(&ptr, &state, opts);
+    }
+
+    header->FileLength = ptr - file;
+    *size = ptr - file;
+    return file;
+}
+
+/**
+ * @brief Hash the three bytes starting a match
+ */
+static inline uint32_t lz_hash(const uint8_t *data) {
+    return ((uint32_t)data[0] << 10 ^ (uint32_t)data[1] << 5 ^ data[2]) & ((1 << LZ_HASH_BITS) - 1);
+}
+
+/**
+ * @brief Add a position to the hash chains
+ */
+static inline void lz_insert(lz_state *lz, const uint8_t *data, size_t len, size_t pos) {
+    if (pos + 3 > len) return;
+    uint32_t hash = lz_hash(data + pos);
+    lz->prev[pos] = lz->head[hash];
+    lz->head[hash] = pos;
+}
+
+/**
+ * @brief Split a block into literals and matches within the block, taking the
+ * longest match at every position
+ *
+ * @param lz match finder, the tokens are stored in lz->tokens
+ * @param data block
+ * @param len length of the block, at most MS_CAB_MAX_BLOCK_SIZE
+ * @param maxlength longest match
+ * @return size_t number of tokens
+ */
+static size_t lz_tokenize(lz_state *lz, const uint8_t *data, size_t len, size_t maxlength) {
+    size_t num = 0;
+    size_t pos = 0;
+
+    memset(lz->head, 0xFF, sizeof(lz->head));
+    while (pos < len) {
+        size_t bestlength = 0, bestdistance = 0;
+        size_t max = len - pos < maxlength ? len - pos : maxlength;
+
+        if (pos + 3 <= len) {
+            int32_t candidate = lz->head[lz_hash(data + pos)];
+            for (int chain = 0; candidate >= 0 && chain < LZ_MAX_CHAIN; chain++, candidate = lz->prev[candidate]) {
+                size_t length = 0;
+                while (length < max && data[candidate + length] == data[pos + length]) length++;
+                if (length > bestlength) {
+                    bestlength = length;
+                    bestdistance = pos - candidate;
+                }
+            }
+        }
+
+        if (bestlength >= 3) {
+            lz->tokens[num++] = (lz_token){bestlength, bestdistance};
+            for (size_t i = 0; i < bestlength; i++) {
+                lz_insert(lz, data, len, pos + i);
+            }
+            pos += bestlength;
+        } else {
+            lz->tokens[num++] = (lz_token){0, data[pos]};
+            lz_insert(lz, data, len, pos);
+            pos++;
+        }
+    }
+    return num;
+}
+
+/**
+ * @brief Find the last entry of a table of base values not above a value
+ */
+static int find_base(const uint16_t *bases, int num, uint32_t value) {
+    int i = num - 1;
+    while (bases[i] > value) i--;
+    return i;
+}
+
+/**
+ * @brief Reverse the order of the lowest bits of a value
+ */
+static uint32_t reverse_bits(uint32_t value, int bits) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < bits; i++) {
+        reversed = reversed << 1 | (value >> i & 1);
+    }
+    return reversed;
+}
+
+/**
+ * @brief Write bits to a deflate stream, least significant bit first
+ */
+static void deflate_bits(bit_writer *bw, uint32_t value, int bits) {
+    bw->bits |= (uint64_t)value << bw->count;
+    bw->count += bits;
+    while (bw->count >= 8) {
+        bw->data[bw->length++] = bw->bits;
+        bw->bits >>= 8;
+        bw->count -= 8;
+    }
+}
+
+/**
+ * @brief Write a literal/length symbol with the fixed Huffman code
+ */
+static void deflate_symbol(bit_writer *bw, int symbol) {
+    if (symbol < 144) {
+        deflate_bits(bw, reverse_bits(0x30 + symbol, 8), 8);
+    } else if (symbol < 256) {
+        deflate_bits(bw, reverse_bits(0x190 + symbol - 144, 9), 9);
+    } else if (symbol < 280) {
+        deflate_bits(bw, reverse_bits(symbol - 256, 7), 7);
+    } else {
+        deflate_bits(bw, reverse_bits(0xC0 + symbol - 280, 8), 8);
+    }
+}
+
+/**
+ * @brief Compress a block to an MSZIP CFDATA payload: the "CK" signature and
+ * a final deflate block with the fixed Huffman codes
+ *
+ * @return size_t compressed size
+ */
+static size_t mszip_block(lz_state *lz, const uint8_t *data, size_t len, uint8_t *out) {
+    bit_writer bw = {out, 2, 0, 0};
+    size_t num = lz_tokenize(lz, data, len, DEFLATE_MAX_MATCH);
+
+    out[0] = 'C';
+    out[1] = 'K';
+    deflate_bits(&bw, 1, 1);  // BFINAL
+    deflate_bits(&bw, 1, 2);  // BTYPE fixed Huffman codes
+    for (size_t i = 0; i < num; i++) {
+        const lz_token *token = &lz->tokens[i];
+        if (!token->length) {
+            deflate_symbol(&bw, token->distance);
+            continue;
+        }
+        int length = find_base(DEFLATE_LENGTH_BASE, sizeof(DEFLATE_LENGTH_BASE) / sizeof(uint16_t), token->length);
+        int distance = find_base(DEFLATE_DIST_BASE, sizeof(DEFLATE_DIST_BASE) / sizeof(uint16_t), token->distance);
+        deflate_symbol(&bw, 257 + length);
+        deflate_bits(&bw, token->length - DEFLATE_LENGTH_BASE[length], DEFLATE_LENGTH_EXTRA[length]);
+        deflate_bits(&bw, reverse_bits(distance, 5), 5);
+        deflate_bits(&bw, token->distance - DEFLATE_DIST_BASE[distance], DEFLATE_DIST_EXTRA[distance]);
+    }
+    deflate_symbol(&bw, 256);
+    if (bw.count) deflate_bits(&bw, 0, 8 - bw.count);
+    return bw.length;
+}
+
+/**
+ * @brief Write bits to an LZX stream, most significant bit first in 16-bit
+ * little-endian words
+ */
+static void lzx_bits(bit_writer *bw, uint32_t value, int bits) {
+    bw->bits = bw->bits << bits | (value & ((1u << bits) - 1));
+    bw->count += bits;
+    while (bw->count >= 16) {
+        uint16_t word = bw->bits >> (bw->count - 16);
+        bw->data[bw->length++] = word;
+        bw->data[bw->length++] = word >> 8;
+        bw->count -= 16;
+    }
+}
+
+/**
+ * @brief Compute Huffman code lengths limited to a maximum length
+ *
+ * Codes longer than the maximum are avoided by flattening the frequencies and
+ * building the code again. At least two symbols need a frequency, so that the
+ * code is complete.
+ *
+ * @param freqs frequency of each symbol
+ * @param num number of symbols
+ * @param maxlength longest code
+ * @param lengths set to the code length of each symbol, 0 for unused symbols
+ */
+static void huffman_lengths(const uint32_t *freqs, int num, int maxlength, uint8_t *lengths) {
+    uint32_t *weights = malloc(2 * num * sizeof(uint32_t));
+    int *symbols = malloc(num * sizeof(int));
+    int *parents = malloc(2 * num * sizeof(int));
+    uint8_t *depths = malloc(2 * num);
+    uint32_t *scaled = malloc(num * sizeof(uint32_t));
+    memcpy(scaled, freqs, num * sizeof(uint32_t));
+
+    for (;;) {
+        int leaves = 0, longest = 0;
+
+        // Leaves sorted by weight, by insertion as they are few
+        for (int i = 0; i < num; i++) {
+            if (!scaled[i]) continue;
+            int j = leaves++;
+            while (j > 0 && weights[j - 1] > scaled[i]) {
+                weights[j] = weights[j - 1];
+                symbols[j] = symbols[j - 1];
+                j--;
+            }
+            weights[j] = scaled[i];
+            symbols[j] = i;
+        }
+
+        // Two queues: the sorted leaves, and the inner nodes in the order
+        // they are created, which is sorted as well
+        int leaf = 0, inner = leaves, next = leaves;
+        while (next < 2 * leaves - 1) {
+            int pair[2];
+            for (int k = 0; k < 2; k++) {
+                if (leaf < leaves && (inner >= next || weights[leaf] <= weights[inner])) {
+                    pair[k] = leaf++;
+                } else {
+                    pair[k] = inner++;
+                }
+            }
+            weights[next] = weights[pair[0]] + weights[pair[1]];
+            parents[pair[0]] = parents[pair[1]] = next++;
+        }
+
+        memset(lengths, 0, num);
+        depths[2 * leaves - 2] = 0;
+        for (int i = 2 * leaves - 3; i >= 0; i--) {
+            depths[i] = depths[parents[i]] + 1;
+        }
+        for (int i = 0; i < leaves; i++) {
+            lengths[symbols[i]] = depths[i];
+            if (depths[i] > longest) longest = depths[i];
+        }
+        if (longest <= maxlength) break;
+
+        for (int i = 0; i < num; i++) {
+            if (scaled[i]) scaled[i] = (scaled[i] >> 1) + 1;
+        }
+    }
+    free(weights);
+    free(symbols);
+    free(parents);
+    free(depths);
+    free(scaled);
+}
+
+/**
+ * @brief Assign the canonical Huffman codes to code lengths
+ */
+static void huffman_codes(const uint8_t *lengths, int num, uint32_t *codes) {
+    uint32_t code = 0;
+    for (int length = 1; length <= 16; length++) {
+        for (int i = 0; i < num; i++) {
+            if (lengths[i] == length) codes[i] = code++;
+        }
+        code <<= 1;
+    }
+}
+
+/**
+ * @brief Write a range of an LZX tree as deltas to the previous lengths,
+ * with its own pretree
+ *
+ * @param bw stream
+ * @param prev lengths of the previous block, updated to lengths
+ * @param lengths code lengths
+ * @param first first symbol of the range
+ * @param last one past the last symbol of the range
+ */
+static void lzx_tree(bit_writer *bw, uint8_t *prev, const uint8_t *lengths, int first, int last) {
+    uint32_t freqs[LZX_PRETREE_SIZE] = {1, 1};
+    uint8_t pretree[LZX_PRETREE_SIZE];
+    uint32_t codes[LZX_PRETREE_SIZE];
+
+    for (int i = first; i < last; i++) {
+        freqs[(prev[i] - lengths[i] + 17) % 17]++;
+    }
+    huffman_lengths(freqs, LZX_PRETREE_SIZE, 15, pretree);
+    huffman_codes(pretree, LZX_PRETREE_SIZE, codes);
+
+    for (int i = 0; i < LZX_PRETREE_SIZE; i++) {
+        lzx_bits(bw, pretree[i], 4);
+    }
+    for (int i = first; i < last; i++) {
+        int symbol = (prev[i] - lengths[i] + 17) % 17;
+        lzx_bits(bw, codes[symbol], pretree[symbol]);
+        prev[i] = lengths[i];
+    }
+}
+
+/**
+ * @brief Compress a frame to one LZX verbatim block
+ *
+ * Offsets are always sent in full, the repeated offsets are not used.
+ *
+ * @return size_t compressed size
+ */
+static size_t lzx_frame(lz_state *lz, lzx_state *lzx, const uint8_t *data, size_t len, uint8_t *out) {
+    static uint32_t bases[LZX_POSITION_SLOTS];
+    uint32_t mainfreqs[LZX_MAIN_SIZE] = {1, 1};
+    uint32_t lengthfreqs[LZX_LENGTH_SIZE] = {1, 1};
+    uint8_t mainlengths[LZX_MAIN_SIZE], lengthlengths[LZX_LENGTH_SIZE];
+    uint32_t maincodes[LZX_MAIN_SIZE], lengthcodes[LZX_LENGTH_SIZE];
+    bit_writer bw = {out, 0, 0, 0};
+    size_t num = lz_tokenize(lz, data, len, LZX_MAX_MATCH);
+
+    for (int i = 1; i < LZX_POSITION_SLOTS; i++) {
+        bases[i] = bases[i - 1] + (1 << LZX_EXTRA[i - 1]);
+    }
+
+    // Matches are stored as the main symbol in length, the slot in distance
+    for (size_t i = 0; i < num; i++) {
+        lz_token *token = &lz->tokens[i];
+        if (!token->length) {
+            mainfreqs[token->distance]++;
+            continue;
+        }
+        int slot = LZX_POSITION_SLOTS - 1;
+        while (bases[slot] > token->distance + 2u) slot--;
+        int header = token->length - 2 < 7 ? token->length - 2 : 7;
+        mainfreqs[256 + slot * 8 + header]++;
+        if (header == 7) lengthfreqs[token->length - 9]++;
+    }
+    huffman_lengths(mainfreqs, LZX_MAIN_SIZE, 16, mainlengths);
+    huffman_lengths(lengthfreqs, LZX_LENGTH_SIZE, 16, lengthlengths);
+    huffman_codes(mainlengths, LZX_MAIN_SIZE, maincodes);
+    huffman_codes(lengthlengths, LZX_LENGTH_SIZE, lengthcodes);
+
+    if (!lzx->started) {
+        lzx_bits(&bw, 0, 1);  // no E8 call translation
+        lzx->started = true;
+    }
+    lzx_bits(&bw, LZX_BLOCK_VERBATIM, 3);
+    lzx_bits(&bw, len >> 8, 16);
+    lzx_bits(&bw, len & 0xFF, 8);
+    lzx_tree(&bw, lzx->main, mainlengths, 0, 256);
+    lzx_tree(&bw, lzx->main, mainlengths, 256, LZX_MAIN_SIZE);
+    lzx_tree(&bw, lzx->length, lengthlengths, 0, LZX_LENGTH_SIZE);
+
+    for (size_t i = 0; i < num; i++) {
+        const lz_token *token = &lz->tokens[i];
+        if (!token->length) {
+            lzx_bits(&bw, maincodes[token->distance], mainlengths[token->distance]);
+            continue;
+        }
+        uint32_t offset = token->distance + 2u;
+        int slot = LZX_POSITION_SLOTS - 1;
+        while (bases[slot] > offset) slot--;
+        int header = token->length - 2 < 7 ? token->length - 2 : 7;
+        int symbol = 256 + slot * 8 + header;
+        lzx_bits(&bw, maincodes[symbol], mainlengths[symbol]);
+        if (header == 7) {
+            lzx_bits(&bw, lengthcodes[token->length - 9], lengthlengths[token->length - 9]);
+        }
+        lzx_bits(&bw, offset - bases[slot], LZX_EXTRA[slot]);
+    }
+
+    // Frames end on a 16-bit boundary
+    if (bw.count) lzx_bits(&bw, 0, 16 - bw.count);
+    return bw.length;
+}
+
+/**
+ * @brief Fill the payload with data that compresses about as well as code:
+ * 32-bit words, half of them from a small set of common words
+ */
+static void fill_payload(uint8_t *data, size_t len, uint32_t seed) {
+    uint32_t state = seed ? seed : 1;
+    uint32_t common[64];
+
+    for (int i = 0; i < 64; i++) {
+        common[i] = next_random(&state);
+    }
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t word = random_below(&state, 2) ? common[random_below(&state, 64)] : next_random(&state);
+        memcpy(data + i, &word, len - i < 4 ? len - i : 4);
+    }
+}
+
+/**
+ * @brief Put a CFFILE entry
+ */
+static void put_file_entry(uint8_t **ptr, const char *name, uint32_t size, uint32_t offset) {
+    MS_CAB_FILE_ENTRY entry = {0};
+    entry.FileSize = size;
+    entry.FolderOffset = offset;
+    entry.Date = (2005 - 1980) << 9 | 1 << 5 | 1;
+    entry.Attributes = 0x20;
+    memcpy(*ptr, &entry, offsetof(MS_CAB_FILE_ENTRY, Name));
+    *ptr += offsetof(MS_CAB_FILE_ENTRY, Name);
+    put_string(ptr, name);
+}
+
+uint8_t *synth_cab(const uint8_t *file, size_t size, synth_compression compression, size_t payload, uint32_t seed, size_t *cabsize) {
+    static const char PAYLOAD_NAME[] = "setup.dll";
+    static const char FILE_NAME[] = "synthetic.000";
+    size_t total = payload + size;
+    size_t numblocks = (total + MS_CAB_MAX_BLOCK_SIZE - 1) / MS_CAB_MAX_BLOCK_SIZE;
+    size_t numfiles = payload ? 2 : 1;
+    size_t headersize = sizeof(MS_CAB_HEADER) + sizeof(MS_CAB_FOLDER_ENTRY) + offsetof(MS_CAB_FILE_ENTRY, Name) + sizeof(FILE_NAME);
+    uint8_t *folder, *cab, *ptr;
+    lz_state *lz = NULL;
+    lzx_state lzx = {0};
+
+    if (payload) headersize += offsetof(MS_CAB_FILE_ENTRY, Name) + sizeof(PAYLOAD_NAME);
+    folder = malloc(total);
+    cab = calloc(1, headersize + numblocks * (sizeof(MS_CAB_DATA_ENTRY) + BLOCK_BOUND));
+    if (compression != SYNTH_STORED) lz = malloc(sizeof(lz_state));
+    if (!folder || !cab || (compression != SYNTH_STORED && !lz)) {
+        free(folder);
+        free(cab);
+        free(lz);
+        return NULL;
+    }
+    fill_payload(folder, payload, seed);
+    memcpy(folder + payload, file, size);
+
+    MS_CAB_HEADER header = {0};
+    header.Signature = CE_CAB_HEADER_SIGNATURE;
+    header.OffsetFiles = sizeof(MS_CAB_HEADER) + sizeof(MS_CAB_FOLDER_ENTRY);
+    header.VersionMinor = 3;
+    header.VersionMajor = 1;
+    header.NumFolders = 1;
+    header.NumFiles = numfiles;
+
+    MS_CAB_FOLDER_ENTRY folderentry = {0};
+    folderentry.OffsetData = headersize;
+    folderentry.NumDataBlocks = numblocks;
+    switch (compression) {
+        case SYNTH_MSZIP:
+            folderentry.CompressionType = MS_CAB_COMPRESS_MSZIP;
+            break;
+        case SYNTH_LZX:
+            folderentry.CompressionType = MS_CAB_COMPRESS_LZX | LZX_WINDOW_BITS << 8;
+            break;
+        default:
+            folderentry.CompressionType = MS_CAB_COMPRESS_NONE;
+            break;
+    }
+
+    ptr = cab + sizeof(MS_CAB_HEADER);
+    memcpy(ptr, &folderentry, sizeof(folderentry));
+    ptr += sizeof(folderentry);
+    if (payload) put_file_entry(&ptr, PAYLOAD_NAME, payload, 0);
+    put_file_entry(&ptr, FILE_NAME, size, payload);
+
+    for (size_t offset = 0; offset < total; offset += MS_CAB_MAX_BLOCK_SIZE) {
+        size_t len = total - offset < MS_CAB_MAX_BLOCK_SIZE ? total - offset : MS_CAB_MAX_BLOCK_SIZE;
+        uint8_t *data = ptr + sizeof(MS_CAB_DATA_ENTRY);
+        MS_CAB_DATA_ENTRY dataentry = {0};
+
+        if (compression == SYNTH_MSZIP) {
+            dataentry.CompressedSize = mszip_block(lz, folder + offset, len, data);
+        } else if (compression == SYNTH_LZX) {
+            dataentry.CompressedSize = lzx_frame(lz, &lzx, folder + offset, len, data);
+        } else {
+            memcpy(data, folder + offset, len);
+            dataentry.CompressedSize = len;
+        }
+        dataentry.UncompressedSize = len;
+        memcpy(ptr, &dataentry, sizeof(dataentry));
+        ptr = data + dataentry.CompressedSize;
+    }
+
+    header.CabinetSize = ptr - cab;
+    memcpy(cab, &header, sizeof(header));
+    free(folder);
+    free(lz);
+    *cabsize = ptr - cab;
+    return cab;
+}
+
+int synth_compression_from_name(const char *name, synth_compression *compression) {
+    static const char *const NAMES[] = {"none", "stored", "mszip", "lzx"};
+
+    for (int i = 0; i < 4; i++) {
+        if (!strcasecmp(name, NAMES[i])) {
+            *compression = i;
+            return 0;
+        }
+    }
+    return -1;
+}
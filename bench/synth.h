@@ -0,0 +1,97 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Largest number of entries of a section, ids are 16-bit and start at 1 */
+#define SYNTH_MAX_ENTRIES 65535
+
+/** Container of a synthetic 000 file */
+typedef enum synth_compression {
+    /** The bare 000 file */
+    SYNTH_NONE,
+    /** CAB file with an uncompressed folder */
+    SYNTH_STORED,
+    /** CAB file with an MSZIP compressed folder */
+    SYNTH_MSZIP,
+    /** CAB file with an LZX compressed folder */
+    SYNTH_LZX,
+} synth_compression;
+
+/** Shape of a synthetic 000 file */
+typedef struct synth_options {
+    /** Number of entries of the STRINGS section */
+    uint32_t strings;
+    /** Number of entries of the DIRS section */
+    uint32_t dirs;
+    /** Number of entries of the FILES section */
+    uint32_t files;
+    /** Number of entries of the REGHIVES section */
+    uint32_t hives;
+    /** Number of entries of the REGKEYS section */
+    uint32_t regkeys;
+    /** Number of entries of the LINKS section */
+    uint32_t links;
+    /** Number of string ids of every spec, 0 for a random number from 1 to 4 */
+    uint32_t components;
+    /** Percentage of strings and string values written in Japanese, CP932 */
+    int cp932;
+    /** Percentage of files, registry entries and links referring to a
+     * directory, hive or file that does not exist, as in malformed files */
+    int dangling;
+    /** Seed of the random numbers, the same seed gives the same file */
+    uint32_t seed;
+} synth_options;
+
+/**
+ * @brief Set the default shape, a mid-sized installer
+ *
+ * @param opts options to initialize
+ */
+void synth_defaults(synth_options *opts);
+
+/**
+ * @brief Build a 000 file
+ *
+ * Specs refer to random strings, files to random directories, registry
+ * entries to random hives and links to random files. Registry entries cycle
+ * through the REG_SZ, REG_DWORD, REG_BINARY and REG_MULTI_SZ types.
+ *
+ * @param opts shape of the file, at most SYNTH_MAX_ENTRIES entries per section
+ * @param size set to the size of the file
+ * @return uint8_t* file contents to release with free(), NULL if memory
+ * allocation failed
+ */
+uint8_t *synth_000(const synth_options *opts, size_t *size);
+
+/**
+ * @brief Wrap a 000 file in a CAB file
+ *
+ * The cabinet has one folder holding an optional payload file, setup.dll,
+ * followed by the 000 file, so extracting the 000 file also decompresses the
+ * payload. MSZIP blocks are deflated with the fixed Huffman codes, LZX frames
+ * are verbatim blocks with a window of 64 KiB. Matches are searched within
+ * the current 32 KiB block only.
+ *
+ * @param file 000 file
+ * @param size size of the 000 file
+ * @param compression compression of the folder, not SYNTH_NONE
+ * @param payload size of the payload file, 0 for none
+ * @param seed seed of the random payload
+ * @param cabsize set to the size of the cabinet
+ * @return uint8_t* cabinet to release with free(), NULL if memory allocation
+ * failed
+ */
+uint8_t *synth_cab(const uint8_t *file, size_t size, synth_compression compression, size_t payload, uint32_t seed, size_t *cabsize);
+
+/**
+ * @brief Look up a container by name
+ *
+ * @param name one of "none", "stored", "mszip" or "lzx"
+ * @param compression set to the container
+ * @return int 0 on success, -1 for an unknown name
+ */
+int synth_compression_from_name(const char *name, synth_compression *compression);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef MSCABHEADER_H
+#define MSCABHEADER_H
+
+#include <stdint.h>
+
+/** "MSCF" as a little-endian integer */
+#define CE_CAB_HEADER_SIGNATURE 0x4643534D
+
+/* CFHEADER flags */
+
+/** A szCabinetPrev/szDiskPrev pair follows the fixed header */
+#define MS_CAB_FLAG_PREV_CABINET 0x0001
+/** A szCabinetNext/szDiskNext pair follows the fixed header */
+#define MS_CAB_FLAG_NEXT_CABINET 0x0002
+/** The cbCFHeader/cbCFFolder/cbCFData reserve fields are present */
+#define MS_CAB_FLAG_RESERVE_PRESENT 0x0004
+
+/* CFFOLDER typeCompress values */
+
+#define MS_CAB_COMPRESS_MASK 0x000F
+#define MS_CAB_COMPRESS_NONE 0x0000
+#define MS_CAB_COMPRESS_MSZIP 0x0001
+#define MS_CAB_COMPRESS_QUANTUM 0x0002
+#define MS_CAB_COMPRESS_LZX 0x0003
+
+/* CFFILE iFolder values for files continued from or to another cabinet */
+
+#define MS_CAB_IFOLDER_CONTINUED_FROM_PREV 0xFFFD
+#define MS_CAB_IFOLDER_CONTINUED_TO_NEXT 0xFFFE
+#define MS_CAB_IFOLDER_CONTINUED_PREV_AND_NEXT 0xFFFF
+
+/** Maximum uncompressed size of a single CFDATA block */
+#define MS_CAB_MAX_BLOCK_SIZE 32768
+
+typedef struct _MS_CAB_HEADER {
+    /** An ASCII signature, "MSCF". This is 0x4643534D as a little-endian
+     * integer */
+    uint32_t Signature;
+    /** Reserved, 0 */
+    uint32_t Reserved1;
+    /** Size of the whole cabinet file in bytes */
+    uint32_t CabinetSize;
+    /** Reserved, 0 */
+    uint32_t Reserved2;
+    /** Offset of the first CFFILE entry */
+    uint32_t OffsetFiles;
+    /** Reserved, 0 */
+    uint32_t Reserved3;
+    /** Cabinet file format version, minor, usually 3 */
+    uint8_t VersionMinor;
+    /** Cabinet file format version, major, usually 1 */
+    uint8_t VersionMajor;
+    /** The number of CFFOLDER entries in this cabinet */
+    uint16_t NumFolders;
+    /** The number of CFFILE entries in this cabinet */
+    uint16_t NumFiles;
+    /** Cabinet flags, see MS_CAB_FLAG_* */
+    uint16_t Flags;
+    /** Must be the same for all cabinets in a set */
+    uint16_t SetId;
+    /** Number of this cabinet file in a set */
+    uint16_t CabinetIndex;
+} MS_CAB_HEADER;
+
+typedef struct _MS_CAB_FOLDER_ENTRY {
+    /** Offset of the first CFDATA block in this folder */
+    uint32_t OffsetData;
+    /** Number of CFDATA blocks in this folder */
+    uint16_t NumDataBlocks;
+    /** Compression type, see MS_CAB_COMPRESS_*. For LZX, bits 8-12 hold the
+     * window size as a power of two */
+    uint16_t CompressionType;
+} MS_CAB_FOLDER_ENTRY;
+
+typedef struct _MS_CAB_FILE_ENTRY {
+    /** Uncompressed size of this file in bytes */
+    uint32_t FileSize;
+    /** Uncompressed offset of this file in the folder */
+    uint32_t FolderOffset;
+    /** Index of the folder containing this file, or one of
+     * MS_CAB_IFOLDER_CONTINUED_* */
+    uint16_t FolderIndex;
+    /** Date stamp of the file */
+    uint16_t Date;
+    /** Time stamp of the file */
+    uint16_t Time;
+    /** Attribute flags of the file */
+    uint16_t Attributes;
+    /* The null-terminated name of the file */
+    char Name;
+} MS_CAB_FILE_ENTRY;
+
+typedef struct _MS_CAB_DATA_ENTRY {
+    /** Checksum of this CFDATA entry, or 0 */
+    uint32_t Checksum;
+    /** Number of compressed bytes in this block */
+    uint16_t CompressedSize;
+    /** Number of uncompressed bytes in this block */
+    uint16_t UncompressedSize;
+} MS_CAB_DATA_ENTRY;
+
+#endif
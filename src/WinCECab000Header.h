@@ -1,18 +1,20 @@
+#ifndef WINCECAB000HEADER_H
+#define WINCECAB000HEADER_H
+
 #include <stdint.h>
 
+#include "MSCabHeader.h"
 #include "WinCEArchitecture.h"
 
 #define CE_CAB_000_HEADER_SIGNATURE 0x4543534D
 
-#define CE_CAB_HEADER_SIGNATURE 0x4643534D
-
 #define TYPE_REG_MASK 0x00010001
 #define TYPE_REG_DWORD 0x00010001
 #define TYPE_REG_SZ 0x00000000
 #define TYPE_REG_MULTI_SZ 0x00010000
 #define TYPE_REG_BINARY 0x00000001
 
-const char* BASE_DIRS[] = {
+static const char *const BASE_DIRS[] = {
     "%InstallDir%",
     "%CE1%",
     "%CE2%",
@@ -275,3 +277,5 @@ typedef struct _CE_CAB_000_HEADER {
 /** ARM 7TDMI */
 #define CE_CAB_000_ARCH_ARM7TDMI 70001
 #define CE_CAB_000_ARCH_ARM7TDMI_NAME CE_ARCH_THUMB
+
+#endif
@@ -0,0 +1,79 @@
+#include <stdlib.h>
+
+#include "arena.h"
+
+/** Alignment of all allocations */
+#define ARENA_ALIGN 16
+
+void arena_init(arena *a) {
+    a->first = NULL;
+    a->current = NULL;
+    a->allocations = 0;
+    a->blocks = 0;
+}
+
+void *arena_alloc(arena *a, size_t size) {
+    arena_block *block = a->current;
+
+    a->allocations++;
+    if (block) {
+        size_t offset = (block->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        if (offset <= block->size && size <= block->size - offset) {
+            block->used = offset + size;
+            return block->data + offset;
+        }
+
+        // Blocks after the current one are left over from before the last
+        // reset, and are reused if they are large enough
+        if (block->next && size <= block->next->size) {
+            block = a->current = block->next;
+            block->used = size;
+            return block->data;
+        }
+    }
+
+    size_t blocksize = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+    arena_block *newblock = malloc(sizeof(arena_block) + blocksize);
+    if (!newblock) return NULL;
+    a->blocks++;
+    newblock->size = blocksize;
+    newblock->used = size;
+
+    // Insert the new block after the current one
+    if (block) {
+        newblock->next = block->next;
+        block->next = newblock;
+    } else {
+        newblock->next = a->first;
+        a->first = newblock;
+    }
+    a->current = newblock;
+    return newblock->data;
+}
+
+int arena_extend(arena *a, void *ptr, size_t size, size_t newsize) {
+    arena_block *block = a->current;
+
+    if (!block || (uint8_t *)ptr + size != block->data + block->used) return 0;
+    if (newsize < size || newsize - size > block->size - block->used) return 0;
+    block->used += newsize - size;
+    return 1;
+}
+
+void arena_reset(arena *a) {
+    a->current = a->first;
+    if (a->current) {
+        a->current->used = 0;
+    }
+}
+
+void arena_free(arena *a) {
+    arena_block *block = a->first;
+    while (block) {
+        arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+    a->first = NULL;
+    a->current = NULL;
+}
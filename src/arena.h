@@ -0,0 +1,81 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Default size of an arena block */
+#define ARENA_BLOCK_SIZE 65536
+
+/** Block of arena memory */
+typedef struct arena_block {
+    /** Next block in the chain */
+    struct arena_block *next;
+    /** Usable size of data */
+    size_t size;
+    /** Bytes of data handed out */
+    size_t used;
+    /** Memory handed out by the arena */
+    uint8_t data[];
+} arena_block;
+
+/**
+ * Bump allocator. Allocations are taken from a chain of blocks and are never
+ * released one by one, only all at once by resetting the arena. The blocks are
+ * kept when the arena is reset, so an arena that is reset between files stops
+ * allocating once it has grown to the largest file.
+ */
+typedef struct arena {
+    /** First block of the chain */
+    arena_block *first;
+    /** Block allocations are currently taken from */
+    arena_block *current;
+    /** Number of allocations, not cleared by resetting the arena */
+    size_t allocations;
+    /** Number of blocks allocated, not cleared by resetting the arena */
+    size_t blocks;
+} arena;
+
+/**
+ * @brief Initialize an empty arena
+ *
+ * @param a arena to initialize
+ */
+void arena_init(arena *a);
+
+/**
+ * @brief Allocate memory from an arena
+ *
+ * @param a arena
+ * @param size size in bytes
+ * @return void* memory aligned for any type, valid until the arena is reset,
+ * or NULL if a new block could not be allocated
+ */
+void *arena_alloc(arena *a, size_t size);
+
+/**
+ * @brief Grow the last allocation of an arena in place
+ *
+ * @param a arena
+ * @param ptr last allocation returned by arena_alloc()
+ * @param size current size of the allocation
+ * @param newsize requested size of the allocation
+ * @return int 1 if the allocation was grown, 0 if it has to be moved
+ */
+int arena_extend(arena *a, void *ptr, size_t size, size_t newsize);
+
+/**
+ * @brief Release all allocations of an arena at once, keeping its blocks
+ *
+ * @param a arena
+ */
+void arena_reset(arena *a);
+
+/**
+ * @brief Release the blocks of an arena
+ *
+ * @param a arena
+ */
+void arena_free(arena *a);
+
+#endif
@@ -0,0 +1,887 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "cache.h"
+
+/** Magic numbers of the data file and the index file, ending in the version
+ * of the format. The files are written in the byte order and struct layout
+ * of the host. */
+#define DATA_MAGIC "WCECDAT1"
+#define INDEX_MAGIC "WCECIDX1"
+
+/** Blobs are evicted down to this percentage of the limits */
+#define EVICT_PERCENT 80
+
+/** Inputs modified less than this many seconds before the cache was opened
+ * are not added to the index, as a modification within the resolution of the
+ * file system timestamps would go unnoticed */
+#define RACY_SECONDS 2
+
+/** Primes of the digest, the ones of XXH64 */
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+/** Header of the data file, followed by the blobs */
+typedef struct data_header {
+    char magic[8];
+    /** Random number shared with the index of the data */
+    uint64_t generation;
+} data_header;
+
+/** Header of a blob in the data file, followed by the blob padded to a
+ * multiple of 8 bytes */
+typedef struct blob_header {
+    cache_digest digest;
+    uint64_t kind;
+    uint64_t size;
+} blob_header;
+
+/** Header of the index file, followed by the entries and the identities */
+typedef struct index_header {
+    char magic[8];
+    /** Generation of the data file the index belongs to */
+    uint64_t generation;
+    /** Size of the data file */
+    uint64_t data_size;
+    /** Number of runs so far */
+    uint64_t run;
+    uint64_t num_entries;
+    uint64_t num_identities;
+} index_header;
+
+/** Blob in the data file */
+typedef struct cache_entry {
+    cache_digest digest;
+    uint64_t kind;
+    /** Offset of the blob header in the data file */
+    uint64_t offset;
+    /** Size of the blob in bytes, without header and padding */
+    uint64_t size;
+    /** Last run that looked up or added the blob */
+    uint64_t run;
+} cache_entry;
+
+/** Digest of an input file, valid as long as the file keeps its identity */
+typedef struct cache_identity {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_ns;
+    cache_digest digest;
+} cache_identity;
+
+/** Open addressing hash table of indexes into an array, 0 marks an empty
+ * slot and other slots hold the index plus 1 */
+typedef struct slot_table {
+    uint32_t *slots;
+    size_t mask;
+} slot_table;
+
+struct cache {
+    /** Cache directory */
+    char *dir;
+    /** Lock file, locked as long as the cache is open */
+    int lockfd;
+    /** Data file */
+    int datafd;
+    /** Data file as of opening the cache, blobs added later are read with
+     * pread() */
+    const uint8_t *map;
+    size_t map_size;
+    /** Size of the data file including the blobs added */
+    uint64_t data_size;
+    uint64_t generation;
+    /** Number of this run */
+    uint64_t run;
+    cache_limits limits;
+    cache_entry *entries;
+    size_t num_entries;
+    size_t max_entries;
+    slot_table entry_table;
+    cache_identity *identities;
+    size_t num_identities;
+    size_t max_identities;
+    slot_table identity_table;
+    /** Inputs modified after this time, in nanoseconds since the epoch, are
+     * not added to the index */
+    int64_t racy_ns;
+    /** First error of writing the data file, CACHE_OK for none */
+    int status;
+    /** Protects all of the above */
+    pthread_mutex_t lock;
+    cache_stats stats;
+};
+
+static inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t digest_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME1;
+}
+
+static inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+void cache_digest_bytes(const void *data, size_t size, cache_digest *digest) {
+    const uint8_t *p = data;
+    const uint8_t *end = p + size;
+    uint64_t v1 = PRIME1 + PRIME2, v2 = PRIME2, v3 = 0, v4 = -PRIME1;
+    uint8_t tail[32] = {0};
+
+    // Four independent lanes of 8 bytes each
+    while (end - p >= 32) {
+        v1 = digest_round(v1, read64(p));
+        v2 = digest_round(v2, read64(p + 8));
+        v3 = digest_round(v3, read64(p + 16));
+        v4 = digest_round(v4, read64(p + 24));
+        p += 32;
+    }
+
+    // The rest is hashed as a block padded with zeros, the size tells inputs
+    // differing in trailing zeros apart
+    if (end > p) memcpy(tail, p, end - p);
+    v1 = digest_round(v1, read64(tail));
+    v2 = digest_round(v2, read64(tail + 8));
+    v3 = digest_round(v3, read64(tail + 16));
+    v4 = digest_round(v4, read64(tail + 24));
+
+    digest->lo = avalanche(rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18) + size * PRIME5);
+    digest->hi = avalanche((v1 ^ rotl64(v3, 27)) * PRIME4 + (v2 ^ rotl64(v4, 33)) * PRIME5 + size);
+}
+
+const char *cache_strerror(int status) {
+    switch (status) {
+        case CACHE_OK:
+            return "no error";
+        case CACHE_ERR_IO:
+            return "cache can not be read or written";
+        case CACHE_ERR_LOCKED:
+            return "cache is in use by another process";
+        case CACHE_ERR_NOMEM:
+            return "out of memory";
+        case CACHE_ERR_UNSUPPORTED:
+            return "caching is not supported on this platform";
+        default:
+            return "unknown error";
+    }
+}
+
+#ifndef _WIN32
+
+static uint64_t entry_hash(const void *item) {
+    return ((const cache_entry *)item)->digest.lo;
+}
+
+static uint64_t identity_hash(const void *item) {
+    const cache_identity *identity = item;
+    return avalanche(identity->dev * PRIME1 ^ identity->ino * PRIME2 ^ identity->size * PRIME3 ^ (uint64_t)identity->mtime_ns * PRIME4);
+}
+
+static void table_insert(slot_table *table, uint64_t hash, size_t index) {
+    size_t i = hash & table->mask;
+    while (table->slots[i]) {
+        i = (i + 1) & table->mask;
+    }
+    table->slots[i] = index + 1;
+}
+
+/**
+ * @brief Make room in a hash table for count items, keeping it at most half
+ * full
+ *
+ * @param table hash table
+ * @param count number of items, including the last one, which the caller
+ * inserts
+ * @param items items indexed by the table
+ * @param itemsize size of an item
+ * @param hash hash function of the items
+ * @return int CACHE_OK on success, CACHE_ERR_NOMEM otherwise
+ */
+static int table_reserve(slot_table *table, size_t count, const void *items, size_t itemsize, uint64_t (*hash)(const void *)) {
+    size_t capacity = 16;
+
+    if (table->slots && count * 2 <= table->mask + 1) return CACHE_OK;
+    while (capacity < count * 2) capacity *= 2;
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (!slots) return CACHE_ERR_NOMEM;
+    free(table->slots);
+    table->slots = slots;
+    table->mask = capacity - 1;
+
+    for (size_t i = 0; i + 1 < count; i++) {
+        table_insert(table, hash((const uint8_t *)items + i * itemsize), i);
+    }
+    return CACHE_OK;
+}
+
+/**
+ * @brief Rebuild a hash table from scratch, inserting all items
+ */
+static int table_rebuild(slot_table *table, size_t count, const void *items, size_t itemsize, uint64_t (*hash)(const void *)) {
+    free(table->slots);
+    table->slots = NULL;
+    return table_reserve(table, count + 1, items, itemsize, hash);
+}
+
+/**
+ * @brief Find the entry of a blob
+ *
+ * @param c cache
+ * @param digest digest of the input
+ * @param kind kind of the blob
+ * @param anykind true to find a blob of any kind
+ * @return long index of the entry, -1 if there is none
+ */
+static long find_entry(const cache *c, const cache_digest *digest, uint64_t kind, bool anykind) {
+    if (!c->entry_table.slots) return -1;
+    for (size_t i = digest->lo & c->entry_table.mask;; i = (i + 1) & c->entry_table.mask) {
+        uint32_t slot = c->entry_table.slots[i];
+        if (!slot) return -1;
+
+        const cache_entry *entry = &c->entries[slot - 1];
+        if (entry->digest.lo == digest->lo && entry->digest.hi == digest->hi && (anykind || entry->kind == kind)) {
+            return slot - 1;
+        }
+    }
+}
+
+static int add_entry(cache *c, const cache_entry *entry) {
+    if (c->num_entries == c->max_entries) {
+        size_t max = c->max_entries ? c->max_entries * 2 : 256;
+        cache_entry *entries = realloc(c->entries, max * sizeof(cache_entry));
+        if (!entries) return CACHE_ERR_NOMEM;
+        c->entries = entries;
+        c->max_entries = max;
+    }
+    c->entries[c->num_entries++] = *entry;
+    int status = table_reserve(&c->entry_table, c->num_entries, c->entries, sizeof(cache_entry), entry_hash);
+    if (status != CACHE_OK) {
+        c->num_entries--;
+        return status;
+    }
+    table_insert(&c->entry_table, entry_hash(entry), c->num_entries - 1);
+    return CACHE_OK;
+}
+
+/**
+ * @brief Find the digest of an input file by its identity
+ *
+ * @param c cache
+ * @param identity identity to look up, its digest is set if found
+ * @return bool true if found
+ */
+static bool find_identity(const cache *c, cache_identity *identity) {
+    if (!c->identity_table.slots) return false;
+    for (size_t i = identity_hash(identity) & c->identity_table.mask;; i = (i + 1) & c->identity_table.mask) {
+        uint32_t slot = c->identity_table.slots[i];
+        if (!slot) return false;
+
+        const cache_identity *found = &c->identities[slot - 1];
+        if (found->dev == identity->dev && found->ino == identity->ino && found->size == identity->size && found->mtime_ns == identity->mtime_ns) {
+            identity->digest = found->digest;
+            return true;
+        }
+    }
+}
+
+static int add_identity(cache *c, const cache_identity *identity) {
+    if (c->num_identities == c->max_identities) {
+        size_t max = c->max_identities ? c->max_identities * 2 : 256;
+        cache_identity *identities = realloc(c->identities, max * sizeof(cache_identity));
+        if (!identities) return CACHE_ERR_NOMEM;
+        c->identities = identities;
+        c->max_identities = max;
+    }
+    c->identities[c->num_identities++] = *identity;
+    int status = table_reserve(&c->identity_table, c->num_identities, c->identities, sizeof(cache_identity), identity_hash);
+    if (status != CACHE_OK) {
+        c->num_identities--;
+        return status;
+    }
+    table_insert(&c->identity_table, identity_hash(identity), c->num_identities - 1);
+    return CACHE_OK;
+}
+
+/**
+ * @brief Get the space a blob takes in the data file
+ */
+static inline uint64_t blob_bytes(uint64_t size) {
+    return sizeof(blob_header) + ((size + 7) & ~(uint64_t)7);
+}
+
+static int write_all(int fd, const void *data, size_t size, uint64_t offset) {
+    const uint8_t *p = data;
+    while (size) {
+        ssize_t written = pwrite(fd, p, size, offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return CACHE_ERR_IO;
+        p += written;
+        size -= written;
+        offset += written;
+    }
+    return CACHE_OK;
+}
+
+static int read_all(int fd, void *data, size_t size, uint64_t offset) {
+    uint8_t *p = data;
+    while (size) {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return CACHE_ERR_IO;
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return CACHE_OK;
+}
+
+/**
+ * @brief Write a blob to a data file
+ *
+ * @param fd data file
+ * @param offset offset to write the blob at
+ * @param header header of the blob
+ * @param data blob
+ * @return int CACHE_OK on success, CACHE_ERR_IO otherwise
+ */
+static int write_blob(int fd, uint64_t offset, const blob_header *header, const void *data) {
+    static const uint8_t padding[8];
+    size_t padsize = blob_bytes(header->size) - sizeof(blob_header) - header->size;
+
+    if (write_all(fd, header, sizeof(blob_header), offset) || write_all(fd, data, header->size, offset + sizeof(blob_header)) ||
+        write_all(fd, padding, padsize, offset + sizeof(blob_header) + header->size)) {
+        return CACHE_ERR_IO;
+    }
+    return CACHE_OK;
+}
+
+/**
+ * @brief Check that the header of a blob in the data file is the one of its
+ * entry
+ */
+static inline bool blob_matches(const blob_header *header, const cache_entry *entry) {
+    return header->digest.lo == entry->digest.lo && header->digest.hi == entry->digest.hi && header->kind == entry->kind && header->size == entry->size;
+}
+
+/**
+ * @brief Read a blob of the data file into a buffer
+ *
+ * @param c cache
+ * @param entry entry of the blob
+ * @param out buffer to append the blob to
+ * @return bool true if the blob was read and has the header of the entry
+ */
+static bool read_blob(const cache *c, const cache_entry *entry, outbuf *out) {
+    blob_header header;
+
+    outbuf_reserve(out, entry->size);
+    if (entry->offset + blob_bytes(entry->size) <= c->map_size) {
+        memcpy(&header, c->map + entry->offset, sizeof(header));
+        memcpy(out->data + out->length, c->map + entry->offset + sizeof(header), entry->size);
+    } else if (read_all(c->datafd, &header, sizeof(header), entry->offset) ||
+               read_all(c->datafd, out->data + out->length, entry->size, entry->offset + sizeof(header))) {
+        return false;
+    }
+    if (!blob_matches(&header, entry)) {
+        return false;
+    }
+    out->length += entry->size;
+    out->data[out->length] = '\0';
+    return true;
+}
+
+/**
+ * @brief Build the path of a file in the cache directory
+ *
+ * @return char* path to release with free(), NULL if memory allocation failed
+ */
+static char *cache_path(const cache *c, const char *name) {
+    size_t size = strlen(c->dir) + strlen(name) + 2;
+    char *path = malloc(size);
+    if (path) snprintf(path, size, "%s/%s", c->dir, name);
+    return path;
+}
+
+static int64_t realtime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Load the index of the cache
+ *
+ * @param c cache with an open data file
+ * @return bool true if the index was loaded, false if it is missing or does
+ * not belong to the data file
+ */
+static bool load_index(cache *c) {
+    char *path = cache_path(c, "index");
+    int fd = path ? open(path, O_RDONLY) : -1;
+    struct stat s;
+    index_header header;
+    data_header dataheader;
+    bool loaded = false;
+
+    free(path);
+    if (fd == -1) return false;
+    if (fstat(fd, &s) || read_all(fd, &header, sizeof(header), 0) || memcmp(header.magic, INDEX_MAGIC, sizeof(header.magic)) ||
+        header.num_entries > SIZE_MAX / sizeof(cache_entry) || header.num_identities > SIZE_MAX / sizeof(cache_identity) ||
+        (uint64_t)s.st_size != sizeof(header) + header.num_entries * sizeof(cache_entry) + header.num_identities * sizeof(cache_identity)) {
+        close(fd);
+        return false;
+    }
+
+    // The data file is replaced before the index when it is compacted
+    if (read_all(c->datafd, &dataheader, sizeof(dataheader), 0) || memcmp(dataheader.magic, DATA_MAGIC, sizeof(dataheader.magic)) ||
+        dataheader.generation != header.generation || fstat(c->datafd, &s) || (uint64_t)s.st_size < header.data_size) {
+        close(fd);
+        return false;
+    }
+
+    c->entries = malloc(header.num_entries * sizeof(cache_entry) + 1);
+    c->identities = malloc(header.num_identities * sizeof(cache_identity) + 1);
+    if (c->entries && c->identities && !read_all(fd, c->entries, header.num_entries * sizeof(cache_entry), sizeof(header)) &&
+        !read_all(fd, c->identities, header.num_identities * sizeof(cache_identity), sizeof(header) + header.num_entries * sizeof(cache_entry))) {
+        loaded = true;
+        c->num_entries = c->max_entries = header.num_entries;
+        c->num_identities = c->max_identities = header.num_identities;
+        for (size_t i = 0; i < c->num_entries; i++) {
+            const cache_entry *entry = &c->entries[i];
+            if (entry->offset < sizeof(data_header) || entry->size > header.data_size || blob_bytes(entry->size) > header.data_size ||
+                entry->offset > header.data_size - blob_bytes(entry->size)) {
+                loaded = false;
+            }
+        }
+    }
+    close(fd);
+
+    if (loaded && !table_rebuild(&c->entry_table, c->num_entries, c->entries, sizeof(cache_entry), entry_hash) &&
+        !table_rebuild(&c->identity_table, c->num_identities, c->identities, sizeof(cache_identity), identity_hash)) {
+        c->generation = header.generation;
+        c->data_size = header.data_size;
+        c->run = header.run + 1;
+        return true;
+    }
+
+    free(c->entries);
+    free(c->identities);
+    c->entries = NULL;
+    c->identities = NULL;
+    c->num_entries = c->max_entries = c->num_identities = c->max_identities = 0;
+    return false;
+}
+
+/**
+ * @brief Start a new data file
+ *
+ * @param fd data file
+ * @param generation generation of the data file
+ * @return int CACHE_OK on success, CACHE_ERR_IO otherwise
+ */
+static int init_data(int fd, uint64_t generation) {
+    data_header header = {DATA_MAGIC, generation};
+
+    if (ftruncate(fd, 0) || write_all(fd, &header, sizeof(header), 0)) return CACHE_ERR_IO;
+    return CACHE_OK;
+}
+
+static uint64_t new_generation(void) {
+    return avalanche((uint64_t)realtime_ns() ^ (uint64_t)getpid() << 32);
+}
+
+int cache_open(const char *dir, const cache_limits *limits, cache **result) {
+    cache *c = calloc(1, sizeof(cache));
+    char *path;
+
+    if (!c || !(c->dir = strdup(dir))) {
+        free(c);
+        return CACHE_ERR_NOMEM;
+    }
+    c->lockfd = c->datafd = -1;
+    c->limits = *limits;
+    c->racy_ns = realtime_ns() - (int64_t)RACY_SECONDS * 1000000000;
+    pthread_mutex_init(&c->lock, NULL);
+
+    if (mkdir(dir, 0777) && errno != EEXIST) goto io_error;
+
+    if (!(path = cache_path(c, "lock"))) goto nomem;
+    c->lockfd = open(path, O_RDWR | O_CREAT, 0666);
+    free(path);
+    if (c->lockfd == -1) goto io_error;
+    if (flock(c->lockfd, LOCK_EX | LOCK_NB)) {
+        int status = errno == EWOULDBLOCK ? CACHE_ERR_LOCKED : CACHE_ERR_IO;
+        cache_close(c, NULL);
+        return status;
+    }
+
+    if (!(path = cache_path(c, "data"))) goto nomem;
+    c->datafd = open(path, O_RDWR | O_CREAT, 0666);
+    free(path);
+    if (c->datafd == -1) goto io_error;
+
+    // Blobs appended by a run that did not write its index are dropped
+    if (load_index(c)) {
+        if (ftruncate(c->datafd, c->data_size)) goto io_error;
+    } else {
+        c->generation = new_generation();
+        c->data_size = sizeof(data_header);
+        c->run = 1;
+        if (init_data(c->datafd, c->generation)) goto io_error;
+    }
+
+    void *map = mmap(NULL, c->data_size, PROT_READ, MAP_SHARED, c->datafd, 0);
+    if (map == MAP_FAILED) goto io_error;
+    c->map = map;
+    c->map_size = c->data_size;
+
+    *result = c;
+    return CACHE_OK;
+
+nomem:
+    cache_close(c, NULL);
+    return CACHE_ERR_NOMEM;
+io_error:
+    cache_close(c, NULL);
+    return CACHE_ERR_IO;
+}
+
+int cache_identify(cache *c, const char *path, cache_input *input) {
+    cache_identity identity = {0};
+    struct stat s;
+    bool found;
+
+    memset(input, 0, sizeof(*input));
+    if (stat(path, &s)) return CACHE_ERR_IO;
+    identity.dev = s.st_dev;
+    identity.ino = s.st_ino;
+    identity.size = s.st_size;
+    identity.mtime_ns = (int64_t)s.st_mtim.tv_sec * 1000000000 + s.st_mtim.tv_nsec;
+
+    pthread_mutex_lock(&c->lock);
+    found = find_identity(c, &identity);
+    if (found) c->stats.identity_hits++;
+    pthread_mutex_unlock(&c->lock);
+    if (found) {
+        input->digest = identity.digest;
+        input->size = identity.size;
+        return CACHE_OK;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return CACHE_ERR_IO;
+    if (fstat(fd, &s)) {
+        close(fd);
+        return CACHE_ERR_IO;
+    }
+    identity.dev = s.st_dev;
+    identity.ino = s.st_ino;
+    identity.size = s.st_size;
+    identity.mtime_ns = (int64_t)s.st_mtim.tv_sec * 1000000000 + s.st_mtim.tv_nsec;
+
+    // An empty file can not be mapped
+    if (s.st_size) {
+        void *mapped = mmap(NULL, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            return CACHE_ERR_IO;
+        }
+        input->data = mapped;
+        input->size = s.st_size;
+    }
+    close(fd);
+    cache_digest_bytes(input->data, input->size, &input->digest);
+    identity.digest = input->digest;
+
+    pthread_mutex_lock(&c->lock);
+    c->stats.identity_misses++;
+    c->stats.bytes_hashed += input->size;
+    if (S_ISREG(s.st_mode) && identity.mtime_ns < c->racy_ns) {
+        cache_identity existing = identity;
+        // Another thread may have added the file in the meantime
+        if (!find_identity(c, &existing)) add_identity(c, &identity);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return CACHE_OK;
+}
+
+void cache_release_input(cache_input *input) {
+    if (input->data) munmap((void *)input->data, input->size);
+    memset(input, 0, sizeof(*input));
+}
+
+bool cache_get(cache *c, const cache_digest *digest, uint64_t kind, outbuf *out) {
+    cache_entry entry;
+    long index;
+
+    pthread_mutex_lock(&c->lock);
+    index = find_entry(c, digest, kind, false);
+    if (index >= 0) {
+        c->entries[index].run = c->run;
+        entry = c->entries[index];
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    // The data of the blobs does not change while the cache is open
+    bool found = index >= 0 && read_blob(c, &entry, out);
+    pthread_mutex_lock(&c->lock);
+    if (found) {
+        c->stats.hits++;
+    } else {
+        c->stats.misses++;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return found;
+}
+
+const void *cache_map(cache *c, const cache_digest *digest, uint64_t kind, size_t *size) {
+    const void *blob = NULL;
+    cache_entry entry;
+    long index;
+
+    pthread_mutex_lock(&c->lock);
+    index = find_entry(c, digest, kind, false);
+    if (index >= 0) {
+        c->entries[index].run = c->run;
+        entry = c->entries[index];
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    if (index >= 0 && entry.offset + blob_bytes(entry.size) <= c->map_size) {
+        blob_header header;
+        memcpy(&header, c->map + entry.offset, sizeof(header));
+        if (blob_matches(&header, &entry)) {
+            blob = c->map + entry.offset + sizeof(header);
+            *size = entry.size;
+        }
+    }
+    pthread_mutex_lock(&c->lock);
+    if (blob) {
+        c->stats.hits++;
+    } else {
+        c->stats.misses++;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return blob;
+}
+
+int cache_put(cache *c, const cache_digest *digest, uint64_t kind, const void *data, size_t size) {
+    cache_entry entry = {*digest, kind, 0, size, 0};
+    blob_header header = {*digest, kind, size};
+    int status;
+
+    pthread_mutex_lock(&c->lock);
+    if ((status = c->status) != CACHE_OK || find_entry(c, digest, kind, false) >= 0) {
+        pthread_mutex_unlock(&c->lock);
+        return status;
+    }
+    entry.offset = c->data_size;
+    entry.run = c->run;
+    if ((status = write_blob(c->datafd, entry.offset, &header, data)) == CACHE_OK && (status = add_entry(c, &entry)) == CACHE_OK) {
+        c->data_size += blob_bytes(size);
+        c->stats.stores++;
+    } else {
+        c->status = status;
+    }
+    pthread_mutex_unlock(&c->lock);
+    return status;
+}
+
+/**
+ * @brief Order entries by the last run they were used in, most recent first,
+ * and by their offset, latest first
+ */
+static int compare_recency(const void *a, const void *b) {
+    const cache_entry *x = a, *y = b;
+    if (x->run != y->run) return x->run < y->run ? 1 : -1;
+    return x->offset < y->offset ? 1 : x->offset > y->offset ? -1 : 0;
+}
+
+/**
+ * @brief Order entries by their offset
+ */
+static int compare_offset(const void *a, const void *b) {
+    const cache_entry *x = a, *y = b;
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+/**
+ * @brief Evict the least recently used blobs, if a limit is exceeded, and
+ * write the remaining blobs to a new data file
+ *
+ * @param c cache
+ * @return int CACHE_OK on success, one of CACHE_ERR_* otherwise
+ */
+static int evict(cache *c) {
+    uint64_t bytes = 0;
+    size_t keep = 0;
+
+    for (size_t i = 0; i < c->num_entries; i++) {
+        bytes += blob_bytes(c->entries[i].size);
+    }
+    if ((!c->limits.max_bytes || bytes <= c->limits.max_bytes) && (!c->limits.max_entries || c->num_entries <= c->limits.max_entries)) {
+        return CACHE_OK;
+    }
+
+    uint64_t maxbytes = c->limits.max_bytes / 100 * EVICT_PERCENT;
+    uint64_t maxentries = c->limits.max_entries / 100 * EVICT_PERCENT;
+    qsort(c->entries, c->num_entries, sizeof(cache_entry), compare_recency);
+    bytes = 0;
+    while (keep < c->num_entries && (!c->limits.max_entries || keep < maxentries) &&
+           (!c->limits.max_bytes || bytes + blob_bytes(c->entries[keep].size) <= maxbytes)) {
+        bytes += blob_bytes(c->entries[keep++].size);
+    }
+    c->stats.evictions += c->num_entries - keep;
+    c->num_entries = keep;
+
+    // Copy the remaining blobs in the order of the old file
+    qsort(c->entries, c->num_entries, sizeof(cache_entry), compare_offset);
+    char *path = cache_path(c, "data.tmp");
+    char *datapath = cache_path(c, "data");
+    int fd = path && datapath ? open(path, O_RDWR | O_CREAT | O_TRUNC, 0666) : -1;
+    uint64_t generation = new_generation();
+    uint64_t offset = sizeof(data_header);
+    outbuf blob = {0};
+    int status = fd == -1 ? CACHE_ERR_IO : init_data(fd, generation);
+
+    for (size_t i = 0; status == CACHE_OK && i < c->num_entries; i++) {
+        cache_entry *entry = &c->entries[i];
+        blob_header header = {entry->digest, entry->kind, entry->size};
+
+        blob.length = 0;
+        if (!read_blob(c, entry, &blob)) {
+            status = CACHE_ERR_IO;
+        } else if ((status = write_blob(fd, offset, &header, blob.data)) == CACHE_OK) {
+            entry->offset = offset;
+            offset += blob_bytes(entry->size);
+        }
+    }
+    free(blob.data);
+    if (fd != -1 && close(fd)) status = CACHE_ERR_IO;
+    if (status == CACHE_OK && rename(path, datapath)) status = CACHE_ERR_IO;
+    if (status != CACHE_OK && path) unlink(path);
+    free(path);
+    free(datapath);
+    if (status != CACHE_OK) return status;
+
+    c->generation = generation;
+    c->data_size = offset;
+    if ((status = table_rebuild(&c->entry_table, c->num_entries, c->entries, sizeof(cache_entry), entry_hash)) != CACHE_OK) return status;
+
+    // Identities are kept as long as a blob of their input is
+    size_t identities = 0;
+    for (size_t i = 0; i < c->num_identities; i++) {
+        if (find_entry(c, &c->identities[i].digest, 0, true) >= 0) {
+            c->identities[identities++] = c->identities[i];
+        }
+    }
+    c->num_identities = identities;
+    return CACHE_OK;
+}
+
+/**
+ * @brief Write the index of the cache, replacing the old one
+ *
+ * @param c cache
+ * @return int CACHE_OK on success, one of CACHE_ERR_* otherwise
+ */
+static int write_index(const cache *c) {
+    index_header header = {INDEX_MAGIC, c->generation, c->data_size, c->run, c->num_entries, c->num_identities};
+    char *path = cache_path(c, "index.tmp");
+    char *indexpath = cache_path(c, "index");
+    int fd = path && indexpath ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666) : -1;
+    int status = fd == -1 ? CACHE_ERR_IO : CACHE_OK;
+
+    if (status == CACHE_OK && (write_all(fd, &header, sizeof(header), 0) || write_all(fd, c->entries, c->num_entries * sizeof(cache_entry), sizeof(header)) ||
+                               write_all(fd, c->identities, c->num_identities * sizeof(cache_identity), sizeof(header) + c->num_entries * sizeof(cache_entry)))) {
+        status = CACHE_ERR_IO;
+    }
+    if (fd != -1 && close(fd)) status = CACHE_ERR_IO;
+    if (status == CACHE_OK && rename(path, indexpath)) status = CACHE_ERR_IO;
+    if (status != CACHE_OK && path) unlink(path);
+    free(path);
+    free(indexpath);
+    return status;
+}
+
+int cache_close(cache *c, cache_stats *stats) {
+    int status = c->status;
+
+    // A cache that failed to open is only released
+    if (c->map) {
+        if (status == CACHE_OK) status = evict(c);
+        if (status == CACHE_OK) status = write_index(c);
+        munmap((void *)c->map, c->map_size);
+    }
+    if (stats) *stats = c->stats;
+    if (c->datafd != -1) close(c->datafd);
+    if (c->lockfd != -1) close(c->lockfd);
+    pthread_mutex_destroy(&c->lock);
+    free(c->entries);
+    free(c->entry_table.slots);
+    free(c->identities);
+    free(c->identity_table.slots);
+    free(c->dir);
+    free(c);
+    return status;
+}
+
+#else
+
+int cache_open(const char *dir, const cache_limits *limits, cache **result) {
+    return CACHE_ERR_UNSUPPORTED;
+}
+
+int cache_close(cache *c, cache_stats *stats) {
+    return CACHE_ERR_UNSUPPORTED;
+}
+
+int cache_identify(cache *c, const char *path, cache_input *input) {
+    return CACHE_ERR_UNSUPPORTED;
+}
+
+void cache_release_input(cache_input *input) {
+}
+
+bool cache_get(cache *c, const cache_digest *digest, uint64_t kind, outbuf *out) {
+    return false;
+}
+
+const void *cache_map(cache *c, const cache_digest *digest, uint64_t kind, size_t *size) {
+    return NULL;
+}
+
+int cache_put(cache *c, const cache_digest *digest, uint64_t kind, const void *data, size_t size) {
+    return CACHE_ERR_UNSUPPORTED;
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "outbuf.h"
+
+/* Status codes returned by the cache functions */
+
+#define CACHE_OK 0
+/** The cache directory or its files can not be read or written */
+#define CACHE_ERR_IO 1
+/** The cache is used by another process */
+#define CACHE_ERR_LOCKED 2
+/** Memory allocation failed */
+#define CACHE_ERR_NOMEM 3
+/** Caching is not supported on this platform */
+#define CACHE_ERR_UNSUPPORTED 4
+
+/**
+ * Digest of the contents of an input. Computed with a fast 128-bit hash,
+ * which is not cryptographic: inputs crafted to collide would share their
+ * cached entries.
+ */
+typedef struct cache_digest {
+    uint64_t lo;
+    uint64_t hi;
+} cache_digest;
+
+/** Size limits of a cache, 0 for no limit */
+typedef struct cache_limits {
+    /** Total size of the cached entries in bytes */
+    uint64_t max_bytes;
+    /** Number of cached entries */
+    uint64_t max_entries;
+} cache_limits;
+
+/** Counters of a cache since it was opened */
+typedef struct cache_stats {
+    /** Inputs whose digest was taken from the index, as their size, mtime and
+     * inode did not change */
+    uint64_t identity_hits;
+    /** Inputs that were read and hashed */
+    uint64_t identity_misses;
+    /** Bytes read and hashed */
+    uint64_t bytes_hashed;
+    /** Lookups that found an entry */
+    uint64_t hits;
+    /** Lookups that found no entry */
+    uint64_t misses;
+    /** Entries added */
+    uint64_t stores;
+    /** Entries removed to stay within the limits */
+    uint64_t evictions;
+} cache_stats;
+
+/**
+ * An input identified by the digest of its contents. If the input had to be
+ * hashed, it stays mapped into memory so it can be parsed without reading it
+ * again.
+ */
+typedef struct cache_input {
+    /** Digest of the contents */
+    cache_digest digest;
+    /** Contents of the input, NULL if the digest was taken from the index */
+    const void *data;
+    /** Size of the input in bytes */
+    size_t size;
+} cache_input;
+
+/**
+ * A persistent cache of blobs, such as the records printed for inputs, keyed
+ * by the digest of an input and a kind telling apart the blobs derived from
+ * the same input.
+ *
+ * A cache is a directory holding a data file, to which blobs are appended and
+ * which is mapped into memory, and an index of the blobs, read when the cache
+ * is opened and written when it is closed. The index also maps the device,
+ * inode, size and modification time of inputs to their digests, so unchanged
+ * inputs are not read again. Every open counts as a run, and blobs remember
+ * the last run that used them. When a limit is exceeded, the least recently
+ * used blobs are evicted down to 80% of the limits and the data file is
+ * compacted.
+ *
+ * A cache is locked by one process at a time, and can be used by several
+ * threads of that process. Blobs added by a run that crashed are dropped,
+ * and if a run crashed while compacting, the cache starts out empty.
+ */
+typedef struct cache cache;
+
+/**
+ * @brief Open a cache, creating its directory if it does not exist
+ *
+ * @param dir cache directory
+ * @param limits size limits
+ * @param result set to the cache
+ * @return int CACHE_OK on success, one of CACHE_ERR_* otherwise
+ */
+int cache_open(const char *dir, const cache_limits *limits, cache **result);
+
+/**
+ * @brief Close a cache, evicting blobs to stay within its limits and writing
+ * its index
+ *
+ * @param c cache, released even if writing fails
+ * @param stats set to the counters of the cache, NULL to ignore them
+ * @return int CACHE_OK on success, one of CACHE_ERR_* if the cache could not
+ * be written, during this call or when a blob was added
+ */
+int cache_close(cache *c, cache_stats *stats);
+
+/**
+ * @brief Hash bytes into a digest
+ *
+ * @param data bytes to hash
+ * @param size number of bytes
+ * @param digest set to the digest
+ */
+void cache_digest_bytes(const void *data, size_t size, cache_digest *digest);
+
+/**
+ * @brief Identify an input file by the digest of its contents
+ *
+ * The digest is taken from the index if the device, inode, size and
+ * modification time of the file are the ones it was last hashed with.
+ * Otherwise the file is mapped into memory and hashed, and the index updated,
+ * unless the file was modified too recently to tell later modifications
+ * apart by their time.
+ *
+ * @param c cache
+ * @param path path of the input file
+ * @param input set to the identified input, release with
+ * cache_release_input()
+ * @return int CACHE_OK on success, CACHE_ERR_IO if the file can not be read
+ */
+int cache_identify(cache *c, const char *path, cache_input *input);
+
+/**
+ * @brief Release an input identified with cache_identify()
+ *
+ * @param input input to release
+ */
+void cache_release_input(cache_input *input);
+
+/**
+ * @brief Look up a blob
+ *
+ * @param c cache
+ * @param digest digest of the input
+ * @param kind kind of the blob
+ * @param out buffer to append the blob to
+ * @return bool true if the blob was found
+ */
+bool cache_get(cache *c, const cache_digest *digest, uint64_t kind, outbuf *out);
+
+/**
+ * @brief Look up a blob in the data file mapped into memory, without copying
+ * it
+ *
+ * Blobs start at a multiple of 8 bytes. Blobs added since the cache was
+ * opened are not mapped yet and are not found.
+ *
+ * @param c cache
+ * @param digest digest of the input
+ * @param kind kind of the blob
+ * @param size set to the size of the blob
+ * @return const void* blob, valid until the cache is closed, NULL if not
+ * found
+ */
+const void *cache_map(cache *c, const cache_digest *digest, uint64_t kind, size_t *size);
+
+/**
+ * @brief Add a blob, unless one with the same digest and kind exists
+ *
+ * @param c cache
+ * @param digest digest of the input
+ * @param kind kind of the blob
+ * @param data blob
+ * @param size size of the blob in bytes
+ * @return int CACHE_OK on success, one of CACHE_ERR_* otherwise. After an
+ * error no more blobs are added.
+ */
+int cache_put(cache *c, const cache_digest *digest, uint64_t kind, const void *data, size_t size);
+
+/**
+ * @brief Get a description of a cache status code
+ *
+ * @param status status code
+ * @return const char* description
+ */
+const char *cache_strerror(int status);
+
+#endif
@@ -0,0 +1,259 @@
+#include <string.h>
+#include <strings.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "codepage.h"
+
+/** Bytes with the high bit set, in every byte of a 64-bit word */
+#define HIGH_BITS 0x8080808080808080ULL
+/** 0x20 in every byte of a 64-bit word */
+#define SPACES 0x2020202020202020ULL
+/** Replacement character for invalid sequences, U+FFFD in UTF-8 */
+#define REPLACEMENT "\xEF\xBF\xBD"
+/** Score of an invalid sequence during detection */
+#define SCORE_INVALID -4
+
+const char *codepage_name(codepage cp) {
+    return CODEPAGE_TABLES[cp].name;
+}
+
+bool codepage_from_name(const char *name, codepage *cp) {
+    // The CP prefix is optional
+    if (!strncasecmp(name, "CP", 2)) name += 2;
+    for (int i = 0; i < NUM_CODEPAGES; i++) {
+        if (!strcasecmp(name, CODEPAGE_TABLES[i].name + 2)) {
+            *cp = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t codepage_ascii_span(const char *str, size_t len) {
+    const uint8_t *src = (const uint8_t *)str;
+    size_t i = 0;
+
+    // Signed comparison, bytes from 0x80 are negative and compare below 0x20
+#if defined(__AVX2__)
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), v));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    // The remaining bytes are checked with one vector ending at the end of
+    // the string, instead of a loop whose length varies from string to
+    // string. The bytes it shares with the ones before passed already.
+    if (len >= 16) {
+        if (i == len) return len;
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + len - 16));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)));
+        return mask ? len - 16 + __builtin_ctz(mask) : len;
+    }
+    if (len >= 8) {
+        // The first and the last 8 bytes, which overlap unless len is 16
+        __m128i v = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)src), _mm_loadl_epi64((const __m128i *)(src + len - 8)));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(0x20)));
+        if (!mask) return len;
+        return mask & 0xFF ? (size_t)__builtin_ctz(mask) : len - 8 + __builtin_ctz(mask >> 8);
+    }
+#endif
+    // A borrow out of a byte below 0x20 can flag the next byte as well, the
+    // byte loop below finds the exact position
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, src + i, sizeof(w));
+        if ((w | (w - SPACES)) & HIGH_BITS) break;
+    }
+    while (i < len && src[i] >= 0x20 && src[i] < 0x80) i++;
+    return i;
+}
+
+/**
+ * @brief Copy the run of ASCII bytes at the start of a string
+ *
+ * Whole vectors are stored even if the run ends within them, the bytes past
+ * the run are overwritten by the caller. This needs at least 3x the remaining
+ * input length of room in dst, which converted strings have.
+ *
+ * @param src string
+ * @param len length of src
+ * @param dst buffer to copy to, NULL to only measure the run
+ * @return size_t length of the run
+ */
+static size_t copy_ascii(const uint8_t *src, size_t len, char *dst) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        uint32_t mask = _mm256_movemask_epi8(v);
+        if (dst) _mm256_storeu_si256((__m256i *)(dst + i), v);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        uint32_t mask = _mm_movemask_epi8(v);
+        if (dst) _mm_storeu_si128((__m128i *)(dst + i), v);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, src + i, sizeof(w));
+        if (w & HIGH_BITS) break;
+        if (dst) memcpy(dst + i, &w, sizeof(w));
+    }
+    for (; i < len && src[i] < 0x80; i++) {
+        if (dst) dst[i] = src[i];
+    }
+    return i;
+}
+
+/**
+ * @brief Decode the character at the start of a string that is not ASCII
+ *
+ * @param table table of the codepage
+ * @param src string, starting with a byte from 0x80
+ * @param len length of src
+ * @param c set to the character, 0 if the sequence is not valid
+ * @return size_t length of the sequence, 1 for invalid sequences
+ */
+static inline size_t decode_char(const codepage_table *table, const uint8_t *src, size_t len, uint16_t *c) {
+    *c = table->high[src[0] - 0x80];
+    if (*c != CODEPAGE_LEAD) return 1;
+    if (len < 2 || src[1] < CODEPAGE_TRAIL_MIN || src[1] > CODEPAGE_TRAIL_MAX) {
+        *c = 0;
+        return 1;
+    }
+    *c = table->dbcs[(table->rows[src[0] - 0x80] - 1) * CODEPAGE_ROW_SIZE + src[1] - CODEPAGE_TRAIL_MIN];
+    return *c ? 2 : 1;
+}
+
+/**
+ * @brief Convert a string to UTF-8
+ *
+ * @param cp codepage of in
+ * @param in string to convert
+ * @param len length of in
+ * @param out buffer for the UTF-8 string, at least 3x len bytes, or NULL
+ * @param lossy true to replace invalid sequences with U+FFFD, false to fail
+ * @return ssize_t length of the UTF-8 string, -1 if the string is not valid
+ */
+static ssize_t convert(codepage cp, const char *in, size_t len, char *out, bool lossy) {
+    const codepage_table *table = &CODEPAGE_TABLES[cp];
+    const uint8_t *src = (const uint8_t *)in;
+    char *dst = out;
+    size_t i = 0;
+
+    while (i < len) {
+        size_t run = copy_ascii(src + i, len - i, dst);
+        i += run;
+        if (dst) dst += run;
+        if (i == len) break;
+
+        uint16_t c;
+        i += decode_char(table, src + i, len - i, &c);
+        if (!c) {
+            if (!lossy) return -1;
+            if (dst) {
+                memcpy(dst, REPLACEMENT, 3);
+                dst += 3;
+            }
+            continue;
+        }
+
+        if (!dst) continue;
+        if (c < 0x80) {
+            *dst++ = c;
+        } else if (c < 0x800) {
+            *dst++ = 0xC0 | c >> 6;
+            *dst++ = 0x80 | (c & 0x3F);
+        } else {
+            *dst++ = 0xE0 | c >> 12;
+            *dst++ = 0x80 | (c >> 6 & 0x3F);
+            *dst++ = 0x80 | (c & 0x3F);
+        }
+    }
+    return out ? dst - out : 0;
+}
+
+ssize_t codepage_to_utf8(codepage cp, const char *in, size_t len, char *out) {
+    return convert(cp, in, len, out, false);
+}
+
+size_t codepage_to_utf8_lossy(codepage cp, const char *in, size_t len, char *out) {
+    return convert(cp, in, len, out, true);
+}
+
+/**
+ * @brief Check whether a character is a letter of a script that is not
+ * written mixed with ASCII letters within a word
+ */
+static inline bool is_cyrillic(uint16_t c) {
+    return c >= 0x0400 && c <= 0x04FF;
+}
+
+/**
+ * @brief Score how likely a decoded character is part of text
+ *
+ * @param c character
+ * @return int 2 for CJK characters and Hangul, 1 for letters, 0 for half-width
+ * katakana, -1 for symbols, punctuation, control and private use characters
+ */
+static int char_score(uint16_t c) {
+    if ((c >= 0x4E00 && c <= 0x9FFF) || (c >= 0x3000 && c <= 0x30FF) || (c >= 0xAC00 && c <= 0xD7A3) || (c >= 0xFF01 && c <= 0xFF5E)) return 2;
+    if ((c >= 0x00C0 && c <= 0x024F && c != 0x00D7 && c != 0x00F7) || (c >= 0x0370 && c <= 0x04FF)) return 1;
+    if (c >= 0xFF61 && c <= 0xFF9F) return 0;
+    return -1;
+}
+
+static inline bool is_ascii_letter(uint8_t byte) {
+    return (byte | 0x20) >= 'a' && (byte | 0x20) <= 'z';
+}
+
+long codepage_score(codepage cp, const char *in, size_t len) {
+    const codepage_table *table = &CODEPAGE_TABLES[cp];
+    const uint8_t *src = (const uint8_t *)in;
+    bool prev_letter = false, prev_cyrillic = false;
+    long score = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        if (src[i] < 0x80) {
+            bool letter = is_ascii_letter(src[i]);
+            // A Cyrillic letter right before an ASCII letter gets no score
+            if (letter && prev_cyrillic) score--;
+            prev_letter = letter;
+            prev_cyrillic = false;
+            i++;
+            continue;
+        }
+
+        uint16_t c;
+        i += decode_char(table, src + i, len - i, &c);
+        if (!c) {
+            score += SCORE_INVALID;
+            prev_letter = prev_cyrillic = false;
+            continue;
+        }
+        // Neither does a Cyrillic letter right after an ASCII letter
+        score += is_cyrillic(c) && prev_letter ? 0 : char_score(c);
+        prev_cyrillic = is_cyrillic(c) && !prev_letter;
+        prev_letter = false;
+    }
+    return score;
+}
@@ -0,0 +1,126 @@
+#ifndef CODEPAGE_H
+#define CODEPAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** Codepages with built-in transcoding tables */
+typedef enum codepage {
+    /** Japanese, Shift JIS */
+    CODEPAGE_932,
+    /** Cyrillic */
+    CODEPAGE_1251,
+    /** Western European */
+    CODEPAGE_1252,
+    /** Simplified Chinese, GBK */
+    CODEPAGE_936,
+    /** Korean, Unified Hangul Code */
+    CODEPAGE_949,
+    /** Traditional Chinese, Big5 */
+    CODEPAGE_950,
+    NUM_CODEPAGES
+} codepage;
+
+/** Value of a lead byte of a double byte character in codepage_table.high */
+#define CODEPAGE_LEAD 0xFFFF
+/** First trail byte of a double byte character */
+#define CODEPAGE_TRAIL_MIN 0x40
+/** Last trail byte of a double byte character */
+#define CODEPAGE_TRAIL_MAX 0xFE
+/** Number of characters in a row of codepage_table.dbcs */
+#define CODEPAGE_ROW_SIZE (CODEPAGE_TRAIL_MAX - CODEPAGE_TRAIL_MIN + 1)
+
+/** Transcoding table of a codepage, generated by tools/gen_codepages.py */
+typedef struct codepage_table {
+    /** Name such as "CP932" */
+    const char *name;
+    /** Character of each byte from 0x80 to 0xFF, CODEPAGE_LEAD for lead bytes,
+     * 0 if the byte is not defined */
+    const uint16_t *high;
+    /** Row in dbcs plus 1 of each lead byte from 0x80 to 0xFF, NULL for single
+     * byte codepages */
+    const uint8_t *rows;
+    /** Character of each double byte sequence, one row of CODEPAGE_ROW_SIZE
+     * characters per lead byte. 0 if the sequence is not defined */
+    const uint16_t *dbcs;
+} codepage_table;
+
+extern const codepage_table CODEPAGE_TABLES[NUM_CODEPAGES];
+
+/**
+ * @brief Get the name of a codepage
+ *
+ * @param cp codepage
+ * @return const char* name such as "CP932"
+ */
+const char *codepage_name(codepage cp);
+
+/**
+ * @brief Look up a codepage by name
+ *
+ * @param name name such as "CP932", "cp932" or "932"
+ * @param cp set to the codepage
+ * @return bool false if there is no built-in table for the codepage
+ */
+bool codepage_from_name(const char *name, codepage *cp);
+
+/**
+ * @brief Count the bytes at the start of a string that are printable ASCII,
+ * 0x20 to 0x7F
+ *
+ * The string is scanned 16 or 32 bytes at a time where SIMD is available.
+ *
+ * @param str string
+ * @param len length of str
+ * @return size_t number of printable ASCII bytes before the first other byte,
+ * len if the string is printable ASCII
+ */
+size_t codepage_ascii_span(const char *str, size_t len);
+
+/**
+ * @brief Convert a string to UTF-8
+ *
+ * Runs of ASCII are copied 16 or 32 bytes at a time where SIMD is available.
+ *
+ * @param cp codepage of in
+ * @param in string to convert
+ * @param len length of in
+ * @param out buffer for the UTF-8 string, at least 3x len bytes. NULL to only
+ * check that the string is valid in the codepage
+ * @return ssize_t length of the UTF-8 string, not terminated, -1 if the string
+ * is not valid in the codepage
+ */
+ssize_t codepage_to_utf8(codepage cp, const char *in, size_t len, char *out);
+
+/**
+ * @brief Convert a string to UTF-8, replacing sequences that are not valid in
+ * the codepage with U+FFFD
+ *
+ * @param cp codepage of in
+ * @param in string to convert
+ * @param len length of in
+ * @param out buffer for the UTF-8 string, at least 3x len bytes
+ * @return size_t length of the UTF-8 string, not terminated
+ */
+size_t codepage_to_utf8_lossy(codepage cp, const char *in, size_t len, char *out);
+
+/**
+ * @brief Score how well a string reads as text in a codepage
+ *
+ * Every character that is not ASCII adds to the score by how common it is in
+ * text: CJK characters and Hangul the most, then letters, while symbols,
+ * private use characters and invalid sequences lower the score. Cyrillic
+ * letters directly next to ASCII letters do not count, as Latin text decoded
+ * as CP1251 gives words that mix both. Scores of the strings of a file are
+ * summed up to pick its codepage.
+ *
+ * @param cp codepage
+ * @param in string
+ * @param len length of in
+ * @return long score, higher is more likely
+ */
+long codepage_score(codepage cp, const char *in, size_t len);
+
+#endif
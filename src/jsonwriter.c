@@ -0,0 +1,438 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "jsonwriter.h"
+#include "readbytes.h"
+
+/** Escape of each byte in a JSON string: 0 if the byte is copied as is, the
+ * character after the backslash otherwise, 'u' for \u00XX escapes */
+static const char ESCAPES[256] = {
+    ['\b'] = 'b', ['\t'] = 't', ['\n'] = 'n', ['\f'] = 'f', ['\r'] = 'r', ['"'] = '"', ['\\'] = '\\',
+    [0x00] = 'u', [0x01] = 'u', [0x02] = 'u', [0x03] = 'u', [0x04] = 'u', [0x05] = 'u', [0x06] = 'u', [0x07] = 'u',
+    [0x0B] = 'u', [0x0E] = 'u', [0x0F] = 'u', [0x10] = 'u', [0x11] = 'u', [0x12] = 'u', [0x13] = 'u', [0x14] = 'u',
+    [0x15] = 'u', [0x16] = 'u', [0x17] = 'u', [0x18] = 'u', [0x19] = 'u', [0x1A] = 'u', [0x1B] = 'u', [0x1C] = 'u',
+    [0x1D] = 'u', [0x1E] = 'u', [0x1F] = 'u',
+};
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+void json_init(json_writer *json, outbuf *out, bool pretty) {
+    json->out = out;
+    json->pretty = pretty;
+    json->first = true;
+    json->depth = 0;
+    json->arrays = 0;
+}
+
+/**
+ * @brief Write the separator before a value. Values in objects follow their
+ * key, which already wrote the separator.
+ *
+ * @param json writer
+ */
+static inline void begin_value(json_writer *json) {
+    if (!(json->arrays & (1u << json->depth))) return;
+    if (!json->first) {
+        outbuf_reserve(json->out, 2);
+        json->out->data[json->out->length++] = ',';
+        if (json->pretty) json->out->data[json->out->length++] = ' ';
+    }
+    json->first = false;
+}
+
+/**
+ * @brief Start a line in pretty output, indented to the current depth
+ *
+ * @param json writer
+ * @param depth number of tabs
+ */
+static inline void newline(json_writer *json, int depth) {
+    outbuf_reserve(json->out, depth + 1);
+    char *dst = json->out->data + json->out->length;
+    *dst = '\n';
+    memset(dst + 1, '\t', depth);
+    json->out->length += depth + 1;
+}
+
+/**
+ * @brief Open a container
+ *
+ * @param json writer
+ * @param bracket opening bracket
+ * @param array true for arrays
+ */
+static void begin_container(json_writer *json, char bracket, bool array) {
+    begin_value(json);
+    outbuf_putc(json->out, bracket);
+    json->depth++;
+    if (array) {
+        json->arrays |= 1u << json->depth;
+    } else {
+        json->arrays &= ~(1u << json->depth);
+    }
+    json->first = true;
+}
+
+void json_begin_object(json_writer *json) {
+    begin_container(json, '{', false);
+}
+
+void json_end_object(json_writer *json) {
+    json->depth--;
+    if (json->pretty) newline(json, json->depth);
+    outbuf_putc(json->out, '}');
+    json->first = false;
+}
+
+void json_begin_array(json_writer *json) {
+    begin_container(json, '[', true);
+}
+
+void json_end_array(json_writer *json) {
+    json->depth--;
+    outbuf_putc(json->out, ']');
+    json->first = false;
+}
+
+void json_key(json_writer *json, const char *key) {
+    size_t len = strlen(key);
+
+    outbuf_reserve(json->out, len + json->depth + 6);
+    char *dst = json->out->data + json->out->length;
+    if (!json->first) *dst++ = ',';
+    if (json->pretty) {
+        *dst++ = '\n';
+        memset(dst, '\t', json->depth);
+        dst += json->depth;
+    }
+    *dst++ = '"';
+    memcpy(dst, key, len);
+    dst += len;
+    *dst++ = '"';
+    *dst++ = ':';
+    if (json->pretty) *dst++ = '\t';
+    json->out->length = dst - json->out->data;
+    json->first = false;
+}
+
+void json_string(json_writer *json, const char *str) {
+    const uint8_t *src = (const uint8_t *)str;
+    size_t len = strlen(str);
+
+    begin_value(json);
+    // Room for every byte escaped as \u00XX and the quotes
+    outbuf_reserve(json->out, len * 6 + 2);
+    char *dst = json->out->data + json->out->length;
+    *dst++ = '"';
+    for (size_t i = 0; i < len;) {
+        size_t run = i;
+        while (run < len && !ESCAPES[src[run]]) run++;
+        memcpy(dst, src + i, run - i);
+        dst += run - i;
+        if (run == len) break;
+
+        char escape = ESCAPES[src[run]];
+        *dst++ = '\\';
+        *dst++ = escape;
+        if (escape == 'u') {
+            *dst++ = '0';
+            *dst++ = '0';
+            *dst++ = HEX_DIGITS[src[run] >> 4];
+            *dst++ = HEX_DIGITS[src[run] & 0xF];
+        }
+        i = run + 1;
+    }
+    *dst++ = '"';
+    json->out->length = dst - json->out->data;
+}
+
+void json_uint(json_writer *json, uint64_t value) {
+    char digits[20];
+    int num = 0;
+
+    begin_value(json);
+    do {
+        digits[num++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    outbuf_reserve(json->out, num);
+    while (num) {
+        json->out->data[json->out->length++] = digits[--num];
+    }
+}
+
+void json_double(json_writer *json, double value) {
+    begin_value(json);
+    outbuf_printf(json->out, "%1.15g", value);
+}
+
+void json_bool(json_writer *json, bool value) {
+    begin_value(json);
+    outbuf_write(json->out, value ? "true" : "false", value ? 4 : 5);
+}
+
+void json_null(json_writer *json) {
+    begin_value(json);
+    outbuf_write(json->out, "null", 4);
+}
+
+/**
+ * @brief Format binary registry data the way it is written in .reg files,
+ * e.g. "hex:01,02"
+ *
+ * @param doc context, the string is allocated from its arena
+ * @param prefix prefix such as "hex:"
+ * @param data value data
+ * @param len length of data
+ * @return const char* formatted value, NULL if memory allocation failed
+ */
+static const char *hex_value(wcecab *doc, const char *prefix, const uint8_t *data, uint16_t len) {
+    size_t prefixlen = strlen(prefix);
+    char *val = wcecab_alloc(doc, prefixlen + len * 3 + 1);
+    if (!val) return NULL;
+
+    memcpy(val, prefix, prefixlen);
+    *hex_encode(val + prefixlen, data, len) = '\0';
+    return val;
+}
+
+/**
+ * @brief Write a Windows CE version as an object member, left out if the
+ * major version is 0
+ *
+ * @param json writer
+ * @param key member name
+ * @param major major version
+ * @param minor minor version
+ */
+static void write_version(json_writer *json, const char *key, uint32_t major, uint32_t minor) {
+    char buffer[24];
+
+    if (!major) return;
+    json_key(json, key);
+    json_begin_object(json);
+    json_key(json, "major");
+    json_uint(json, major);
+    json_key(json, "minor");
+    json_uint(json, minor);
+    snprintf(buffer, sizeof(buffer), "%u.%u", major, minor);
+    json_key(json, "stringValue");
+    json_string(json, buffer);
+    json_end_object(json);
+}
+
+void json_write_record(json_writer *json, wcecab *doc, const char *path) {
+    const CE_CAB_000_HEADER *cabheader = wcecab_header(doc);
+    const wcecab_model *model = wcecab_get_model(doc);
+    const char *codepage = wcecab_codepage(doc);
+    const char *architecture = wcecab_architecture_name(cabheader->TargetArchitecture);
+    const char **unsupported = wcecab_unsupported(doc);
+
+    json_begin_object(json);
+
+    /** Input path, to tell the records of a batch apart */
+    if (path) {
+        json_key(json, "file");
+        json_string(json, path);
+    }
+
+    json_key(json, "appName");
+    json_string(json, wcecab_to_utf8_bounded(doc, wcecab_app_name(doc), cabheader->LengthAppname));
+    json_key(json, "provider");
+    json_string(json, wcecab_to_utf8_bounded(doc, wcecab_provider(doc), cabheader->LengthProvider));
+
+    /** Codepage the strings were decoded from */
+    json_key(json, "codepage");
+    if (codepage) {
+        json_string(json, codepage);
+    } else {
+        json_null(json);
+    }
+
+    json_key(json, "architecture");
+    if (architecture) {
+        json_string(json, architecture);
+    } else {
+        json_null(json);
+    }
+
+    if (*unsupported) {
+        json_key(json, "unsupported");
+        json_begin_array(json);
+        for (int i = 0; unsupported[i] && strlen(unsupported[i]); i++) {
+            json_string(json, unsupported[i]);
+        }
+        json_end_array(json);
+    }
+
+    write_version(json, "minCeVersion", cabheader->MinCEVersionMajor, cabheader->MinCEVersionMinor);
+    write_version(json, "maxCeVersion", cabheader->MaxCEVersionMajor, cabheader->MaxCEVersionMinor);
+
+    if (cabheader->MinCEBuildNumber) {
+        json_key(json, "minCeBuildNumber");
+        json_uint(json, cabheader->MinCEBuildNumber);
+    }
+    if (cabheader->MaxCEBuildNumber) {
+        json_key(json, "maxCeBuildNumber");
+        json_uint(json, cabheader->MaxCEBuildNumber);
+    }
+
+    /** Directories */
+    json_key(json, "directories");
+    json_begin_array(json);
+    const wcecab_dir_table *dirs = &model->dirs;
+    for (uint32_t row = 0; row < dirs->count; row++) {
+        json_begin_object(json);
+        json_key(json, "id");
+        json_uint(json, dirs->id[row]);
+        json_key(json, "path");
+        json_string(json, wcecab_to_utf8(doc, wcecab_dir_path(doc, dirs->id[row])));
+        json_end_object(json);
+    }
+    json_end_array(json);
+
+    /** Files */
+    json_key(json, "files");
+    json_begin_array(json);
+    const wcecab_file_table *files = &model->files;
+    for (uint32_t row = 0; row < files->count; row++) {
+        const uint16_t flagsupper = files->flags[row] >> 16;
+        const uint16_t flagslower = files->flags[row] & 0xFFFF;
+
+        json_begin_object(json);
+        json_key(json, "id");
+        json_uint(json, files->id[row]);
+        json_key(json, "name");
+        json_string(json, wcecab_to_utf8_bounded(doc, wcecab_model_at(model, files->name[row]), files->namelength[row]));
+        json_key(json, "directory");
+        json_string(json, wcecab_to_utf8(doc, wcecab_dir_path(doc, files->directory[row])));
+
+        // Flags
+        if (flagsupper & 0x8000) {
+            json_key(json, "isReferenceCountingSharedFile");
+            json_bool(json, true);
+        }
+        if (flagsupper & 0x4000) {
+            json_key(json, "ignoreCabFileDate");
+            json_bool(json, true);
+        }
+        if (flagsupper & 0x2000) {
+            json_key(json, "doNotOverWriteIfTargetIsNewer");
+            json_bool(json, true);
+        }
+        if (flagsupper & 0x1000) {
+            json_key(json, "selfRegisterDll");
+            json_bool(json, true);
+        }
+        if (flagslower & 0x0400) {
+            json_key(json, "doNotCopyUnlessTargetExists");
+            json_bool(json, true);
+        }
+        if (flagslower & 0x0010) {
+            json_key(json, "overWriteTargetIfExists");
+            json_bool(json, true);
+        }
+        if (flagslower & 0x0002) {
+            json_key(json, "doNotSkip");
+            json_bool(json, true);
+        }
+        if (flagslower & 0x0001) {
+            json_key(json, "warnIfSkipped");
+            json_bool(json, true);
+        }
+        json_end_object(json);
+    }
+    json_end_array(json);
+
+    /** Registry Entries */
+    json_key(json, "registryEntries");
+    json_begin_array(json);
+    const wcecab_regkey_table *regkeys = &model->regkeys;
+    for (uint32_t row = 0; row < regkeys->count; row++) {
+        const char *value = wcecab_model_at(model, regkeys->data[row]);
+        const char *name = wcecab_model_at(model, regkeys->name[row]);
+        const char *hivepath = wcecab_hive_path(doc, regkeys->hive[row]);
+        const uint16_t datalength = regkeys->datalength[row];
+        const char *val = NULL;
+        char dword[16];
+
+        // The value follows the name
+        name = wcecab_to_utf8_bounded(doc, name, value - name);
+
+        json_begin_object(json);
+        json_key(json, "path");
+        json_string(json, wcecab_to_utf8(doc, hivepath ? hivepath : "unknown"));
+
+        /** Reg Item name. Null if default */
+        json_key(json, "name");
+        if (*name) {
+            json_string(json, name);
+        } else {
+            json_null(json);
+        }
+
+        json_key(json, "dataType");
+        json_string(json, wcecab_reg_datatype(regkeys->flags[row]));
+
+        switch (regkeys->flags[row] & TYPE_REG_MASK) {
+            case TYPE_REG_DWORD:
+                if (datalength < sizeof(uint32_t)) {
+                    // Too short for a DWORD, keep the bytes there are
+                    val = hex_value(doc, "hex(4):", (const uint8_t *)value, datalength);
+                    break;
+                }
+                snprintf(dword, sizeof(dword), "dword:%08X", read_uint32_le((const unsigned char *)value));
+                val = dword;
+                break;
+            case TYPE_REG_SZ:
+                val = wcecab_to_utf8_bounded(doc, value, datalength);
+                break;
+            case TYPE_REG_MULTI_SZ:
+                val = hex_value(doc, "hex(7):", (const uint8_t *)value, datalength);
+                break;
+            case TYPE_REG_BINARY:
+                val = hex_value(doc, "hex:", (const uint8_t *)value, datalength);
+                break;
+        }
+        if (val) {
+            json_key(json, "value");
+            json_string(json, val);
+        }
+        json_end_object(json);
+    }
+    json_end_array(json);
+
+    /** Links */
+    json_key(json, "links");
+    json_begin_array(json);
+    const wcecab_link_table *links = &model->links;
+    for (uint32_t row = 0; row < links->count; row++) {
+        json_begin_object(json);
+        json_key(json, "isFile");
+        json_bool(json, links->type[row]);
+        json_key(json, "targetId");
+        json_uint(json, links->target[row]);
+        json_key(json, "linkPath");
+        json_string(json, wcecab_to_utf8(doc, wcecab_link_path(doc, row)));
+        json_key(json, "targetPath");
+        if (links->type[row]) {
+            const char *filepath = wcecab_file_path(doc, links->target[row]);
+            json_string(json, wcecab_to_utf8(doc, filepath ? filepath : "unknown"));
+        } else {
+            json_string(json, wcecab_to_utf8(doc, wcecab_dir_path(doc, links->target[row])));
+        }
+        json_end_object(json);
+    }
+    json_end_array(json);
+
+    json_end_object(json);
+}
+
+void json_write_error(json_writer *json, const char *path, const char *message) {
+    json_begin_object(json);
+    json_key(json, "file");
+    json_string(json, path);
+    json_key(json, "error");
+    json_string(json, message);
+    json_end_object(json);
+}
@@ -0,0 +1,136 @@
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "outbuf.h"
+#include "wcecabinfo.h"
+
+/** Maximum nesting depth of containers */
+#define JSON_MAX_DEPTH 32
+
+/**
+ * Streaming JSON writer. Values are written to the output buffer as they are
+ * added, without building a tree first. The pretty output is formatted like
+ * cJSON_Print(): members of objects on their own lines indented with tabs,
+ * elements of arrays on one line separated by ", ". The compact output has no
+ * whitespace at all.
+ */
+typedef struct json_writer {
+    /** Buffer the JSON is written to */
+    outbuf *out;
+    /** Format the output */
+    bool pretty;
+    /** True until the first member or element of the current container */
+    bool first;
+    /** Number of open containers */
+    int depth;
+    /** Bit per depth, set if the container at that depth is an array */
+    uint32_t arrays;
+} json_writer;
+
+/**
+ * @brief Initialize a writer
+ *
+ * @param json writer to initialize
+ * @param out buffer to append the JSON to
+ * @param pretty true to format the output
+ */
+void json_init(json_writer *json, outbuf *out, bool pretty);
+
+/**
+ * @brief Start an object, as a value or an element of an array
+ *
+ * @param json writer
+ */
+void json_begin_object(json_writer *json);
+
+/**
+ * @brief Close the innermost object
+ *
+ * @param json writer
+ */
+void json_end_object(json_writer *json);
+
+/**
+ * @brief Start an array, as a value or an element of an array
+ *
+ * @param json writer
+ */
+void json_begin_array(json_writer *json);
+
+/**
+ * @brief Close the innermost array
+ *
+ * @param json writer
+ */
+void json_end_array(json_writer *json);
+
+/**
+ * @brief Start a member of the innermost object, followed by its value
+ *
+ * @param json writer
+ * @param key member name, written without escaping
+ */
+void json_key(json_writer *json, const char *key);
+
+/**
+ * @brief Write a string value
+ *
+ * @param json writer
+ * @param str UTF-8 string, escaped as needed
+ */
+void json_string(json_writer *json, const char *str);
+
+/**
+ * @brief Write a number value
+ *
+ * @param json writer
+ * @param value number
+ */
+void json_uint(json_writer *json, uint64_t value);
+
+/**
+ * @brief Write a number value that can have a fraction
+ *
+ * @param json writer
+ * @param value finite number, written with up to 15 significant digits
+ */
+void json_double(json_writer *json, double value);
+
+/**
+ * @brief Write a boolean value
+ *
+ * @param json writer
+ * @param value boolean
+ */
+void json_bool(json_writer *json, bool value);
+
+/**
+ * @brief Write a null value
+ *
+ * @param json writer
+ */
+void json_null(json_writer *json);
+
+/**
+ * @brief Write the record of an opened 000 file, in the format of
+ * typescript/WinCeCab000Info.ts
+ *
+ * @param json writer
+ * @param doc opened 000 file
+ * @param path input path written as the file member, NULL to leave it out
+ */
+void json_write_record(json_writer *json, wcecab *doc, const char *path);
+
+/**
+ * @brief Write the record of an input that could not be processed
+ *
+ * @param json writer
+ * @param path input path
+ * @param message error message
+ */
+void json_write_error(json_writer *json, const char *path, const char *message);
+
+#endif
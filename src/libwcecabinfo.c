@@ -0,0 +1,1333 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "arena.h"
+#include "codepage.h"
+#include "mscab.h"
+#include "wcecabinfo.h"
+
+/** Initial size of the buffer a stream is read into, doubled when full */
+#define CHUNK_SIZE 65536
+/** Expected length of a path component, for sizing paths before they are
+ * built */
+#define SPEC_COMPONENT_ESTIMATE 16
+
+/** Value of wcecab.codepage before detection */
+#define CODEPAGE_UNDETECTED -1
+/** Value of wcecab.codepage for files without strings that need converting */
+#define CODEPAGE_NONE -2
+
+/**
+ * Rows of a table of the document model, indexed by entry id. The index is a
+ * dense array covering the ids up to the highest one in the file, so every
+ * lookup is a single array access. Its memory is kept between files, and only
+ * the part used by a file is cleared when it is closed.
+ */
+typedef struct id_index {
+    /** Row of the entry with each id plus 1, 0 if there is no entry with that
+     * id */
+    uint32_t *rows;
+    /** Number of ids covered, one more than the highest id */
+    uint32_t num;
+    /** Allocated size of rows */
+    uint32_t max;
+} id_index;
+
+/** String built in the arena of a context, with its length */
+typedef struct path {
+    const char *str;
+    size_t len;
+} path;
+
+struct wcecab {
+    /** Decoder for extracting the 000 file from CAB files */
+    mscab_decoder decoder;
+    /** Contents of the 000 file */
+    const uint8_t *file;
+    /** Size of the 000 file */
+    size_t size;
+    /** Header of the 000 file, at the start of file */
+    const CE_CAB_000_HEADER *header;
+    /** true if the 000 file was extracted from a CAB file */
+    bool is_cab;
+    /** Heap allocation backing the input, NULL if not owned */
+    void *alloc;
+    /** Memory mapping backing the input, NULL if not mapped */
+    void *map;
+    /** Size of the memory mapping */
+    size_t map_size;
+    /** List of unsupported platforms, built on first use */
+    const char **unsupported;
+    /** Document model, decoded when the file is opened */
+    wcecab_model model;
+    /** Memory holding the arrays of the model and the paths, kept between
+     * files */
+    void *tables;
+    /** Allocated size of tables */
+    size_t tables_size;
+    /** Path of each row of the dirs table, resolved on first use */
+    path *dir_paths;
+    /** Registry path of each row of the hives table, resolved on first use */
+    path *hive_paths;
+    /** Everything allocated for the open file: paths, converted strings and
+     * memory handed out by wcecab_alloc(). Reset when the file is closed */
+    arena arena;
+    /** Rows of the strings table by string id */
+    id_index strings;
+    /** Rows of the dirs table by directory id */
+    id_index dirs;
+    /** Rows of the files table by file id */
+    id_index files;
+    /** Rows of the hives table by hive id */
+    id_index hives;
+    /** Codepage of the open file, detected on the first conversion.
+     * CODEPAGE_UNDETECTED before, CODEPAGE_NONE while no string that is not
+     * ASCII was found */
+    int codepage;
+    /** Codepage set with wcecab_set_codepage(), kept across files.
+     * CODEPAGE_UNDETECTED to detect it for every file */
+    int forced_codepage;
+    /** Statistics, NULL if they are not enabled. Updated through const
+     * pointers to the context as well */
+    wcecab_stats *stats;
+    /** Function called at the end of every phase, NULL for none */
+    wcecab_phase_callback phase_callback;
+    /** Passed to phase_callback */
+    void *phase_userdata;
+    /** Error message of the last failed open */
+    char error[256];
+};
+
+/**
+ * @brief Record the error message of a failed open
+ *
+ * @param doc context
+ * @param status status code to return
+ * @param format Format string
+ * @param ... varargs
+ * @return int status
+ */
+static int fail(wcecab *doc, int status, const char *restrict format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(doc->error, sizeof(doc->error), format, args);
+    va_end(args);
+
+    return status;
+}
+
+/** Start of a timed phase */
+typedef struct phase_timer {
+    struct timespec wall;
+    struct timespec cpu;
+} phase_timer;
+
+/**
+ * @brief Get the nanoseconds between two points in time
+ */
+static inline uint64_t elapsed_ns(const struct timespec *start, const struct timespec *end) {
+    return (uint64_t)(end->tv_sec - start->tv_sec) * 1000000000 + end->tv_nsec - start->tv_nsec;
+}
+
+/**
+ * @brief Start timing a phase, if statistics are enabled or a phase callback
+ * is set
+ *
+ * @param doc context
+ * @param timer set to the start of the phase
+ */
+static inline void phase_start(const wcecab *doc, phase_timer *timer) {
+    if (!doc->stats && !doc->phase_callback) return;
+    clock_gettime(CLOCK_MONOTONIC, &timer->wall);
+    if (doc->stats) clock_gettime(CLOCK_THREAD_CPUTIME_ID, &timer->cpu);
+}
+
+/**
+ * @brief Add the time since the start of a phase to the statistics and pass
+ * it to the phase callback
+ *
+ * @param doc context
+ * @param timer start of the phase
+ * @param phase phase that ended
+ */
+static inline void phase_stop(const wcecab *doc, const phase_timer *timer, wcecab_phase phase) {
+    struct timespec wall, cpu;
+
+    if (!doc->stats && !doc->phase_callback) return;
+    clock_gettime(CLOCK_MONOTONIC, &wall);
+    if (doc->stats) {
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+        doc->stats->wall_ns[phase] += elapsed_ns(&timer->wall, &wall);
+        doc->stats->cpu_ns[phase] += elapsed_ns(&timer->cpu, &cpu);
+    }
+    if (doc->phase_callback) {
+        uint64_t start = (uint64_t)timer->wall.tv_sec * 1000000000 + timer->wall.tv_nsec;
+        doc->phase_callback(doc->phase_userdata, phase, start, start + elapsed_ns(&timer->wall, &wall));
+    }
+}
+
+/**
+ * @brief Release the memory backing the input
+ *
+ * @param doc context
+ */
+static void release_input(wcecab *doc) {
+    free(doc->alloc);
+#ifndef _WIN32
+    if (doc->map) {
+        munmap(doc->map, doc->map_size);
+    }
+#endif
+    doc->alloc = NULL;
+    doc->map = NULL;
+    doc->map_size = 0;
+}
+
+/**
+ * @brief Forget the entries of the closed file
+ *
+ * @param index index to clear
+ */
+static void clear_index(id_index *index) {
+    if (!index->num) return;
+    memset(index->rows, 0, index->num * sizeof(uint32_t));
+    index->num = 0;
+}
+
+wcecab *wcecab_new(void) {
+    wcecab *doc = calloc(1, sizeof(wcecab));
+    if (doc) {
+        mscab_decoder_init(&doc->decoder);
+        arena_init(&doc->arena);
+        doc->codepage = CODEPAGE_UNDETECTED;
+        doc->forced_codepage = CODEPAGE_UNDETECTED;
+    }
+    return doc;
+}
+
+void wcecab_close(wcecab *doc) {
+    doc->unsupported = NULL;
+    clear_index(&doc->strings);
+    clear_index(&doc->dirs);
+    clear_index(&doc->files);
+    clear_index(&doc->hives);
+    arena_reset(&doc->arena);
+    doc->codepage = CODEPAGE_UNDETECTED;
+    memset(&doc->model, 0, sizeof(doc->model));
+    release_input(doc);
+    doc->file = NULL;
+    doc->size = 0;
+    doc->header = NULL;
+    doc->is_cab = false;
+    doc->error[0] = '\0';
+}
+
+void wcecab_free(wcecab *doc) {
+    if (!doc) return;
+    wcecab_close(doc);
+    mscab_decoder_free(&doc->decoder);
+    free(doc->tables);
+    arena_free(&doc->arena);
+    free(doc->strings.rows);
+    free(doc->dirs.rows);
+    free(doc->files.rows);
+    free(doc->hives.rows);
+    free(doc->stats);
+    free(doc);
+}
+
+/**
+ * @brief Check whether a string of the header lies within the file
+ */
+static bool string_in_file(const wcecab *doc, uint16_t offset, uint16_t length) {
+    return (size_t)offset + length <= doc->size;
+}
+
+/**
+ * @brief Record the row of an entry in the index of its section
+ *
+ * Of several entries with the same id, the first one is indexed.
+ *
+ * @param doc context
+ * @param index index of the section
+ * @param id entry id
+ * @param row row of the entry
+ * @return int WCECAB_OK on success, WCECAB_ERR_NOMEM if the index can not be
+ * allocated
+ */
+static int index_row(wcecab *doc, id_index *index, uint16_t id, uint32_t row) {
+    if (id >= index->max) {
+        uint32_t max = index->max ? index->max : 1024;
+        while (max <= id) max *= 2;
+        uint32_t *rows = realloc(index->rows, max * sizeof(uint32_t));
+        if (!rows) {
+            return fail(doc, WCECAB_ERR_NOMEM, "Failed to allocate index");
+        }
+        memset(rows + index->max, 0, (max - index->max) * sizeof(uint32_t));
+        index->rows = rows;
+        index->max = max;
+    }
+    if (id >= index->num) {
+        index->num = id + 1;
+    }
+
+    if (!index->rows[id]) {
+        index->rows[id] = row + 1;
+    }
+    return WCECAB_OK;
+}
+
+/**
+ * @brief Look up the row of an entry by its id
+ *
+ * @param index index of the section
+ * @param id entry id
+ * @return int64_t row of the entry, -1 if there is no entry with that id
+ */
+static inline int64_t lookup(const id_index *index, uint16_t id) {
+    if (id >= index->num || !index->rows[id]) {
+        return -1;
+    }
+    return index->rows[id] - 1;
+}
+
+/**
+ * @brief Take an array from the table memory
+ *
+ * @param ptr position in the table memory, advanced past the array
+ * @param count number of elements
+ * @param size size of an element
+ * @return void* the array
+ */
+static void *carve(uint8_t **ptr, size_t count, size_t size) {
+    void *array = *ptr;
+    *ptr += count * size;
+    return array;
+}
+
+/**
+ * @brief Decode all sections into the document model in one pass
+ *
+ * The arrays of all tables are taken from one block, sized for the entry counts
+ * of the header and reused by later files. Arrays of paths come first, then
+ * 32-bit and then 16-bit arrays, so that each array is aligned. Walking the
+ * sections also checks that their entries lie within the file, a section is
+ * cut short at the first entry that does not. Entries looked up by id are
+ * indexed as they are decoded.
+ *
+ * @param doc context with an opened 000 file
+ * @return int WCECAB_OK on success, WCECAB_ERR_NOMEM if the tables can not be
+ * allocated
+ */
+static int decode(wcecab *doc) {
+    const CE_CAB_000_HEADER *header = doc->header;
+    size_t numstrings = header->NumEntriesString;
+    size_t numdirs = header->NumEntriesDirs;
+    size_t numfiles = header->NumEntriesFiles;
+    size_t numhives = header->NumEntriesRegHives;
+    size_t numkeys = header->NumEntriesRegKeys;
+    size_t numlinks = header->NumEntriesLinks;
+    size_t numpaths = numdirs + numhives;
+    size_t num32 = numstrings + numdirs + 2 * numfiles + numhives + 3 * numkeys + numlinks;
+    size_t num16 = 2 * numstrings + 2 * numdirs + 3 * numfiles + 3 * numhives + 3 * numkeys + 5 * numlinks;
+    size_t size = numpaths * sizeof(path) + num32 * sizeof(uint32_t) + num16 * sizeof(uint16_t);
+    wcecab_model *model = &doc->model;
+    const void *entry;
+    wcecab_iter it;
+    uint32_t row;
+    int status;
+
+    if (size > doc->tables_size) {
+        void *tables = realloc(doc->tables, size);
+        if (!tables) {
+            return fail(doc, WCECAB_ERR_NOMEM, "Failed to allocate tables");
+        }
+        doc->tables = tables;
+        doc->tables_size = size;
+    }
+
+    uint8_t *ptr = doc->tables;
+    doc->dir_paths = carve(&ptr, numdirs, sizeof(path));
+    doc->hive_paths = carve(&ptr, numhives, sizeof(path));
+    // Without directories and hives there is nothing to clear, and the tables
+    // may not be allocated yet
+    if (numpaths) memset(doc->tables, 0, numpaths * sizeof(path));
+
+    uint32_t *stringoffset = carve(&ptr, numstrings, sizeof(uint32_t));
+    uint32_t *dirspec = carve(&ptr, numdirs, sizeof(uint32_t));
+    uint32_t *fileflags = carve(&ptr, numfiles, sizeof(uint32_t));
+    uint32_t *filename = carve(&ptr, numfiles, sizeof(uint32_t));
+    uint32_t *hivespec = carve(&ptr, numhives, sizeof(uint32_t));
+    uint32_t *keyflags = carve(&ptr, numkeys, sizeof(uint32_t));
+    uint32_t *keyname = carve(&ptr, numkeys, sizeof(uint32_t));
+    uint32_t *keydata = carve(&ptr, numkeys, sizeof(uint32_t));
+    uint32_t *linkspec = carve(&ptr, numlinks, sizeof(uint32_t));
+
+    uint16_t *stringid = carve(&ptr, numstrings, sizeof(uint16_t));
+    uint16_t *stringlength = carve(&ptr, numstrings, sizeof(uint16_t));
+    uint16_t *dirid = carve(&ptr, numdirs, sizeof(uint16_t));
+    uint16_t *dirspeclength = carve(&ptr, numdirs, sizeof(uint16_t));
+    uint16_t *fileid = carve(&ptr, numfiles, sizeof(uint16_t));
+    uint16_t *filedirectory = carve(&ptr, numfiles, sizeof(uint16_t));
+    uint16_t *filenamelength = carve(&ptr, numfiles, sizeof(uint16_t));
+    uint16_t *hiveid = carve(&ptr, numhives, sizeof(uint16_t));
+    uint16_t *hiveroot = carve(&ptr, numhives, sizeof(uint16_t));
+    uint16_t *hivespeclength = carve(&ptr, numhives, sizeof(uint16_t));
+    uint16_t *keyid = carve(&ptr, numkeys, sizeof(uint16_t));
+    uint16_t *keyhive = carve(&ptr, numkeys, sizeof(uint16_t));
+    uint16_t *keydatalength = carve(&ptr, numkeys, sizeof(uint16_t));
+    uint16_t *linkid = carve(&ptr, numlinks, sizeof(uint16_t));
+    uint16_t *linkbasedir = carve(&ptr, numlinks, sizeof(uint16_t));
+    uint16_t *linktarget = carve(&ptr, numlinks, sizeof(uint16_t));
+    uint16_t *linktype = carve(&ptr, numlinks, sizeof(uint16_t));
+    uint16_t *linkspeclength = carve(&ptr, numlinks, sizeof(uint16_t));
+
+    model->file = doc->file;
+    model->size = doc->size;
+
+    /* STRINGS */
+    row = 0;
+    wcecab_iter_init(doc, WCECAB_SECTION_STRINGS, &it);
+    while ((entry = wcecab_iter_next(&it))) {
+        const CE_CAB_000_STRING_ENTRY *stringentry = entry;
+        stringid[row] = stringentry->Id;
+        stringoffset[row] = &(stringentry->String) - (const char *)doc->file;
+        stringlength[row] = strnlen(&(stringentry->String), stringentry->StringLength);
+        if ((status = index_row(doc, &doc->strings, stringentry->Id, row)) != WCECAB_OK) return status;
+        row++;
+    }
+    model->strings = (wcecab_string_table){row, stringid, stringoffset, stringlength};
+
+    /* DIRS */
+    row = 0;
+    wcecab_iter_init(doc, WCECAB_SECTION_DIRS, &it);
+    while ((entry = wcecab_iter_next(&it))) {
+        const CE_CAB_000_DIRECTORY_ENTRY *direntry = entry;
+        dirid[row] = direntry->Id;
+        dirspec[row] = (const uint8_t *)&(direntry->Spec) - doc->file;
+        dirspeclength[row] = direntry->SpecLength;
+        if ((status = index_row(doc, &doc->dirs, direntry->Id, row)) != WCECAB_OK) return status;
+        row++;
+    }
+    model->dirs = (wcecab_dir_table){row, dirid, dirspec, dirspeclength};
+
+    /* FILES */
+    row = 0;
+    wcecab_iter_init(doc, WCECAB_SECTION_FILES, &it);
+    while ((entry = wcecab_iter_next(&it))) {
+        const CE_CAB_000_FILE_ENTRY *fileentry = entry;
+        fileid[row] = fileentry->Id;
+        filedirectory[row] = fileentry->DirectoryId;
+        fileflags[row] = (uint32_t)fileentry->FlagsUpper << 16 | fileentry->FlagsLower;
+        filename[row] = &(fileentry->FileName) - (const char *)doc->file;
+        filenamelength[row] = strnlen(&(fileentry->FileName), fileentry->FileNameLength);
+        if ((status = index_row(doc, &doc->files, fileentry->Id, row)) != WCECAB_OK) return status;
+        row++;
+    }
+    model->files = (wcecab_file_table){row, fileid, filedirectory, fileflags, filename, filenamelength};
+
+    /* REGHIVES */
+    row = 0;
+    wcecab_iter_init(doc, WCECAB_SECTION_REGHIVES, &it);
+    while ((entry = wcecab_iter_next(&it))) {
+        const CE_CAB_000_REGHIVE_ENTRY *reghiveentry = entry;
+        hiveid[row] = reghiveentry->Id;
+        hiveroot[row] = reghiveentry->HiveRoot;
+        hivespec[row] = (const uint8_t *)&(reghiveentry->Spec) - doc->file;
+        hivespeclength[row] = reghiveentry->SpecLength;
+        if ((status = index_row(doc, &doc->hives, reghiveentry->Id, row)) != WCECAB_OK) return status;
+        row++;
+    }
+    model->hives = (wcecab_hive_table){row, hiveid, hiveroot, hivespec, hivespeclength};
+
+    /* REGKEYS, the data follows the 0 terminated name */
+    row = 0;
+    wcecab_iter_init(doc, WCECAB_SECTION_REGKEYS, &it);
+    while ((entry = wcecab_iter_next(&it))) {
+        const CE_CAB_000_REGKEY_ENTRY *regkeyentry = entry;
+        size_t namelength = strnlen(&(regkeyentry->KeyName), regkeyentry->DataLength);
+        size_t skip = namelength < regkeyentry->DataLength ? namelength + 1 : namelength;
+        keyid[row] = regkeyentry->Id;
+        keyhive[row] = regkeyentry->HiveId;
+        keyflags[row] = (uint32_t)regkeyentry->TypeFlagsUpper << 16 | regkeyentry->TypeFlagsLower;
+        keyname[row] = &(regkeyentry->KeyName) - (const char *)doc->file;
+        keydata[row] = keyname[row] + skip;
+        keydatalength[row] = regkeyentry->DataLength - skip;
+        row++;
+    }
+    model->regkeys = (wcecab_regkey_table){row, keyid, keyhive, keyflags, keyname, keydata, keydatalength};
+
+    /* LINKS, SpecLength does not include the terminating 0 of link specs */
+    row = 0;
+    wcecab_iter_init(doc, WCECAB_SECTION_LINKS, &it);
+    while ((entry = wcecab_iter_next(&it))) {
+        const CE_CAB_000_LINK_ENTRY *linkentry = entry;
+        linkid[row] = linkentry->Id;
+        linkbasedir[row] = linkentry->BaseDirectory;
+        linktarget[row] = linkentry->TargetId;
+        linktype[row] = linkentry->LinkType;
+        linkspec[row] = (const uint8_t *)&(linkentry->Spec) - doc->file;
+        linkspeclength[row] = linkentry->SpecLength + sizeof(uint16_t);
+        row++;
+    }
+    model->links = (wcecab_link_table){row, linkid, linkbasedir, linktarget, linktype, linkspec, linkspeclength};
+
+    return WCECAB_OK;
+}
+
+/**
+ * @brief Open the contents of a 000 file or CAB file
+ *
+ * @param doc context, closed
+ * @param data file contents
+ * @param size size of the file in bytes
+ * @return int WCECAB_OK on success, one of WCECAB_ERR_* otherwise
+ */
+static int load(wcecab *doc, const void *data, size_t size) {
+    phase_timer timer;
+    int status;
+    bool is_cab;
+    mscab_cabinet cabinet;
+
+    if (!size) {
+        return fail(doc, WCECAB_ERR_FORMAT, "Input size is 0");
+    }
+    if (doc->stats) doc->stats->bytes_read += size;
+
+    // Tell CAB files from 000 files, and locate the 000 file in a CAB file
+    phase_start(doc, &timer);
+    is_cab = size >= sizeof(uint32_t) && *(const uint32_t *)data == CE_CAB_HEADER_SIGNATURE;
+    status = is_cab ? mscab_open(data, size, &cabinet) : MSCAB_OK;
+    phase_stop(doc, &timer, WCECAB_PHASE_DETECT);
+
+    // CAB file, extract the 000 file
+    if (is_cab) {
+        mscab_file extracted;
+
+        if (status == MSCAB_OK) {
+            phase_start(doc, &timer);
+            status = mscab_extract(&doc->decoder, &cabinet, &extracted);
+            phase_stop(doc, &timer, WCECAB_PHASE_EXTRACT);
+        }
+        if (status != MSCAB_OK) {
+            return fail(doc, WCECAB_ERR_CAB, "Failed to extract 000 file from CAB: %s", mscab_strerror(status));
+        }
+
+        // A 000 file stored uncompressed in one piece is used in place, which
+        // needs the memory backing the CAB file
+        if (!extracted.in_place) {
+            release_input(doc);
+        }
+        doc->is_cab = true;
+        data = extracted.data;
+        size = extracted.size;
+        if (doc->stats) doc->stats->bytes_extracted += size;
+    }
+
+    doc->file = data;
+    doc->size = size;
+    doc->header = data;
+
+    if (size < sizeof(CE_CAB_000_HEADER) || doc->header->AsciiSignature != CE_CAB_000_HEADER_SIGNATURE) {
+        return fail(doc, WCECAB_ERR_FORMAT, "Input file is neither a CAB file nor a 000 file");
+    }
+
+    if (doc->header->FileLength != size) {
+        return fail(doc, WCECAB_ERR_CORRUPT, "000 header file length (%d) and actual file length (%d) don't match", doc->header->FileLength, (uint32_t)size);
+    }
+
+    if (!string_in_file(doc, doc->header->OffsetAppname, doc->header->LengthAppname) || !string_in_file(doc, doc->header->OffsetProvider, doc->header->LengthProvider) ||
+        !string_in_file(doc, doc->header->OffsetUnsupported, doc->header->LengthUnsupported)) {
+        return fail(doc, WCECAB_ERR_CORRUPT, "000 header strings reach past the end of the file");
+    }
+
+    phase_start(doc, &timer);
+    status = decode(doc);
+    phase_stop(doc, &timer, WCECAB_PHASE_DECODE);
+    return status;
+}
+
+int wcecab_open_buffer(wcecab *doc, const void *data, size_t size) {
+    wcecab_close(doc);
+    return load(doc, data, size);
+}
+
+int wcecab_open_stream(wcecab *doc, FILE *stream) {
+    size_t c = 0;
+    size_t file_size = 0;
+    size_t capacity = CHUNK_SIZE;
+    phase_timer timer;
+
+    wcecab_close(doc);
+    phase_start(doc, &timer);
+
+    uint8_t *buffer = malloc(capacity);
+    if (buffer == NULL) {
+        return fail(doc, WCECAB_ERR_NOMEM, "Failed to allocate content");
+    }
+
+    // Doubling the buffer when it is full keeps the copies of realloc linear
+    // in the size of the stream
+    while ((c = fread(buffer + file_size, 1, capacity - file_size, stream)) > 0) {
+        file_size += c;
+        if (file_size == capacity) {
+            uint8_t *grown = realloc(buffer, capacity * 2);
+            if (grown == NULL) {
+                free(buffer);
+                return fail(doc, WCECAB_ERR_NOMEM, "Failed to reallocate content");
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+    }
+
+    phase_stop(doc, &timer, WCECAB_PHASE_LOAD);
+    if (ferror(stream)) {
+        free(buffer);
+        return fail(doc, WCECAB_ERR_IO, "Error while reading from stream: %s", strerror(errno));
+    }
+
+    doc->alloc = buffer;
+    return load(doc, buffer, file_size);
+}
+
+int wcecab_open_path(wcecab *doc, const char *path) {
+#ifndef _WIN32
+    struct stat s;
+    void *mapped;
+    phase_timer timer;
+
+    wcecab_close(doc);
+    phase_start(doc, &timer);
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return fail(doc, WCECAB_ERR_IO, "File can not be read: %s", strerror(errno));
+    }
+
+    if (fstat(fd, &s) == -1) {
+        close(fd);
+        return fail(doc, WCECAB_ERR_IO, "stat failed: %s", strerror(errno));
+    }
+
+    // An empty file can not be mapped
+    if (!s.st_size) {
+        close(fd);
+        return fail(doc, WCECAB_ERR_FORMAT, "Input size is 0");
+    }
+
+    /* Memory-map the file. */
+    mapped = mmap(0, s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    phase_stop(doc, &timer, WCECAB_PHASE_LOAD);
+    if (mapped == MAP_FAILED) {
+        return fail(doc, WCECAB_ERR_IO, "mmap failed: %s", strerror(errno));
+    }
+
+    doc->map = mapped;
+    doc->map_size = s.st_size;
+    return load(doc, mapped, s.st_size);
+#else
+    FILE *stream = fopen(path, "rb");
+    if (!stream) {
+        wcecab_close(doc);
+        return fail(doc, WCECAB_ERR_IO, "File can not be read: %s", strerror(errno));
+    }
+    int status = wcecab_open_stream(doc, stream);
+    fclose(stream);
+    return status;
+#endif
+}
+
+const char *wcecab_strerror(int status) {
+    switch (status) {
+        case WCECAB_OK:
+            return "no error";
+        case WCECAB_ERR_IO:
+            return "input can not be read";
+        case WCECAB_ERR_FORMAT:
+            return "input is neither a CAB file nor a 000 file";
+        case WCECAB_ERR_CAB:
+            return "000 file can not be extracted from the CAB file";
+        case WCECAB_ERR_CORRUPT:
+            return "000 file is corrupt";
+        case WCECAB_ERR_NOMEM:
+            return "out of memory";
+        case WCECAB_ERR_CODEPAGE:
+            return "unknown codepage";
+        default:
+            return "unknown error";
+    }
+}
+
+int wcecab_enable_stats(wcecab *doc) {
+    if (doc->stats) return WCECAB_OK;
+    if (!(doc->stats = calloc(1, sizeof(wcecab_stats)))) return WCECAB_ERR_NOMEM;
+    doc->arena.allocations = 0;
+    doc->arena.blocks = 0;
+    return WCECAB_OK;
+}
+
+const wcecab_stats *wcecab_get_stats(const wcecab *doc) {
+    // The arena keeps its own counts, as it is also used without a context
+    if (doc->stats) {
+        doc->stats->allocations = doc->arena.allocations;
+        doc->stats->arena_blocks = doc->arena.blocks;
+    }
+    return doc->stats;
+}
+
+void wcecab_set_phase_callback(wcecab *doc, wcecab_phase_callback callback, void *userdata) {
+    doc->phase_callback = callback;
+    doc->phase_userdata = userdata;
+}
+
+const char *wcecab_phase_name(wcecab_phase phase) {
+    switch (phase) {
+        case WCECAB_PHASE_LOAD:
+            return "load";
+        case WCECAB_PHASE_DETECT:
+            return "detect";
+        case WCECAB_PHASE_EXTRACT:
+            return "extract";
+        case WCECAB_PHASE_DECODE:
+            return "decode";
+        case WCECAB_PHASE_CODEPAGE:
+            return "codepage";
+        case WCECAB_PHASE_TRANSCODE:
+            return "transcode";
+        default:
+            return "unknown";
+    }
+}
+
+void *wcecab_alloc(wcecab *doc, size_t size) {
+    return arena_alloc(&doc->arena, size);
+}
+
+const char *wcecab_error(const wcecab *doc) {
+    return doc->error;
+}
+
+bool wcecab_is_cab(const wcecab *doc) {
+    return doc->is_cab;
+}
+
+const CE_CAB_000_HEADER *wcecab_header(const wcecab *doc) {
+    return doc->header;
+}
+
+const char *wcecab_app_name(const wcecab *doc) {
+    return (const char *)doc->file + doc->header->OffsetAppname;
+}
+
+const char *wcecab_provider(const wcecab *doc) {
+    return (const char *)doc->file + doc->header->OffsetProvider;
+}
+
+const char **wcecab_unsupported(wcecab *doc) {
+    if (doc->unsupported) return doc->unsupported;
+
+    const char *usup = (const char *)doc->file + doc->header->OffsetUnsupported;
+    const uint16_t len = doc->header->LengthUnsupported;
+    uint16_t numUnsupported = 1;
+
+    for (const char *ptr = usup; ptr < (usup + len); ptr++) {
+        if (*ptr == '\0') {
+            numUnsupported++;
+        }
+    }
+
+    const char **unsupported = arena_alloc(&doc->arena, (numUnsupported + 1) * sizeof(char *));
+    if (!unsupported) {
+        static const char *none[] = {NULL};
+        return none;
+    }
+
+    uint16_t idx = 0;
+    char prevValue = '\0';
+    for (const char *ptr = usup; ptr < (usup + len); ptr++) {
+        if (prevValue == '\0') {
+            unsupported[idx++] = ptr;
+        }
+        prevValue = *ptr;
+    }
+
+    unsupported[numUnsupported - 1] = NULL;
+
+    doc->unsupported = unsupported;
+    return unsupported;
+}
+
+const wcecab_model *wcecab_get_model(const wcecab *doc) {
+    return &doc->model;
+}
+
+void wcecab_iter_init(const wcecab *doc, wcecab_section section, wcecab_iter *it) {
+    const CE_CAB_000_HEADER *header = doc->header;
+    uint32_t offset = 0;
+    int count = 0;
+
+    switch (section) {
+        case WCECAB_SECTION_STRINGS:
+            offset = header->OffsetStrings;
+            count = header->NumEntriesString;
+            break;
+        case WCECAB_SECTION_DIRS:
+            offset = header->OffsetDirs;
+            count = header->NumEntriesDirs;
+            break;
+        case WCECAB_SECTION_FILES:
+            offset = header->OffsetFiles;
+            count = header->NumEntriesFiles;
+            break;
+        case WCECAB_SECTION_REGHIVES:
+            offset = header->OffsetRegHives;
+            count = header->NumEntriesRegHives;
+            break;
+        case WCECAB_SECTION_REGKEYS:
+            offset = header->OffsetRegKeys;
+            count = header->NumEntriesRegKeys;
+            break;
+        case WCECAB_SECTION_LINKS:
+            offset = header->OffsetLinks;
+            count = header->NumEntriesLinks;
+            break;
+    }
+
+    it->section = section;
+    it->end = doc->file + doc->size;
+    it->entry = doc->file + (offset < doc->size ? offset : doc->size);
+    it->remaining = offset < doc->size ? count : 0;
+}
+
+const void *wcecab_iter_next(wcecab_iter *it) {
+    const uint8_t *entry = it->entry;
+    size_t head = 0;
+    size_t length = 0;
+
+    if (it->remaining <= 0) return NULL;
+
+    /* Size of the fixed part of the entry, before the variable length data */
+    switch (it->section) {
+        case WCECAB_SECTION_STRINGS:
+            head = offsetof(CE_CAB_000_STRING_ENTRY, String);
+            break;
+        case WCECAB_SECTION_DIRS:
+            head = offsetof(CE_CAB_000_DIRECTORY_ENTRY, Spec);
+            break;
+        case WCECAB_SECTION_FILES:
+            head = offsetof(CE_CAB_000_FILE_ENTRY, FileName);
+            break;
+        case WCECAB_SECTION_REGHIVES:
+            head = offsetof(CE_CAB_000_REGHIVE_ENTRY, Spec);
+            break;
+        case WCECAB_SECTION_REGKEYS:
+            head = offsetof(CE_CAB_000_REGKEY_ENTRY, KeyName);
+            break;
+        case WCECAB_SECTION_LINKS:
+            head = offsetof(CE_CAB_000_LINK_ENTRY, Spec);
+            break;
+    }
+    if ((size_t)(it->end - entry) < head) {
+        it->remaining = 0;
+        return NULL;
+    }
+
+    switch (it->section) {
+        case WCECAB_SECTION_STRINGS:
+            length = ((const CE_CAB_000_STRING_ENTRY *)entry)->StringLength;
+            break;
+        case WCECAB_SECTION_DIRS:
+            length = ((const CE_CAB_000_DIRECTORY_ENTRY *)entry)->SpecLength;
+            break;
+        case WCECAB_SECTION_FILES:
+            length = ((const CE_CAB_000_FILE_ENTRY *)entry)->FileNameLength;
+            break;
+        case WCECAB_SECTION_REGHIVES:
+            length = ((const CE_CAB_000_REGHIVE_ENTRY *)entry)->SpecLength;
+            break;
+        case WCECAB_SECTION_REGKEYS:
+            length = ((const CE_CAB_000_REGKEY_ENTRY *)entry)->DataLength;
+            break;
+        case WCECAB_SECTION_LINKS:
+            length = ((const CE_CAB_000_LINK_ENTRY *)entry)->SpecLength;
+            break;
+    }
+    if ((size_t)(it->end - entry) - head < length) {
+        it->remaining = 0;
+        return NULL;
+    }
+
+    it->entry = entry + head + length;
+    it->remaining--;
+    return entry;
+}
+
+const char *wcecab_string(const wcecab *doc, uint16_t stringid) {
+    int64_t row = lookup(&doc->strings, stringid);
+    if (doc->stats) doc->stats->string_lookups++;
+    return row < 0 ? NULL : wcecab_model_at(&doc->model, doc->model.strings.offset[row]);
+}
+
+/**
+ * Path being built in the arena of a context. Components are copied with their
+ * known lengths, so appending never rescans what was already built.
+ */
+typedef struct path_builder {
+    /** Arena holding the path */
+    arena *arena;
+    /** Path built so far, not terminated */
+    char *buf;
+    /** Length of the path */
+    size_t len;
+    /** Allocated size of buf, without the terminating 0 */
+    size_t cap;
+    /** Number of components appended */
+    size_t parts;
+    /** true if memory allocation failed */
+    bool failed;
+} path_builder;
+
+/**
+ * @brief Start building a path
+ *
+ * @param pb builder to initialize
+ * @param a arena to build the path in
+ * @param cap expected length of the path, it grows beyond it as needed
+ */
+static void path_init(path_builder *pb, arena *a, size_t cap) {
+    pb->arena = a;
+    pb->buf = arena_alloc(a, cap + 1);
+    pb->len = 0;
+    pb->cap = cap;
+    pb->parts = 0;
+    pb->failed = !pb->buf;
+}
+
+/**
+ * @brief Append a string to a path
+ *
+ * @param pb builder
+ * @param str string to append
+ * @param len length of str
+ */
+static void path_append(path_builder *pb, const char *str, size_t len) {
+    if (pb->failed || !len) return;
+    if (len > pb->cap - pb->len) {
+        size_t cap = pb->cap * 2 > pb->len + len ? pb->cap * 2 : pb->len + len;
+        if (!arena_extend(pb->arena, pb->buf, pb->cap + 1, cap + 1)) {
+            char *buf = arena_alloc(pb->arena, cap + 1);
+            if (!buf) {
+                pb->failed = true;
+                return;
+            }
+            memcpy(buf, pb->buf, pb->len);
+            pb->buf = buf;
+        }
+        pb->cap = cap;
+    }
+    memcpy(pb->buf + pb->len, str, len);
+    pb->len += len;
+}
+
+/**
+ * @brief Append a component to a path, separated from the previous one by a
+ * backslash
+ *
+ * @param pb builder
+ * @param str component
+ * @param len length of the component
+ */
+static void path_component(path_builder *pb, const char *str, size_t len) {
+    if (pb->parts++) {
+        path_append(pb, "\\", 1);
+    }
+    path_append(pb, str, len);
+}
+
+/**
+ * @brief Finish building a path
+ *
+ * @param pb builder
+ * @return path terminated path, empty if memory allocation failed
+ */
+static path path_finish(path_builder *pb) {
+    if (pb->failed) {
+        return (path){"", 0};
+    }
+    pb->buf[pb->len] = '\0';
+    return (path){pb->buf, pb->len};
+}
+
+/**
+ * @brief Look up a string and its length by string id
+ *
+ * @param doc context
+ * @param stringid string id
+ * @param len set to the length of the string, 0 if there is no such string
+ * @return const char* the string, or NULL if there is no string with that id
+ */
+static inline const char *string_with_length(const wcecab *doc, uint16_t stringid, size_t *len) {
+    int64_t row = lookup(&doc->strings, stringid);
+    if (doc->stats) doc->stats->string_lookups++;
+    if (row < 0) {
+        *len = 0;
+        return NULL;
+    }
+    *len = doc->model.strings.length[row];
+    return wcecab_model_at(&doc->model, doc->model.strings.offset[row]);
+}
+
+/**
+ * @brief Join the strings of a spec array to a path
+ *
+ * The path is the last allocation of the arena while it is built, so it
+ * usually grows in place when the initial estimate is too small.
+ *
+ * @param doc context
+ * @param prefix first component, e.g. a root key, or NULL for none
+ * @param spec spec array
+ * @param speclength length of the spec array in bytes, including the
+ * terminating 0
+ * @return path joined path
+ */
+static path build_spec_path(wcecab *doc, const char *prefix, const uint16_t *spec, uint16_t speclength) {
+    size_t count = speclength / sizeof(uint16_t);
+    size_t prefixlen = prefix ? strlen(prefix) : 0;
+    path_builder pb;
+
+    /* The spec is terminated by a 0 id, which is not part of the path */
+    if (count) count--;
+
+    path_init(&pb, &doc->arena, prefixlen + 1 + count * SPEC_COMPONENT_ESTIMATE);
+    if (prefix) {
+        path_component(&pb, prefix, prefixlen);
+        /* An empty spec still ends in a backslash after the prefix */
+        if (!count) path_append(&pb, "\\", 1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t strlength;
+        const char *str = string_with_length(doc, spec[i], &strlength);
+        path_component(&pb, str, strlength);
+    }
+    return path_finish(&pb);
+}
+
+const char *wcecab_spec_path(wcecab *doc, const uint16_t *spec, uint16_t speclength) {
+    return build_spec_path(doc, NULL, spec, speclength).str;
+}
+
+/**
+ * @brief Get the path of a directory, with its length
+ */
+static path dir_path(wcecab *doc, uint16_t directoryid) {
+    const wcecab_dir_table *dirs = &doc->model.dirs;
+    int64_t row = lookup(&doc->dirs, directoryid);
+    if (row < 0) {
+        return (path){"unknown", 7};
+    }
+    if (!doc->dir_paths[row].str) {
+        const uint16_t *spec = (const uint16_t *)wcecab_model_at(&doc->model, dirs->spec[row]);
+        doc->dir_paths[row] = build_spec_path(doc, NULL, spec, dirs->speclength[row]);
+    }
+    return doc->dir_paths[row];
+}
+
+const char *wcecab_dir_path(wcecab *doc, uint16_t directoryid) {
+    return dir_path(doc, directoryid).str;
+}
+
+const char *wcecab_file_name(const wcecab *doc, uint16_t fileid) {
+    int64_t row = lookup(&doc->files, fileid);
+    return row < 0 ? NULL : wcecab_model_at(&doc->model, doc->model.files.name[row]);
+}
+
+const char *wcecab_file_path(wcecab *doc, uint16_t fileid) {
+    const wcecab_file_table *files = &doc->model.files;
+    int64_t row = lookup(&doc->files, fileid);
+    path_builder pb;
+    if (row < 0) {
+        return NULL;
+    }
+    path directory = dir_path(doc, files->directory[row]);
+    path_init(&pb, &doc->arena, directory.len + 1 + files->namelength[row]);
+    path_component(&pb, directory.str, directory.len);
+    path_component(&pb, wcecab_model_at(&doc->model, files->name[row]), files->namelength[row]);
+    return path_finish(&pb).str;
+}
+
+const char *wcecab_hive_path(wcecab *doc, uint16_t hiveid) {
+    const wcecab_hive_table *hives = &doc->model.hives;
+    int64_t row = lookup(&doc->hives, hiveid);
+    if (row < 0) {
+        return NULL;
+    }
+    if (!doc->hive_paths[row].str) {
+        const char *root = wcecab_hive_root_name(hives->root[row]);
+        const uint16_t *spec = (const uint16_t *)wcecab_model_at(&doc->model, hives->spec[row]);
+        doc->hive_paths[row] = build_spec_path(doc, root ? root : "unknown", spec, hives->speclength[row]);
+    }
+    return doc->hive_paths[row].str;
+}
+
+const char *wcecab_link_path(wcecab *doc, uint32_t link) {
+    const wcecab_link_table *links = &doc->model.links;
+    const char *basedir = wcecab_basedir_name(links->basedir[link]);
+    const uint16_t *spec = (const uint16_t *)wcecab_model_at(&doc->model, links->spec[link]);
+    return build_spec_path(doc, basedir ? basedir : "unknown", spec, links->speclength[link]).str;
+}
+
+/**
+ * @brief Check whether a string is plain printable ASCII, which needs no
+ * conversion
+ */
+static inline bool is_ascii(const char *str, size_t len) {
+    return codepage_ascii_span(str, len) == len;
+}
+
+/**
+ * @brief Add the score of a string to the scores of all codepages, if it is
+ * not plain ASCII
+ *
+ * @param scores score per codepage
+ * @param str string
+ * @param len length of str
+ * @return bool true if the string was scored
+ */
+static bool score_string(long *scores, const char *str, size_t len) {
+    if (is_ascii(str, len)) return false;
+    for (int cp = 0; cp < NUM_CODEPAGES; cp++) {
+        scores[cp] += codepage_score(cp, str, len);
+    }
+    return true;
+}
+
+/**
+ * @brief Get the codepage with the highest score, the first one listed in the
+ * codepage enum on ties
+ */
+static int best_codepage(const long *scores) {
+    int best = 0;
+    for (int cp = 1; cp < NUM_CODEPAGES; cp++) {
+        if (scores[cp] > scores[best]) best = cp;
+    }
+    return best;
+}
+
+/**
+ * @brief Detect the codepage of the open file
+ *
+ * The strings that are not plain ASCII in the STRINGS section, the app name
+ * and the provider are scored once against every codepage, and the codepage
+ * with the highest total wins. Ties go to the codepage listed first in the
+ * codepage enum. Only if all of these are ASCII, the names of files and
+ * registry keys and the string values of the registry are scored instead.
+ *
+ * @param doc context
+ * @return int codepage, CODEPAGE_NONE if all strings are ASCII
+ */
+static int detect_codepage(wcecab *doc) {
+    const wcecab_model *model = &doc->model;
+    const char *appname = wcecab_app_name(doc);
+    const char *provider = wcecab_provider(doc);
+    long scores[NUM_CODEPAGES] = {0};
+    bool scored = false;
+    const char *str;
+
+    // Strings are bounded by their lengths, as the last one of the input does
+    // not have to be terminated
+    scored |= score_string(scores, appname, strnlen(appname, doc->header->LengthAppname));
+    scored |= score_string(scores, provider, strnlen(provider, doc->header->LengthProvider));
+    for (uint32_t row = 0; row < model->strings.count; row++) {
+        scored |= score_string(scores, wcecab_model_at(model, model->strings.offset[row]), model->strings.length[row]);
+    }
+
+    if (!scored) {
+        for (uint32_t row = 0; row < model->files.count; row++) {
+            scored |= score_string(scores, wcecab_model_at(model, model->files.name[row]), model->files.namelength[row]);
+        }
+        for (uint32_t row = 0; row < model->regkeys.count; row++) {
+            // The value follows the name
+            str = wcecab_model_at(model, model->regkeys.name[row]);
+            scored |= score_string(scores, str, strnlen(str, model->regkeys.data[row] - model->regkeys.name[row]));
+            if ((model->regkeys.flags[row] & TYPE_REG_MASK) == TYPE_REG_SZ) {
+                str = wcecab_model_at(model, model->regkeys.data[row]);
+                scored |= score_string(scores, str, strnlen(str, model->regkeys.datalength[row]));
+            }
+        }
+    }
+    return scored ? best_codepage(scores) : CODEPAGE_NONE;
+}
+
+/**
+ * @brief Get the codepage strings of the open file are converted from
+ *
+ * @param doc context
+ * @return int codepage, CODEPAGE_NONE if all strings are ASCII
+ */
+static int file_codepage(wcecab *doc) {
+    if (doc->forced_codepage != CODEPAGE_UNDETECTED) return doc->forced_codepage;
+    if (doc->codepage == CODEPAGE_UNDETECTED) {
+        phase_timer timer;
+        phase_start(doc, &timer);
+        doc->codepage = detect_codepage(doc);
+        phase_stop(doc, &timer, WCECAB_PHASE_CODEPAGE);
+    }
+    return doc->codepage;
+}
+
+int wcecab_set_codepage(wcecab *doc, const char *name) {
+    codepage cp;
+
+    if (!name) {
+        doc->forced_codepage = CODEPAGE_UNDETECTED;
+        return WCECAB_OK;
+    }
+    if (!codepage_from_name(name, &cp)) return WCECAB_ERR_CODEPAGE;
+    doc->forced_codepage = cp;
+    return WCECAB_OK;
+}
+
+const char *wcecab_codepage(wcecab *doc) {
+    int cp = file_codepage(doc);
+    return cp == CODEPAGE_NONE ? NULL : codepage_name(cp);
+}
+
+const char *wcecab_to_utf8(wcecab *doc, const char *str) {
+    if (!str) return NULL;
+    return wcecab_to_utf8_bounded(doc, str, strlen(str) + 1);
+}
+
+const char *wcecab_to_utf8_bounded(wcecab *doc, const char *str, size_t maxlen) {
+    if (!str) return NULL;
+    size_t len = strnlen(str, maxlen);
+    if (is_ascii(str, len)) {
+        // Terminated within its bound, or by the byte after it in the input
+        uintptr_t end = (uintptr_t)(str + len);
+        if (len < maxlen || (end >= (uintptr_t)doc->file && end < (uintptr_t)(doc->file + doc->size) && !str[len])) return str;
+
+        // Runs to the end of the input, copy it with a terminating 0
+        char *copy = arena_alloc(&doc->arena, len + 1);
+        if (!copy) return "";
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+        return copy;
+    }
+
+    // Detection scores every string of the file that is printed, so only a
+    // string from elsewhere can be the first one that is not ASCII. It is
+    // decoded in the codepage it scores best in, which is not reported, as
+    // the codepage may have been written already.
+    int cp = file_codepage(doc);
+    if (cp == CODEPAGE_NONE) {
+        long scores[NUM_CODEPAGES] = {0};
+        score_string(scores, str, len);
+        cp = best_codepage(scores);
+    }
+
+    phase_timer timer;
+    phase_start(doc, &timer);
+    char *newStr = arena_alloc(&doc->arena, len * 3 + 1);
+    if (newStr) {
+        newStr[codepage_to_utf8_lossy(cp, str, len, newStr)] = '\0';
+    }
+    phase_stop(doc, &timer, WCECAB_PHASE_TRANSCODE);
+    if (doc->stats) doc->stats->transcodes++;
+    if (!newStr) return len < maxlen ? str : "";
+    return newStr;
+}
+
+const char *wcecab_architecture_name(uint32_t archid) {
+    switch (archid) {
+        case CE_CAB_000_ARCH_SH3:
+            return CE_ARCH_SH3;  // SHx SH3
+        case CE_CAB_000_ARCH_SH4:
+            return CE_ARCH_SH4;  // SHx SH4
+        case CE_CAB_000_ARCH_I386:
+            return CE_ARCH_X86;  // Intel 386
+        case CE_CAB_000_ARCH_I486:
+            return CE_ARCH_X86;  // Intel 486
+        case CE_CAB_000_ARCH_I586:
+            return CE_ARCH_X86;  // Intel Pentium
+        case CE_CAB_000_ARCH_PPC601:
+            return "PPC601";  // PowerPC 601
+        case CE_CAB_000_ARCH_PPC603:
+            return "PPC602";  // PowerPC 603
+        case CE_CAB_000_ARCH_PPC604:
+            return "PPC604";  // PowerPC 604
+        case CE_CAB_000_ARCH_PPC620:
+            return "PPC620";  // PowerPC 620
+        case CE_CAB_000_ARCH_MOTOROLA_821:
+            return "MOTOROLA821";  // Motorola 821
+        case CE_CAB_000_ARCH_ARM720:
+            return CE_ARCH_ARM;  // ARM 720
+        case CE_CAB_000_ARCH_ARM820:
+            return CE_ARCH_ARM;  // ARM 820
+        case CE_CAB_000_ARCH_ARM920:
+            return CE_ARCH_ARM;  // ARM 920
+        case CE_CAB_000_ARCH_STRONGARM:
+            return CE_ARCH_ARM;  // StrongARM
+        case CE_CAB_000_ARCH_R4000:
+            return CE_ARCH_MIPS;  // MIPS R4000
+        case CE_CAB_000_ARCH_HITACHI_SH3:
+            return CE_ARCH_SH3;  // Hitachi SH3
+        case CE_CAB_000_ARCH_HITACHI_SH3E:
+            return CE_ARCH_SH3;  // Hitachi SH3E
+        case CE_CAB_000_ARCH_HITACHI_SH4:
+            return CE_ARCH_SH4;  // Hitachi SH4
+        case CE_CAB_000_ARCH_ALPHA:
+            return "ALPHA";  // Alpha 21064
+        case CE_CAB_000_ARCH_ARM7TDMI:
+            return CE_ARCH_THUMB;  // ARM 7TDMI
+        default:
+            return NULL;
+    }
+}
+
+const char *wcecab_hive_root_name(uint16_t hiveroot) {
+    switch (hiveroot) {
+        case 1:
+            return "HKEY_CLASSES_ROOT";
+        case 2:
+            return "HKEY_CURRENT_USER";
+        case 3:
+            return "HKEY_LOCAL_MACHINE";
+        case 4:
+            return "HKEY_USERS";
+        default:
+            return NULL;
+    }
+}
+
+const char *wcecab_basedir_name(uint16_t basedirid) {
+    if (basedirid < sizeof(BASE_DIRS) / sizeof(BASE_DIRS[0])) {
+        return BASE_DIRS[basedirid];
+    }
+    return NULL;
+}
+
+const char *wcecab_reg_datatype(uint32_t flags) {
+    switch (flags & TYPE_REG_MASK) {
+        case TYPE_REG_DWORD:
+            return "REG_DWORD";
+        case TYPE_REG_SZ:
+            return "REG_SZ";
+        case TYPE_REG_MULTI_SZ:
+            return "REG_MULTI_SZ";
+        case TYPE_REG_BINARY:
+            return "REG_BINARY";
+    }
+    return NULL;
+}
@@ -0,0 +1,408 @@
+#include "lzx.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define LZX_MIN_MATCH 2
+#define LZX_NUM_PRIMARY_LENGTHS 7
+
+#define LZX_BLOCKTYPE_VERBATIM 1
+#define LZX_BLOCKTYPE_ALIGNED 2
+#define LZX_BLOCKTYPE_UNCOMPRESSED 3
+
+/** Number of position slots for window sizes of 2^15 to 2^21 */
+static const uint8_t POSITION_SLOTS[] = {30, 32, 34, 36, 38, 42, 50};
+
+static const uint32_t POSITION_BASE[LZX_MAX_POSITION_SLOTS] = {
+    0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096,
+    6144, 8192, 12288, 16384, 24576, 32768, 49152, 65536, 98304, 131072, 196608, 262144, 393216, 524288, 655360,
+    786432, 917504, 1048576, 1179648, 1310720, 1441792, 1572864, 1703936, 1835008, 1966080};
+
+static const uint8_t EXTRA_BITS[LZX_MAX_POSITION_SLOTS] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11,
+    11, 12, 12, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17, 17};
+
+/** Bit reader over a stream of 16-bit little-endian words, read MSB first */
+typedef struct bitreader {
+    const uint8_t *in;
+    const uint8_t *in_end;
+    /** Buffered bits, left-aligned */
+    uint64_t bits;
+    int count;
+    /** Number of zero words fed past the end of the input */
+    int overrun;
+} bitreader;
+
+static inline void refill(bitreader *br) {
+    while (br->count <= 48) {
+        uint64_t word = 0;
+        if (br->in_end - br->in >= 2) {
+            word = br->in[0] | (br->in[1] << 8);
+            br->in += 2;
+        } else if (br->in < br->in_end) {
+            word = br->in[0];
+            br->in++;
+        } else {
+            br->overrun++;
+        }
+        br->bits |= word << (48 - br->count);
+        br->count += 16;
+    }
+}
+
+static inline uint32_t peekbits(bitreader *br, int n) {
+    if (br->count < n) refill(br);
+    return (uint32_t)(br->bits >> (64 - n));
+}
+
+static inline void removebits(bitreader *br, int n) {
+    br->bits <<= n;
+    br->count -= n;
+}
+
+static inline uint32_t getbits(bitreader *br, int n) {
+    if (!n) return 0;
+    uint32_t value = peekbits(br, n);
+    removebits(br, n);
+    return value;
+}
+
+/** @brief true if more bits were consumed than the input holds */
+static inline bool overrun(const bitreader *br) {
+    return br->overrun * 16 > br->count;
+}
+
+/**
+ * @brief Build a canonical Huffman decoding table from code lengths
+ *
+ * @param table table to fill
+ * @param tablebits number of bits resolved by a single lookup
+ * @param lengths code length of each symbol, 0 for unused symbols
+ * @param num number of symbols
+ * @return int 0 on success, -1 if the code is oversubscribed
+ */
+static int build_table(lzx_huffman *table, int tablebits, const uint8_t *lengths, int num) {
+    int count[17] = {0};
+    int next_code[17];
+    int code = 0;
+    int k = 0;
+
+    table->tablebits = tablebits;
+    memset(table->fast, 0, sizeof(uint16_t) << tablebits);
+    for (int i = 0; i < num; i++) count[lengths[i]]++;
+    count[0] = 0;
+
+    for (int i = 1; i <= 16; i++) {
+        next_code[i] = code;
+        table->firstcode[i] = (uint16_t)code;
+        table->firstsymbol[i] = (uint16_t)k;
+        code += count[i];
+        if (count[i] && code - 1 >= (1 << i)) return -1;
+        table->maxcode[i] = code << (16 - i);
+        code <<= 1;
+        k += count[i];
+    }
+    table->maxcode[17] = 0xFFFFFFFF;
+
+    for (int i = 0; i < num; i++) {
+        int s = lengths[i];
+        if (!s) continue;
+        int c = next_code[s] - table->firstcode[s] + table->firstsymbol[s];
+        table->size[c] = (uint8_t)s;
+        table->value[c] = (uint16_t)i;
+        if (s <= tablebits) {
+            uint16_t entry = (uint16_t)((i << 5) | s);
+            int first = next_code[s] << (tablebits - s);
+            for (int j = 0; j < (1 << (tablebits - s)); j++) {
+                table->fast[first + j] = entry;
+            }
+        }
+        next_code[s]++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Decode one symbol
+ *
+ * @return int decoded symbol, or -1 for an invalid code
+ */
+static inline int decode_symbol(bitreader *br, const lzx_huffman *table) {
+    if (br->count < 16) refill(br);
+    uint16_t entry = table->fast[br->bits >> (64 - table->tablebits)];
+    if (entry) {
+        removebits(br, entry & 0x1F);
+        return entry >> 5;
+    }
+
+    /* Slow path for codes longer than tablebits */
+    uint32_t k = (uint32_t)(br->bits >> 48);
+    int s;
+    for (s = table->tablebits + 1; k >= table->maxcode[s]; s++) {
+    }
+    if (s > 16) return -1;
+    int c = (k >> (16 - s)) - table->firstcode[s] + table->firstsymbol[s];
+    if (c < 0 || c >= LZX_MAINTREE_MAXSYMBOLS || table->size[c] != s) return -1;
+    removebits(br, s);
+    return table->value[c];
+}
+
+/**
+ * @brief Read delta coded code lengths through a freshly transmitted pretree
+ *
+ * @param lzx decoder state
+ * @param br bit reader
+ * @param lengths code lengths, updated in place
+ * @param first first symbol to read
+ * @param last one past the last symbol to read
+ * @return int 0 on success, -1 on corrupt data
+ */
+static int read_lengths(lzx_decoder *lzx, bitreader *br, uint8_t *lengths, int first, int last) {
+    uint8_t pretree_len[LZX_PRETREE_MAXSYMBOLS];
+    for (int i = 0; i < LZX_PRETREE_MAXSYMBOLS; i++) {
+        pretree_len[i] = (uint8_t)getbits(br, 4);
+    }
+    if (build_table(&lzx->pretree, LZX_PRETREE_TABLEBITS, pretree_len, LZX_PRETREE_MAXSYMBOLS)) return -1;
+
+    for (int x = first; x < last;) {
+        int z = decode_symbol(br, &lzx->pretree);
+        int run;
+        if (z < 0) return -1;
+        if (z == 17) {
+            run = getbits(br, 4) + 4;
+            if (x + run > last) return -1;
+            memset(lengths + x, 0, run);
+            x += run;
+        } else if (z == 18) {
+            run = getbits(br, 5) + 20;
+            if (x + run > last) return -1;
+            memset(lengths + x, 0, run);
+            x += run;
+        } else if (z == 19) {
+            run = getbits(br, 1) + 4;
+            if (x + run > last) return -1;
+            z = decode_symbol(br, &lzx->pretree);
+            if (z < 0 || z > 16) return -1;
+            z = lengths[x] - z;
+            if (z < 0) z += 17;
+            memset(lengths + x, z, run);
+            x += run;
+        } else {
+            z = lengths[x] - z;
+            if (z < 0) z += 17;
+            lengths[x++] = (uint8_t)z;
+        }
+    }
+    return overrun(br) ? -1 : 0;
+}
+
+/**
+ * @brief Undo the E8 call translation of one frame
+ *
+ * @param frame frame data
+ * @param frame_size size of the frame
+ * @param curpos stream offset of the frame
+ * @param filesize translation size from the stream header
+ */
+static void undo_e8_translation(uint8_t *frame, size_t frame_size, int32_t curpos, int32_t filesize) {
+    if (frame_size <= 10) return;
+    uint8_t *data = frame;
+    uint8_t *dataend = frame + frame_size - 10;
+    while (data < dataend) {
+        if (*data++ != 0xE8) {
+            curpos++;
+            continue;
+        }
+        int32_t abs_off = (int32_t)(data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+        if (abs_off >= -curpos && abs_off < filesize) {
+            int32_t rel_off = (abs_off >= 0) ? abs_off - curpos : abs_off + filesize;
+            data[0] = (uint8_t)rel_off;
+            data[1] = (uint8_t)(rel_off >> 8);
+            data[2] = (uint8_t)(rel_off >> 16);
+            data[3] = (uint8_t)(rel_off >> 24);
+        }
+        data += 4;
+        curpos += 5;
+    }
+}
+
+int lzx_decompress(lzx_decoder *lzx, int window_bits, const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len) {
+    bitreader br = {in, in + in_len, 0, 0, 0};
+    size_t pos = 0;
+    size_t frame_end = 0;
+    int block_type = 0;
+    size_t block_remaining = 0;
+    bool block_odd = false;
+
+    if (window_bits < LZX_MIN_WINDOW_BITS || window_bits > LZX_MAX_WINDOW_BITS) return -1;
+    lzx->window_size = 1u << window_bits;
+    lzx->main_elements = LZX_NUM_CHARS + POSITION_SLOTS[window_bits - LZX_MIN_WINDOW_BITS] * 8;
+    lzx->R0 = lzx->R1 = lzx->R2 = 1;
+    memset(lzx->maintree_len, 0, sizeof(lzx->maintree_len));
+    memset(lzx->lengthtree_len, 0, sizeof(lzx->lengthtree_len));
+
+    /* Stream header: E8 translation size */
+    int32_t intel_filesize = 0;
+    if (getbits(&br, 1)) {
+        uint32_t high = getbits(&br, 16);
+        uint32_t low = getbits(&br, 16);
+        intel_filesize = (int32_t)((high << 16) | low);
+    }
+
+    while (pos < out_len) {
+        /* The bitstream is realigned to 16 bits after every frame, matches may
+         * run over into the next frame */
+        frame_end += LZX_FRAME_SIZE;
+        if (frame_end > out_len) frame_end = out_len;
+
+        while (pos < frame_end) {
+            if (!block_remaining) {
+                if (block_type == LZX_BLOCKTYPE_UNCOMPRESSED && block_odd) {
+                    /* Uncompressed blocks of odd length are padded to 16 bits */
+                    if (br.in >= br.in_end) return -1;
+                    br.in++;
+                }
+                block_type = getbits(&br, 3);
+                uint32_t high = getbits(&br, 16);
+                uint32_t low = getbits(&br, 8);
+                block_remaining = (high << 8) | low;
+                block_odd = block_remaining & 1;
+
+                switch (block_type) {
+                    case LZX_BLOCKTYPE_ALIGNED:
+                        for (int i = 0; i < LZX_ALIGNED_MAXSYMBOLS; i++) {
+                            lzx->alignedtree_len[i] = (uint8_t)getbits(&br, 3);
+                        }
+                        if (build_table(&lzx->alignedtree, LZX_ALIGNED_TABLEBITS, lzx->alignedtree_len, LZX_ALIGNED_MAXSYMBOLS)) return -1;
+                        /* The rest of the header is the same as for verbatim
+                         * blocks */
+                        /* fall through */
+                    case LZX_BLOCKTYPE_VERBATIM:
+                        if (read_lengths(lzx, &br, lzx->maintree_len, 0, LZX_NUM_CHARS)) return -1;
+                        if (read_lengths(lzx, &br, lzx->maintree_len, LZX_NUM_CHARS, lzx->main_elements)) return -1;
+                        if (build_table(&lzx->maintree, LZX_MAINTREE_TABLEBITS, lzx->maintree_len, lzx->main_elements)) return -1;
+                        if (read_lengths(lzx, &br, lzx->lengthtree_len, 0, LZX_LENGTH_MAXSYMBOLS)) return -1;
+                        if (build_table(&lzx->lengthtree, LZX_LENGTH_TABLEBITS, lzx->lengthtree_len, LZX_LENGTH_MAXSYMBOLS)) return -1;
+                        break;
+                    case LZX_BLOCKTYPE_UNCOMPRESSED: {
+                        /* Skip 1-16 bits of padding to the next 16-bit boundary
+                         * and hand the words still buffered back to the input */
+                        if (overrun(&br)) return -1;
+                        int words = br.count / 16 - br.overrun;
+                        if (!(br.count & 15)) {
+                            if (words) {
+                                words--;
+                            } else {
+                                br.in += 2;
+                            }
+                        }
+                        br.in -= 2 * words;
+                        br.bits = 0;
+                        br.count = 0;
+                        br.overrun = 0;
+                        if (br.in > br.in_end || br.in_end - br.in < 12) return -1;
+                        lzx->R0 = br.in[0] | (br.in[1] << 8) | (br.in[2] << 16) | ((uint32_t)br.in[3] << 24);
+                        lzx->R1 = br.in[4] | (br.in[5] << 8) | (br.in[6] << 16) | ((uint32_t)br.in[7] << 24);
+                        lzx->R2 = br.in[8] | (br.in[9] << 8) | (br.in[10] << 16) | ((uint32_t)br.in[11] << 24);
+                        br.in += 12;
+                        break;
+                    }
+                    default:
+                        return -1;
+                }
+                if (overrun(&br)) return -1;
+                continue;
+            }
+
+            size_t run = frame_end - pos;
+            if (run > block_remaining) run = block_remaining;
+
+            if (block_type == LZX_BLOCKTYPE_UNCOMPRESSED) {
+                if ((size_t)(br.in_end - br.in) < run) return -1;
+                memcpy(out + pos, br.in, run);
+                br.in += run;
+                pos += run;
+                block_remaining -= run;
+                continue;
+            }
+
+            size_t run_end = pos + run;
+            while (pos < run_end) {
+                int main_element = decode_symbol(&br, &lzx->maintree);
+                if (main_element < 0) return -1;
+                if (main_element < LZX_NUM_CHARS) {
+                    out[pos++] = (uint8_t)main_element;
+                    continue;
+                }
+
+                main_element -= LZX_NUM_CHARS;
+                size_t match_length = main_element & LZX_NUM_PRIMARY_LENGTHS;
+                if (match_length == LZX_NUM_PRIMARY_LENGTHS) {
+                    int length_footer = decode_symbol(&br, &lzx->lengthtree);
+                    if (length_footer < 0) return -1;
+                    match_length += length_footer;
+                }
+                match_length += LZX_MIN_MATCH;
+
+                uint32_t match_offset = main_element >> 3;
+                if (match_offset > 2) {
+                    /* Not a repeated offset */
+                    int extra = EXTRA_BITS[match_offset];
+                    if (match_offset == 3) {
+                        match_offset = 1;
+                    } else if (block_type == LZX_BLOCKTYPE_ALIGNED && extra >= 3) {
+                        uint32_t verbatim = getbits(&br, extra - 3) << 3;
+                        int aligned = decode_symbol(&br, &lzx->alignedtree);
+                        if (aligned < 0) return -1;
+                        match_offset = POSITION_BASE[match_offset] - 2 + verbatim + aligned;
+                    } else {
+                        match_offset = POSITION_BASE[match_offset] - 2 + getbits(&br, extra);
+                    }
+                    lzx->R2 = lzx->R1;
+                    lzx->R1 = lzx->R0;
+                    lzx->R0 = match_offset;
+                } else if (match_offset == 0) {
+                    match_offset = lzx->R0;
+                } else if (match_offset == 1) {
+                    match_offset = lzx->R1;
+                    lzx->R1 = lzx->R0;
+                    lzx->R0 = match_offset;
+                } else {
+                    match_offset = lzx->R2;
+                    lzx->R2 = lzx->R0;
+                    lzx->R0 = match_offset;
+                }
+
+                if (!match_offset || match_offset > pos || match_offset > lzx->window_size) return -1;
+                /* A match may continue past out_len when only a prefix of the
+                 * stream is decoded */
+                if (match_length > out_len - pos) match_length = out_len - pos;
+                uint8_t *dst = out + pos;
+                const uint8_t *src = dst - match_offset;
+                if (match_offset >= match_length) {
+                    memcpy(dst, src, match_length);
+                } else {
+                    for (size_t i = 0; i < match_length; i++) dst[i] = src[i];
+                }
+                pos += match_length;
+            }
+            if (overrun(&br)) return -1;
+
+            /* A match may run past the end of the frame, but not the block */
+            if (pos - (run_end - run) > block_remaining) return -1;
+            block_remaining -= pos - (run_end - run);
+        }
+
+        /* Realign the bitstream */
+        removebits(&br, br.count & 15);
+    }
+
+    if (intel_filesize) {
+        for (size_t frame = 0; frame * LZX_FRAME_SIZE < out_len && frame < 32768; frame++) {
+            size_t start = frame * LZX_FRAME_SIZE;
+            size_t size = out_len - start < LZX_FRAME_SIZE ? out_len - start : LZX_FRAME_SIZE;
+            undo_e8_translation(out + start, size, (int32_t)start, intel_filesize);
+        }
+    }
+    return 0;
+}
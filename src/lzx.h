@@ -0,0 +1,84 @@
+#ifndef LZX_H
+#define LZX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZX_MIN_WINDOW_BITS 15
+#define LZX_MAX_WINDOW_BITS 21
+/** Size of an LZX frame, the unit of E8 translation and bitstream realignment */
+#define LZX_FRAME_SIZE 32768
+
+#define LZX_NUM_CHARS 256
+#define LZX_MAX_POSITION_SLOTS 50
+#define LZX_MAINTREE_MAXSYMBOLS (LZX_NUM_CHARS + LZX_MAX_POSITION_SLOTS * 8)
+#define LZX_LENGTH_MAXSYMBOLS 249
+#define LZX_ALIGNED_MAXSYMBOLS 8
+#define LZX_PRETREE_MAXSYMBOLS 20
+
+#define LZX_MAINTREE_TABLEBITS 12
+#define LZX_LENGTH_TABLEBITS 12
+#define LZX_ALIGNED_TABLEBITS 7
+#define LZX_PRETREE_TABLEBITS 6
+
+/**
+ * Huffman decoding table. Codes up to tablebits long are resolved by a single
+ * lookup, longer codes by a canonical code search.
+ */
+typedef struct lzx_huffman {
+    /** Number of bits resolved by the lookup table */
+    int tablebits;
+    /** (symbol << 5) | length, indexed by the next tablebits input bits. 0 if
+     * the code is longer */
+    uint16_t fast[1 << LZX_MAINTREE_TABLEBITS];
+    /** One past the last code of each length, left-aligned to 16 bits */
+    uint32_t maxcode[18];
+    /** First canonical code of each length */
+    uint16_t firstcode[17];
+    /** Index into value of the first symbol of each length */
+    uint16_t firstsymbol[17];
+    /** Symbols sorted by canonical code */
+    uint16_t value[LZX_MAINTREE_MAXSYMBOLS];
+    /** Code length of each entry in value */
+    uint8_t size[LZX_MAINTREE_MAXSYMBOLS];
+} lzx_huffman;
+
+/** LZX decoder state, reusable across folders and files */
+typedef struct lzx_decoder {
+    /** Window size of the current stream */
+    uint32_t window_size;
+    /** Number of main tree symbols for the current window size */
+    uint16_t main_elements;
+    /** Repeated offsets */
+    uint32_t R0, R1, R2;
+    /** Code lengths, kept between blocks for delta coding */
+    uint8_t maintree_len[LZX_MAINTREE_MAXSYMBOLS];
+    uint8_t lengthtree_len[LZX_LENGTH_MAXSYMBOLS];
+    uint8_t alignedtree_len[LZX_ALIGNED_MAXSYMBOLS];
+    lzx_huffman maintree;
+    lzx_huffman lengthtree;
+    lzx_huffman alignedtree;
+    lzx_huffman pretree;
+} lzx_decoder;
+
+/**
+ * @brief Decompress an LZX stream, e.g. the concatenated CFDATA blocks of a
+ * cabinet folder
+ *
+ * The stream is decoded from its start, straight into out, which also serves
+ * as the history window. Decoding stops once out_len bytes have been produced,
+ * so a prefix of the stream can be decoded by passing a shorter out_len. E8
+ * call translation is applied per frame, so out_len has to be a multiple of
+ * LZX_FRAME_SIZE or the full uncompressed length of the stream.
+ *
+ * @param lzx decoder state, reinitialized for every stream
+ * @param window_bits window size of the stream as a power of two
+ * @param in compressed data
+ * @param in_len length of the compressed data
+ * @param out buffer to write the uncompressed data to
+ * @param out_len number of bytes to decode
+ * @return int 0 on success, -1 if the data is corrupt
+ */
+int lzx_decompress(lzx_decoder *lzx, int window_bits, const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len);
+
+#endif
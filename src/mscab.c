@@ -0,0 +1,310 @@
+#include "mscab.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/**
+ * @brief Skip a null-terminated string
+ *
+ * @param cab cabinet
+ * @param offset offset of the string, advanced past its null terminator
+ * @return bool true if the string is terminated within the cabinet
+ */
+static bool skip_string(const mscab_cabinet *cab, size_t *offset) {
+    if (*offset >= cab->size) return false;
+    const uint8_t *end = memchr(cab->data + *offset, '\0', cab->size - *offset);
+    if (!end) return false;
+    *offset = end - cab->data + 1;
+    return true;
+}
+
+/**
+ * @brief Parse the cabinet header and locate the folder table
+ *
+ * @param data cabinet file contents
+ * @param size size of the cabinet file in bytes
+ * @param cab struct to write the layout into
+ * @return int MSCAB_OK or MSCAB_ERR_FORMAT
+ */
+static int open_cabinet(const void *data, size_t size, mscab_cabinet *cab) {
+    cab->data = data;
+    cab->size = size;
+    cab->header = data;
+
+    if (size < sizeof(MS_CAB_HEADER) || cab->header->Signature != CE_CAB_HEADER_SIGNATURE) {
+        return MSCAB_ERR_FORMAT;
+    }
+    if (cab->header->CabinetSize > size) {
+        return MSCAB_ERR_FORMAT;
+    }
+    cab->size = cab->header->CabinetSize;
+
+    size_t offset = sizeof(MS_CAB_HEADER);
+    size_t folder_reserve = 0;
+    size_t data_reserve = 0;
+
+    if (cab->header->Flags & MS_CAB_FLAG_RESERVE_PRESENT) {
+        if (offset + 4 > cab->size) return MSCAB_ERR_FORMAT;
+        const uint8_t *reserve = cab->data + offset;
+        size_t header_reserve = reserve[0] | (reserve[1] << 8);
+        folder_reserve = reserve[2];
+        data_reserve = reserve[3];
+        offset += 4 + header_reserve;
+    }
+    if (cab->header->Flags & MS_CAB_FLAG_PREV_CABINET) {
+        if (!skip_string(cab, &offset) || !skip_string(cab, &offset)) return MSCAB_ERR_FORMAT;
+    }
+    if (cab->header->Flags & MS_CAB_FLAG_NEXT_CABINET) {
+        if (!skip_string(cab, &offset) || !skip_string(cab, &offset)) return MSCAB_ERR_FORMAT;
+    }
+
+    cab->offset_folders = offset;
+    cab->folder_size = sizeof(MS_CAB_FOLDER_ENTRY) + folder_reserve;
+    cab->data_header_size = sizeof(MS_CAB_DATA_ENTRY) + data_reserve;
+
+    if (offset + cab->header->NumFolders * cab->folder_size > cab->size) {
+        return MSCAB_ERR_FORMAT;
+    }
+    return MSCAB_OK;
+}
+
+/**
+ * @brief Find the first file with a .000 extension in the cabinet
+ *
+ * @param cab cabinet
+ * @param entry pointer to write the file entry to
+ * @return int MSCAB_OK, MSCAB_ERR_FORMAT or MSCAB_ERR_NOT_FOUND
+ */
+static int find_000(const mscab_cabinet *cab, const MS_CAB_FILE_ENTRY **entry) {
+    size_t offset = cab->header->OffsetFiles;
+    for (int i = 0; i < cab->header->NumFiles; i++) {
+        if (offset + offsetof(MS_CAB_FILE_ENTRY, Name) > cab->size) return MSCAB_ERR_FORMAT;
+        const MS_CAB_FILE_ENTRY *fileentry = (const MS_CAB_FILE_ENTRY *)(cab->data + offset);
+        size_t name_offset = offset + offsetof(MS_CAB_FILE_ENTRY, Name);
+        offset = name_offset;
+        if (!skip_string(cab, &offset)) return MSCAB_ERR_FORMAT;
+
+        size_t name_length = offset - name_offset - 1;
+        if (name_length >= 4 && !strcasecmp(&(fileentry->Name) + name_length - 4, ".000")) {
+            *entry = fileentry;
+            return MSCAB_OK;
+        }
+    }
+    return MSCAB_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Make sure a decoder buffer holds at least size bytes
+ *
+ * @param buffer buffer to grow
+ * @param buffer_size allocated size of the buffer
+ * @param size required size
+ * @return bool false if the allocation failed
+ */
+static bool reserve(uint8_t **buffer, size_t *buffer_size, size_t size) {
+    if (size <= *buffer_size && *buffer) return true;
+    uint8_t *grown = realloc(*buffer, size ? size : 1);
+    if (!grown) return false;
+    *buffer = grown;
+    *buffer_size = size;
+    return true;
+}
+
+/**
+ * @brief Decode the data blocks of a folder that are needed to get at an
+ * uncompressed byte range
+ *
+ * Decoding stops with the block containing the end of the range. Stored blocks
+ * before the range are skipped, compressed ones are decoded as they provide
+ * the history for the blocks that follow.
+ *
+ * @param decoder decoder state
+ * @param cab cabinet
+ * @param folder folder entry
+ * @param range_start uncompressed offset of the range in the folder
+ * @param range_end uncompressed offset of the end of the range in the folder
+ * @param range pointer to write the start of the decoded range to
+ * @param in_place set to true if range points into the cabinet itself
+ * @return int MSCAB_OK or one of MSCAB_ERR_*
+ */
+static int read_folder_range(mscab_decoder *decoder, const mscab_cabinet *cab, const MS_CAB_FOLDER_ENTRY *folder, size_t range_start, size_t range_end, const uint8_t **range, bool *in_place) {
+    uint16_t compression = folder->CompressionType & MS_CAB_COMPRESS_MASK;
+    if (compression != MS_CAB_COMPRESS_NONE && compression != MS_CAB_COMPRESS_MSZIP && compression != MS_CAB_COMPRESS_LZX) {
+        return MSCAB_ERR_COMPRESSION;
+    }
+
+    /* Walk the block headers up to the block containing the end of the range.
+     * They give the uncompressed size up front, so every block can be decoded
+     * straight into its final position */
+    size_t offset = folder->OffsetData;
+    size_t total = 0;
+    size_t total_compressed = 0;
+    int num_blocks = 0;
+    /* Index and uncompressed offset of the first block overlapping the range */
+    int first_block = 0;
+    size_t first_block_start = 0;
+    /* Cabinet offset of the last block walked */
+    size_t last_block_offset = 0;
+    *in_place = false;
+    while (total < range_end || !num_blocks) {
+        if (num_blocks >= folder->NumDataBlocks) return MSCAB_ERR_FORMAT;
+        if (offset + cab->data_header_size > cab->size) return MSCAB_ERR_FORMAT;
+        const MS_CAB_DATA_ENTRY *block = (const MS_CAB_DATA_ENTRY *)(cab->data + offset);
+        last_block_offset = offset;
+        offset += cab->data_header_size + block->CompressedSize;
+        if (offset > cab->size) return MSCAB_ERR_FORMAT;
+        if (total + block->UncompressedSize <= range_start) {
+            first_block = num_blocks + 1;
+            first_block_start = total + block->UncompressedSize;
+        }
+        total += block->UncompressedSize;
+        total_compressed += block->CompressedSize;
+        num_blocks++;
+    }
+
+    if (compression == MS_CAB_COMPRESS_NONE && first_block == num_blocks - 1) {
+        /* The range lies within a single stored block, use it in place */
+        const MS_CAB_DATA_ENTRY *block = (const MS_CAB_DATA_ENTRY *)(cab->data + last_block_offset);
+        if (block->CompressedSize != block->UncompressedSize) return MSCAB_ERR_DATA;
+        *range = cab->data + last_block_offset + cab->data_header_size + (range_start - first_block_start);
+        *in_place = true;
+        return MSCAB_OK;
+    }
+
+    if (compression == MS_CAB_COMPRESS_NONE) {
+        /* Stored blocks do not depend on each other, copy only the ones
+         * overlapping the range */
+        if (!reserve(&decoder->buffer, &decoder->buffer_size, total - first_block_start)) return MSCAB_ERR_NOMEM;
+        offset = folder->OffsetData;
+        size_t position = 0;
+        for (int i = 0; i < num_blocks; i++) {
+            const MS_CAB_DATA_ENTRY *block = (const MS_CAB_DATA_ENTRY *)(cab->data + offset);
+            if (i >= first_block) {
+                if (block->CompressedSize != block->UncompressedSize) return MSCAB_ERR_DATA;
+                memcpy(decoder->buffer + position, cab->data + offset + cab->data_header_size, block->UncompressedSize);
+                position += block->UncompressedSize;
+            }
+            offset += cab->data_header_size + block->CompressedSize;
+        }
+        *range = decoder->buffer + (range_start - first_block_start);
+        return MSCAB_OK;
+    }
+
+    if (!reserve(&decoder->buffer, &decoder->buffer_size, total)) return MSCAB_ERR_NOMEM;
+    uint8_t *buffer = decoder->buffer;
+    *range = buffer + range_start;
+
+    if (compression == MS_CAB_COMPRESS_LZX) {
+        /* The LZX bitstream runs across block boundaries */
+        if (!decoder->lzx && !(decoder->lzx = malloc(sizeof(lzx_decoder)))) return MSCAB_ERR_NOMEM;
+        if (!reserve(&decoder->input, &decoder->input_size, total_compressed)) return MSCAB_ERR_NOMEM;
+
+        offset = folder->OffsetData;
+        size_t position = 0;
+        for (int i = 0; i < num_blocks; i++) {
+            const MS_CAB_DATA_ENTRY *block = (const MS_CAB_DATA_ENTRY *)(cab->data + offset);
+            memcpy(decoder->input + position, cab->data + offset + cab->data_header_size, block->CompressedSize);
+            position += block->CompressedSize;
+            offset += cab->data_header_size + block->CompressedSize;
+        }
+
+        /* Each block holds one LZX frame, so total is frame aligned */
+        int window_bits = (folder->CompressionType >> 8) & 0x1F;
+        if (lzx_decompress(decoder->lzx, window_bits, decoder->input, total_compressed, buffer, total)) return MSCAB_ERR_DATA;
+        return MSCAB_OK;
+    }
+
+    if (!decoder->mszip) {
+        if (!(decoder->mszip = malloc(sizeof(mszip_decoder)))) return MSCAB_ERR_NOMEM;
+        mszip_init(decoder->mszip);
+    }
+
+    offset = folder->OffsetData;
+    size_t position = 0;
+    for (int i = 0; i < num_blocks; i++) {
+        const MS_CAB_DATA_ENTRY *block = (const MS_CAB_DATA_ENTRY *)(cab->data + offset);
+        const uint8_t *blockdata = cab->data + offset + cab->data_header_size;
+        if (mszip_decompress_block(decoder->mszip, blockdata, block->CompressedSize, buffer + position, block->UncompressedSize, position)) {
+            return MSCAB_ERR_DATA;
+        }
+        position += block->UncompressedSize;
+        offset += cab->data_header_size + block->CompressedSize;
+    }
+    return MSCAB_OK;
+}
+
+void mscab_decoder_init(mscab_decoder *decoder) {
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+void mscab_decoder_free(mscab_decoder *decoder) {
+    free(decoder->buffer);
+    free(decoder->input);
+    free(decoder->mszip);
+    free(decoder->lzx);
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+int mscab_open(const void *data, size_t size, mscab_cabinet *cab) {
+    int status;
+
+    if ((status = open_cabinet(data, size, cab)) != MSCAB_OK) return status;
+    return find_000(cab, &cab->file);
+}
+
+int mscab_extract(mscab_decoder *decoder, const mscab_cabinet *cab, mscab_file *out) {
+    const MS_CAB_FILE_ENTRY *fileentry = cab->file;
+    int status;
+
+    if (fileentry->FolderIndex >= MS_CAB_IFOLDER_CONTINUED_FROM_PREV) {
+        return MSCAB_ERR_SPANNED;
+    }
+    if (fileentry->FolderIndex >= cab->header->NumFolders) {
+        return MSCAB_ERR_FORMAT;
+    }
+
+    const MS_CAB_FOLDER_ENTRY *folder = (const MS_CAB_FOLDER_ENTRY *)(cab->data + cab->offset_folders + fileentry->FolderIndex * cab->folder_size);
+
+    /* Only the blocks up to the end of the .000 file are decoded */
+    size_t range_start = fileentry->FolderOffset;
+    size_t range_end = range_start + fileentry->FileSize;
+    const uint8_t *range;
+    bool in_place;
+    if ((status = read_folder_range(decoder, cab, folder, range_start, range_end, &range, &in_place)) != MSCAB_OK) return status;
+
+    out->data = range;
+    out->size = fileentry->FileSize;
+    out->in_place = in_place;
+    return MSCAB_OK;
+}
+
+int mscab_extract_000(mscab_decoder *decoder, const void *data, size_t size, mscab_file *out) {
+    mscab_cabinet cab;
+    int status;
+
+    if ((status = mscab_open(data, size, &cab)) != MSCAB_OK) return status;
+    return mscab_extract(decoder, &cab, out);
+}
+
+const char *mscab_strerror(int status) {
+    switch (status) {
+        case MSCAB_OK:
+            return "Success";
+        case MSCAB_ERR_FORMAT:
+            return "Invalid or truncated cabinet file";
+        case MSCAB_ERR_NOT_FOUND:
+            return "Cabinet does not contain a .000 file";
+        case MSCAB_ERR_COMPRESSION:
+            return "Unsupported compression type";
+        case MSCAB_ERR_DATA:
+            return "Corrupt compressed data";
+        case MSCAB_ERR_SPANNED:
+            return ".000 file spans several cabinets";
+        case MSCAB_ERR_NOMEM:
+            return "Out of memory";
+        default:
+            return "Unknown error";
+    }
+}
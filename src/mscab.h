@@ -0,0 +1,140 @@
+#ifndef MSCAB_H
+#define MSCAB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MSCabHeader.h"
+#include "lzx.h"
+#include "mszip.h"
+
+/* Status codes returned by the mscab functions */
+
+#define MSCAB_OK 0
+/** The input is not a valid cabinet file */
+#define MSCAB_ERR_FORMAT 1
+/** The cabinet does not contain a .000 file */
+#define MSCAB_ERR_NOT_FOUND 2
+/** The folder containing the .000 file uses an unsupported compression */
+#define MSCAB_ERR_COMPRESSION 3
+/** The compressed data of the folder is corrupt */
+#define MSCAB_ERR_DATA 4
+/** The .000 file is split across several cabinets */
+#define MSCAB_ERR_SPANNED 5
+/** Memory allocation failed */
+#define MSCAB_ERR_NOMEM 6
+
+typedef struct mscab_file {
+    /** Pointer to the extracted file contents */
+    const void *data;
+    /** Size of the extracted file in bytes */
+    size_t size;
+    /** true if data points into the cabinet contents passed in, which then
+     * have to stay valid as long as data is used */
+    bool in_place;
+} mscab_file;
+
+/** Parsed layout of a cabinet file */
+typedef struct mscab_cabinet {
+    /** Pointer to the cabinet file contents */
+    const uint8_t *data;
+    /** Size of the cabinet file in bytes */
+    size_t size;
+    /** Cabinet header */
+    const MS_CAB_HEADER *header;
+    /** Offset of the first CFFOLDER entry */
+    size_t offset_folders;
+    /** Size of one CFFOLDER entry, including its reserved area */
+    size_t folder_size;
+    /** Size of one CFDATA header, including its reserved area */
+    size_t data_header_size;
+    /** File entry of the .000 file */
+    const MS_CAB_FILE_ENTRY *file;
+} mscab_cabinet;
+
+/**
+ * Decoder state for extracting files from cabinets. The buffers and decoder
+ * tables are kept between calls, so extracting from a batch of cabinets
+ * allocates only when a cabinet needs more space than the ones before it.
+ */
+typedef struct mscab_decoder {
+    /** Uncompressed folder data, also serving as the history window */
+    uint8_t *buffer;
+    /** Allocated size of buffer */
+    size_t buffer_size;
+    /** Concatenated compressed data of an LZX folder */
+    uint8_t *input;
+    /** Allocated size of input */
+    size_t input_size;
+    /** MSZIP decoder, allocated on first use */
+    mszip_decoder *mszip;
+    /** LZX decoder, allocated on first use */
+    lzx_decoder *lzx;
+} mscab_decoder;
+
+/**
+ * @brief Initialize a decoder
+ *
+ * @param decoder decoder to initialize
+ */
+void mscab_decoder_init(mscab_decoder *decoder);
+
+/**
+ * @brief Release all memory held by a decoder
+ *
+ * @param decoder decoder to release
+ */
+void mscab_decoder_free(mscab_decoder *decoder);
+
+/**
+ * @brief Parse the header of a cabinet held in memory and locate its .000
+ * file
+ *
+ * @param cab pointer to the cabinet file contents
+ * @param cab_size size of the cabinet file in bytes
+ * @param cabinet struct to write the layout into
+ * @return int MSCAB_OK on success, MSCAB_ERR_FORMAT or MSCAB_ERR_NOT_FOUND
+ * otherwise
+ */
+int mscab_open(const void *cab, size_t cab_size, mscab_cabinet *cabinet);
+
+/**
+ * @brief Extract the .000 file of a cabinet opened with mscab_open()
+ *
+ * The extracted data is owned by the decoder and stays valid until the next
+ * call with the same decoder. If the file is stored uncompressed in a single
+ * data block, no copy is made and data points into the cabinet instead.
+ *
+ * @param decoder decoder state
+ * @param cabinet opened cabinet
+ * @param out struct to write the extracted file into
+ * @return int MSCAB_OK on success, one of MSCAB_ERR_* otherwise
+ */
+int mscab_extract(mscab_decoder *decoder, const mscab_cabinet *cabinet, mscab_file *out);
+
+/**
+ * @brief Extract the .000 file from a cabinet held in memory, see
+ * mscab_open() and mscab_extract()
+ *
+ * The extracted data is owned by the decoder and stays valid until the next
+ * call with the same decoder. If the file is stored uncompressed in a single
+ * data block, no copy is made and data points into the cabinet instead.
+ *
+ * @param decoder decoder state
+ * @param cab pointer to the cabinet file contents
+ * @param cab_size size of the cabinet file in bytes
+ * @param out struct to write the extracted file into
+ * @return int MSCAB_OK on success, one of MSCAB_ERR_* otherwise
+ */
+int mscab_extract_000(mscab_decoder *decoder, const void *cab, size_t cab_size, mscab_file *out);
+
+/**
+ * @brief Get a description of an mscab status code
+ *
+ * @param status status code
+ * @return const char* description
+ */
+const char *mscab_strerror(int status);
+
+#endif
@@ -0,0 +1,276 @@
+#include "mszip.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t CODELENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/** LSB-first bit reader over a compressed block */
+typedef struct bitreader {
+    const uint8_t *in;
+    const uint8_t *in_end;
+    uint64_t bits;
+    int count;
+    /** Number of zero bytes fed past the end of the input */
+    int overrun;
+} bitreader;
+
+static inline void refill(bitreader *br) {
+    while (br->count <= 56) {
+        uint64_t byte = 0;
+        if (br->in < br->in_end) {
+            byte = *br->in++;
+        } else {
+            br->overrun++;
+        }
+        br->bits |= byte << br->count;
+        br->count += 8;
+    }
+}
+
+static inline uint32_t getbits(bitreader *br, int n) {
+    if (br->count < n) refill(br);
+    uint32_t value = br->bits & ((1u << n) - 1);
+    br->bits >>= n;
+    br->count -= n;
+    return value;
+}
+
+/** @brief true if more bits were consumed than the input holds */
+static inline bool overrun(const bitreader *br) {
+    return br->overrun * 8 > br->count;
+}
+
+static inline uint16_t reverse16(uint16_t n) {
+    n = ((n & 0xAAAA) >> 1) | ((n & 0x5555) << 1);
+    n = ((n & 0xCCCC) >> 2) | ((n & 0x3333) << 2);
+    n = ((n & 0xF0F0) >> 4) | ((n & 0x0F0F) << 4);
+    n = ((n & 0xFF00) >> 8) | ((n & 0x00FF) << 8);
+    return n;
+}
+
+/**
+ * @brief Build a canonical Huffman decoding table from code lengths
+ *
+ * @param table table to fill
+ * @param lengths code length of each symbol, 0 for unused symbols
+ * @param num number of symbols
+ * @return int 0 on success, -1 if the code is oversubscribed
+ */
+static int build_huffman(mszip_huffman *table, const uint8_t *lengths, int num) {
+    int count[17] = {0};
+    int next_code[16];
+    int code = 0;
+    int k = 0;
+
+    memset(table->fast, 0, sizeof(table->fast));
+    for (int i = 0; i < num; i++) count[lengths[i]]++;
+    count[0] = 0;
+
+    for (int i = 1; i < 16; i++) {
+        next_code[i] = code;
+        table->firstcode[i] = (uint16_t)code;
+        table->firstsymbol[i] = (uint16_t)k;
+        code += count[i];
+        if (count[i] && code - 1 >= (1 << i)) return -1;
+        table->maxcode[i] = code << (16 - i);
+        code <<= 1;
+        k += count[i];
+    }
+    table->maxcode[16] = 0x10000;
+    table->maxcode[17] = 0xFFFFFFFF;
+
+    for (int i = 0; i < num; i++) {
+        int s = lengths[i];
+        if (!s) continue;
+        int c = next_code[s] - table->firstcode[s] + table->firstsymbol[s];
+        table->size[c] = (uint8_t)s;
+        table->value[c] = (uint16_t)i;
+        if (s <= MSZIP_FAST_BITS) {
+            uint16_t entry = (uint16_t)((s << 9) | i);
+            for (int j = reverse16(next_code[s]) >> (16 - s); j < (1 << MSZIP_FAST_BITS); j += (1 << s)) {
+                table->fast[j] = entry;
+            }
+        }
+        next_code[s]++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Decode one symbol
+ *
+ * @return int decoded symbol, or -1 for an invalid code
+ */
+static inline int decode_symbol(bitreader *br, const mszip_huffman *table) {
+    if (br->count < 16) refill(br);
+    uint16_t entry = table->fast[br->bits & ((1 << MSZIP_FAST_BITS) - 1)];
+    if (entry) {
+        int s = entry >> 9;
+        br->bits >>= s;
+        br->count -= s;
+        return entry & 0x1FF;
+    }
+
+    /* Slow path for codes longer than MSZIP_FAST_BITS */
+    int k = reverse16((uint16_t)br->bits);
+    int s;
+    for (s = MSZIP_FAST_BITS + 1; k >= (int)table->maxcode[s]; s++) {
+    }
+    if (s >= 16) return -1;
+    int c = (k >> (16 - s)) - table->firstcode[s] + table->firstsymbol[s];
+    if (c < 0 || c >= 288 || table->size[c] != s) return -1;
+    br->bits >>= s;
+    br->count -= s;
+    return table->value[c];
+}
+
+void mszip_init(mszip_decoder *decoder) {
+    uint8_t lengths[288];
+    int i = 0;
+    for (; i < 144; i++) lengths[i] = 8;
+    for (; i < 256; i++) lengths[i] = 9;
+    for (; i < 280; i++) lengths[i] = 7;
+    for (; i < 288; i++) lengths[i] = 8;
+    build_huffman(&decoder->fixed_litlen, lengths, 288);
+
+    memset(lengths, 5, 30);
+    build_huffman(&decoder->fixed_dist, lengths, 30);
+}
+
+/**
+ * @brief Read the code length tables of a dynamic block
+ */
+static int read_dynamic_tables(mszip_decoder *decoder, bitreader *br) {
+    mszip_huffman *codelength = &decoder->dist;
+    uint8_t codelength_lengths[19] = {0};
+    uint8_t lengths[286 + 32];
+
+    int hlit = getbits(br, 5) + 257;
+    int hdist = getbits(br, 5) + 1;
+    int hclen = getbits(br, 4) + 4;
+    if (hlit > 286 || hdist > 30) return -1;
+
+    for (int i = 0; i < hclen; i++) {
+        codelength_lengths[CODELENGTH_ORDER[i]] = (uint8_t)getbits(br, 3);
+    }
+    /* The distance table is only needed after the code lengths are read, so it
+     * holds the code length code in the meantime */
+    if (build_huffman(codelength, codelength_lengths, 19)) return -1;
+
+    int n = 0;
+    while (n < hlit + hdist) {
+        int sym = decode_symbol(br, codelength);
+        int repeat;
+        uint8_t fill;
+        if (sym < 0) return -1;
+        if (sym < 16) {
+            lengths[n++] = (uint8_t)sym;
+            continue;
+        } else if (sym == 16) {
+            if (!n) return -1;
+            repeat = getbits(br, 2) + 3;
+            fill = lengths[n - 1];
+        } else if (sym == 17) {
+            repeat = getbits(br, 3) + 3;
+            fill = 0;
+        } else {
+            repeat = getbits(br, 7) + 11;
+            fill = 0;
+        }
+        if (n + repeat > hlit + hdist) return -1;
+        memset(lengths + n, fill, repeat);
+        n += repeat;
+    }
+    if (overrun(br) || !lengths[256]) return -1;
+
+    if (build_huffman(&decoder->litlen, lengths, hlit)) return -1;
+    if (build_huffman(&decoder->dist, lengths + hlit, hdist)) return -1;
+    return 0;
+}
+
+int mszip_decompress_block(mszip_decoder *decoder, const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len, size_t history) {
+    bitreader br = {0};
+    size_t pos = 0;
+    bool final = false;
+
+    if (in_len < 2 || in[0] != 'C' || in[1] != 'K') return -1;
+    br.in = in + 2;
+    br.in_end = in + in_len;
+    if (history > MSZIP_WINDOW_SIZE) history = MSZIP_WINDOW_SIZE;
+
+    while (!final) {
+        final = getbits(&br, 1);
+        int type = getbits(&br, 2);
+
+        if (type == 0) {
+            /* Stored block: drop to the byte boundary, then copy. Whole bytes
+             * still held in the bit buffer are returned to the input first */
+            getbits(&br, br.count & 7);
+            if (overrun(&br)) return -1;
+            br.in -= br.count / 8 - br.overrun;
+            br.bits = 0;
+            br.count = 0;
+            br.overrun = 0;
+            if (br.in_end - br.in < 4) return -1;
+            uint16_t len = br.in[0] | (br.in[1] << 8);
+            uint16_t nlen = br.in[2] | (br.in[3] << 8);
+            br.in += 4;
+            // NLEN is the complement of LEN, compared as ints so no promoted
+            // complement is compared with an unsigned value
+            if ((len ^ nlen) != 0xFFFF || len > br.in_end - br.in || len > out_len - pos) return -1;
+            memcpy(out + pos, br.in, len);
+            br.in += len;
+            pos += len;
+            continue;
+        }
+
+        const mszip_huffman *litlen;
+        const mszip_huffman *dist;
+        if (type == 1) {
+            litlen = &decoder->fixed_litlen;
+            dist = &decoder->fixed_dist;
+        } else if (type == 2) {
+            if (read_dynamic_tables(decoder, &br)) return -1;
+            litlen = &decoder->litlen;
+            dist = &decoder->dist;
+        } else {
+            return -1;
+        }
+
+        for (;;) {
+            int sym = decode_symbol(&br, litlen);
+            if (sym < 256) {
+                if (sym < 0 || pos >= out_len) return -1;
+                out[pos++] = (uint8_t)sym;
+                continue;
+            }
+            if (sym == 256) break;
+
+            sym -= 257;
+            if (sym >= 29) return -1;
+            size_t length = LENGTH_BASE[sym] + getbits(&br, LENGTH_EXTRA[sym]);
+
+            int dsym = decode_symbol(&br, dist);
+            if (dsym < 0 || dsym >= 30) return -1;
+            size_t distance = DIST_BASE[dsym] + getbits(&br, DIST_EXTRA[dsym]);
+
+            if (distance > pos + history || length > out_len - pos) return -1;
+            uint8_t *dst = out + pos;
+            const uint8_t *src = dst - distance;
+            if (distance >= length) {
+                memcpy(dst, src, length);
+            } else {
+                for (size_t i = 0; i < length; i++) dst[i] = src[i];
+            }
+            pos += length;
+        }
+        if (overrun(&br)) return -1;
+    }
+
+    return pos == out_len ? 0 : -1;
+}
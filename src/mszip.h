@@ -0,0 +1,65 @@
+#ifndef MSZIP_H
+#define MSZIP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Size of the MSZIP history window */
+#define MSZIP_WINDOW_SIZE 32768
+/** Number of bits resolved by a single Huffman table lookup */
+#define MSZIP_FAST_BITS 10
+
+/** Huffman decoding table for one deflate alphabet */
+typedef struct mszip_huffman {
+    /** Symbol and code length for all codes up to MSZIP_FAST_BITS long,
+     * indexed by the next MSZIP_FAST_BITS input bits. 0 if the code is longer */
+    uint16_t fast[1 << MSZIP_FAST_BITS];
+    /** First canonical code of each code length */
+    uint16_t firstcode[16];
+    /** Index into value of the first symbol of each code length */
+    uint16_t firstsymbol[16];
+    /** One past the last code of each code length, left-aligned to 16 bits */
+    uint32_t maxcode[18];
+    /** Code length of each entry in value */
+    uint8_t size[288];
+    /** Symbols sorted by canonical code */
+    uint16_t value[288];
+} mszip_huffman;
+
+/** MSZIP decoder state, reusable across blocks, folders and files */
+typedef struct mszip_decoder {
+    /** Fixed literal/length table, built once */
+    mszip_huffman fixed_litlen;
+    /** Fixed distance table, built once */
+    mszip_huffman fixed_dist;
+    /** Literal/length table of the current dynamic block */
+    mszip_huffman litlen;
+    /** Distance table of the current dynamic block */
+    mszip_huffman dist;
+} mszip_decoder;
+
+/**
+ * @brief Initialize an MSZIP decoder
+ *
+ * @param decoder decoder to initialize
+ */
+void mszip_init(mszip_decoder *decoder);
+
+/**
+ * @brief Decompress a single MSZIP CFDATA block
+ *
+ * The output is written directly to out. Back-references into earlier blocks
+ * are resolved from the bytes preceding out, so consecutive blocks of a folder
+ * have to be decoded into one contiguous buffer.
+ *
+ * @param decoder decoder state
+ * @param in compressed block data, starting with the "CK" signature
+ * @param in_len length of the compressed block data
+ * @param out buffer to write the uncompressed data to
+ * @param out_len expected uncompressed length of the block
+ * @param history number of already decoded bytes directly preceding out
+ * @return int 0 on success, -1 if the data is corrupt
+ */
+int mszip_decompress_block(mszip_decoder *decoder, const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len, size_t history);
+
+#endif
@@ -0,0 +1,74 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "outbuf.h"
+
+/** Every byte as two hex digits followed by a comma, packed into the low
+ * three bytes of a uint32_t */
+#define PAIR(byte) ((uint32_t)"0123456789ABCDEF"[(byte) >> 4] | (uint32_t)"0123456789ABCDEF"[(byte) & 0xF] << 8 | (uint32_t)',' << 16)
+#define PAIRS4(byte) PAIR(byte), PAIR(byte + 1), PAIR(byte + 2), PAIR(byte + 3)
+#define PAIRS16(byte) PAIRS4(byte), PAIRS4(byte + 4), PAIRS4(byte + 8), PAIRS4(byte + 12)
+#define PAIRS64(byte) PAIRS16(byte), PAIRS16(byte + 16), PAIRS16(byte + 32), PAIRS16(byte + 48)
+static const uint32_t HEX_PAIRS[256] = {PAIRS64(0), PAIRS64(64), PAIRS64(128), PAIRS64(192)};
+
+void outbuf_reserve(outbuf *out, size_t len) {
+    if (out->length + len < out->size) return;
+    size_t size = out->size ? out->size : 4096;
+    while (out->length + len >= size) size *= 2;
+    char *data = realloc(out->data, size);
+    if (!data) {
+        perror("Failed to allocate output buffer");
+        exit(EXIT_FAILURE);
+    }
+    out->data = data;
+    out->size = size;
+}
+
+void outbuf_printf(outbuf *out, const char *restrict format, ...) {
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(out->data + out->length, out->size - out->length, format, args);
+    va_end(args);
+
+    if (len < 0) return;
+    if (out->length + len >= out->size) {
+        outbuf_reserve(out, len);
+        va_start(args, format);
+        vsnprintf(out->data + out->length, out->size - out->length, format, args);
+        va_end(args);
+    }
+    out->length += len;
+}
+
+void outbuf_puts(outbuf *out, const char *str) {
+    outbuf_write(out, str, strlen(str));
+}
+
+void outbuf_write(outbuf *out, const void *data, size_t len) {
+    outbuf_reserve(out, len);
+    memcpy(out->data + out->length, data, len);
+    out->length += len;
+    out->data[out->length] = '\0';
+}
+
+void outbuf_putc(outbuf *out, char c) {
+    outbuf_reserve(out, 1);
+    out->data[out->length++] = c;
+    out->data[out->length] = '\0';
+}
+
+char *hex_encode(char *dst, const uint8_t *data, size_t len) {
+    if (!len) return dst;
+
+    // The comma after the last pair is cut off
+    for (size_t i = 0; i < len; i++) {
+        uint32_t pair = HEX_PAIRS[data[i]];
+        dst[0] = pair;
+        dst[1] = pair >> 8;
+        dst[2] = pair >> 16;
+        dst += 3;
+    }
+    return dst - 1;
+}
@@ -0,0 +1,71 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Growable buffer the record of an input is printed into */
+typedef struct outbuf {
+    char *data;
+    size_t length;
+    size_t size;
+} outbuf;
+
+/**
+ * @brief Make room for at least len more bytes in an output buffer
+ *
+ * Exits the program if the buffer can not be grown.
+ *
+ * @param out output buffer
+ * @param len number of bytes to append
+ */
+void outbuf_reserve(outbuf *out, size_t len);
+
+/**
+ * @brief Append formatted text to an output buffer
+ *
+ * @param out output buffer
+ * @param format Format string
+ * @param ... varargs
+ */
+void outbuf_printf(outbuf *out, const char *restrict format, ...);
+
+/**
+ * @brief Append a string to an output buffer
+ *
+ * @param out output buffer
+ * @param str string to append
+ */
+void outbuf_puts(outbuf *out, const char *str);
+
+/**
+ * @brief Append bytes to an output buffer
+ *
+ * @param out output buffer
+ * @param data bytes to append
+ * @param len number of bytes
+ */
+void outbuf_write(outbuf *out, const void *data, size_t len);
+
+/**
+ * @brief Append a character to an output buffer
+ *
+ * @param out output buffer
+ * @param c character to append
+ */
+void outbuf_putc(outbuf *out, char c);
+
+/**
+ * @brief Hex encode bytes as comma separated pairs of upper case digits, such
+ * as "01,AB", the way binary values are written in .reg files
+ *
+ * Every byte is encoded with one lookup in a table of all 256 pairs.
+ *
+ * @param dst buffer for the encoded bytes, at least 3x len bytes
+ * @param data bytes to encode
+ * @param len number of bytes
+ * @return char* end of the encoded bytes, not terminated
+ */
+char *hex_encode(char *dst, const uint8_t *data, size_t len);
+
+#endif
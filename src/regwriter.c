@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "regwriter.h"
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/**
+ * @brief Copy a string, escaping quotes and backslashes
+ *
+ * @param dst buffer, at least 2x len bytes
+ * @param str string to copy
+ * @param len length of str
+ * @return char* end of the copied string
+ */
+static char *escape(char *dst, const char *str, size_t len) {
+    // Bounded by len, as the string may run to the end of the input
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == '"' || str[i] == '\\') *dst++ = '\\';
+        *dst++ = str[i];
+    }
+    return dst;
+}
+
+/**
+ * @brief Write a quoted, escaped string
+ */
+static char *quote(char *dst, const char *str, size_t len) {
+    *dst++ = '"';
+    dst = escape(dst, str, len);
+    *dst++ = '"';
+    return dst;
+}
+
+void reg_write_record(outbuf *out, wcecab *doc, const char *path) {
+    const wcecab_model *model = wcecab_get_model(doc);
+    const wcecab_regkey_table *regkeys = &model->regkeys;
+    int previoushiveid = -1;
+
+    if (path) {
+        outbuf_puts(out, "\n; ");
+        outbuf_puts(out, path);
+        outbuf_putc(out, '\n');
+    }
+
+    for (uint32_t row = 0; row < regkeys->count; row++) {
+        const char *name = wcecab_model_at(model, regkeys->name[row]);
+        const uint8_t *value = (const uint8_t *)wcecab_model_at(model, regkeys->data[row]);
+        const uint16_t hiveid = regkeys->hive[row];
+        const uint16_t datalength = regkeys->datalength[row];
+        const uint32_t regtype = regkeys->flags[row] & TYPE_REG_MASK;
+        const char *hivepath = previoushiveid != hiveid ? wcecab_hive_path(doc, hiveid) : "";
+        if (!hivepath) hivepath = "unknown";
+        size_t hivelength = strlen(hivepath);
+        // Names and values are not always terminated, the value follows the
+        // name and the next entry the value
+        size_t namelength = strnlen(name, (const char *)value - name);
+        size_t valuelength = regtype == TYPE_REG_SZ ? strnlen((const char *)value, datalength) : datalength;
+
+        // Largest size of the entry: hive line, escaped name, the value
+        // escaped or hex encoded with its prefix, and the newline
+        outbuf_reserve(out, hivelength + 4 + namelength * 2 + 3 + valuelength * 3 + 16);
+        char *dst = out->data + out->length;
+
+        if (previoushiveid != hiveid) {
+            *dst++ = '\n';
+            *dst++ = '[';
+            memcpy(dst, hivepath, hivelength);
+            dst += hivelength;
+            *dst++ = ']';
+            *dst++ = '\n';
+        }
+
+        if (namelength) {
+            dst = quote(dst, name, namelength);
+            *dst++ = '=';
+        } else {
+            *dst++ = '@';
+            *dst++ = '=';
+        }
+
+        switch (regtype) {
+            case TYPE_REG_DWORD: {
+                uint32_t dword;
+                if (datalength < sizeof(dword)) {
+                    // Too short for a DWORD, keep the bytes there are
+                    memcpy(dst, "hex(4):", 7);
+                    dst = hex_encode(dst + 7, value, datalength);
+                    break;
+                }
+                memcpy(&dword, value, sizeof(dword));
+                memcpy(dst, "dword:", 6);
+                dst += 6;
+                for (int shift = 28; shift >= 0; shift -= 4) {
+                    *dst++ = HEX_DIGITS[dword >> shift & 0xF];
+                }
+                break;
+            }
+            case TYPE_REG_SZ:
+                dst = quote(dst, (const char *)value, valuelength);
+                break;
+            case TYPE_REG_MULTI_SZ:
+                memcpy(dst, "hex(7):", 7);
+                dst = hex_encode(dst + 7, value, datalength);
+                break;
+            case TYPE_REG_BINARY:
+                memcpy(dst, "hex:", 4);
+                dst = hex_encode(dst + 4, value, datalength);
+                break;
+        }
+        *dst++ = '\n';
+        out->length = dst - out->data;
+
+        previoushiveid = hiveid;
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef REGWRITER_H
+#define REGWRITER_H
+
+#include "outbuf.h"
+#include "wcecabinfo.h"
+
+/**
+ * @brief Write the registry entries of an opened 000 file in the Windows .reg
+ * format, without the REGEDIT4 line
+ *
+ * Every entry is sized up front and written into the output buffer at once.
+ * Binary values are hex encoded with hex_encode(). Quotes and backslashes in
+ * names and string values are escaped. Strings are written in the codepage
+ * of the file, as .reg files of this version are not Unicode.
+ *
+ * @param out buffer to append the entries to
+ * @param doc opened 000 file
+ * @param path input path written as a comment before the entries, NULL to
+ * leave it out
+ */
+void reg_write_record(outbuf *out, wcecab *doc, const char *path);
+
+#endif
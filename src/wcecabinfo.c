@@ -1,6 +1,9 @@
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -9,91 +12,33 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
+#include <dirent.h>
 
-#ifndef _WIN32
-#include <sys/mman.h>
-#else
-#include <fcntl.h>
+#ifdef _WIN32
 #include <io.h>
+#include <windows.h>
 #endif
 
-#define USE_ICONV
-
-#ifdef USE_ICONV
-#include <iconv.h>
-
-#include "WinCEArchitecture.h"
-#include "WinCECab000Header.h"
-#include "cjson/cJSON.h"
+#include "cache.h"
+#include "jsonwriter.h"
+#include "outbuf.h"
 #include "readbytes.h"
+#include "regwriter.h"
+#include "wcecabinfo.h"
 
-/**
- * @brief Convert CP932 encoded string to UTF-8
- *
- * @param in Shift-JIS encoded string
- * @param utf8 buffer for UTF-8 string, needs to be at least 4x the size of in
- * @return int number of encoded characters
- */
-static int jap_to_utf8(const char *in, char *utf8, size_t utf8_len) {
-    char *p;
-    int status;
-    iconv_t icv;
-    size_t src_len, dst_len;
-    icv = iconv_open("UTF-8", "CP932");
-    src_len = strlen(in);
-    dst_len = utf8_len;
-
-    status = iconv(icv, &in, &src_len, &utf8, &dst_len);
-    iconv_close(icv);
-    return status;
-}
-
-static int rus_to_utf8(const char *in, char *utf8, size_t utf8_len) {
-    char *p;
-    int status;
-    iconv_t icv;
-    size_t src_len, dst_len;
-    icv = iconv_open("UTF-8", "CP1251");
-    src_len = strlen(in);
-    dst_len = utf8_len;
-
-    status = iconv(icv, &in, &src_len, &utf8, &dst_len);
-    iconv_close(icv);
-    return status;
-}
-
-const char *convert_string(const char *str) {
-    bool str_is_ascii = true;
-    for (uint8_t *ptr = (uint8_t *)str; *ptr; ptr++) {
-        if (*ptr < 0x20 || *ptr > 0x7F) {
-            // printf("String %s is not ASCII\n", str);
-            str_is_ascii = false;
-        }
-    }
+#define PROGRAM_NAME "wcecabinfo"
+#define PROGRAM_VERSION "0.9.1"
 
-    if (str_is_ascii) return str;
-    char *newStr = calloc(1, strlen(str) * 4);
-    // printf("newStr: %08X\n", newStr);
+/** Size of the buffered records from which they are written to stdout */
+#define OUTPUT_FLUSH_SIZE (1 << 20)
 
-    int result = jap_to_utf8(str, newStr, strlen(str) * 4);
-    // printf("jap_to_utf8 result %d\n", result);
-    if (result == -1) {
-        free(newStr);
-        newStr = calloc(1, strlen(str) * 4);
-        result = rus_to_utf8(str, newStr, strlen(str) * 4);
-    }
-    if (result == -1) {
-        free(newStr);
-        return str;
-    }
-    return newStr;
-}
-#endif
+/** Default size limit of the cache */
+#define DEFAULT_CACHE_SIZE ((uint64_t)1 << 30)
 
-#define PROGRAM_NAME "wcecabinfo"
-#define PROGRAM_VERSION "0.9.1"
-#define CHUNK_SIZE 1024
+/** Flag of a cached record, set if the input is a CAB file */
+#define CACHED_CAB 1
 
 struct opts {
     /** Print output as JSON */
@@ -104,21 +49,111 @@ struct opts {
     bool verbose : 1;
     /** Expect piped input */
     bool piped : 1;
+    /** Print JSON without whitespace */
+    bool compact : 1;
+    /** Print one compact JSON record per line and input */
+    bool ndjson : 1;
+    /** Report timing and counters when done */
+    bool stats : 1;
     /** Filter field */
     const char *filterField;
-    /** Input file path */
-    const char *infile;
+    /** Codepage of all inputs, NULL to detect it per input */
+    const char *codepage;
+    /** File to write the statistics to as JSON, NULL to print them to stderr */
+    const char *statsFile;
+    /** File to write trace events to, NULL for none */
+    const char *traceFile;
+    /** Directory of the cache of records, NULL for none */
+    const char *cacheDir;
+    /** Size limits of the cache */
+    cache_limits cacheLimits;
+    /** Input file and directory paths */
+    char **infiles;
+    /** Number of input paths */
+    int numInfiles;
+    /** Print one record per input, tagged with its path */
+    bool batch;
+    /** Number of worker threads */
+    int jobs;
 };
 
-typedef struct infile_struct {
-    const void *file;
-    size_t size;
-} infile_struct;
+/**
+ * Trace events recorded by a thread. Every thread appends to its own buffer
+ * without locking, the buffers are written to the trace file at exit.
+ */
+typedef struct trace_buffer {
+    /** Events, each followed by ",\n" */
+    outbuf events;
+    /** Thread id written with the events */
+    int tid;
+    /** Path of the input being processed, NULL for none */
+    const char *path;
+    /** Number of strings of the input converted so far */
+    uint32_t transcodes;
+    /** Time spent converting strings of the input so far, in nanoseconds */
+    uint64_t transcode_ns;
+} trace_buffer;
 
-/** Pointer to the (possibly memory-mapped) file contents */
-static void *file;
-/** CAB Header structure */
-static const CE_CAB_000_HEADER *cabheader;
+/**
+ * State of a worker thread, reused for all inputs it processes. The inputs
+ * queued for a worker are the index range [head, tail) of the input list. A
+ * worker takes inputs from the head of its own range, and once that is empty
+ * steals the upper half of the range of another worker.
+ */
+typedef struct worker_context {
+    /** Parser context, reused for all inputs */
+    wcecab *doc;
+    /** Record of the current input */
+    outbuf out;
+    /** Cached record of the current input */
+    outbuf cached;
+    /** Wall time spent printing records, without the phases of the parser */
+    uint64_t serialize_wall_ns;
+    /** CPU time spent printing records, without the phases of the parser */
+    uint64_t serialize_cpu_ns;
+    /** Trace events of the worker */
+    trace_buffer trace;
+    /** Index of the next queued input */
+    size_t head;
+    /** One past the index of the last queued input */
+    size_t tail;
+    /** Protects head and tail */
+    pthread_mutex_t lock;
+    pthread_t thread;
+} worker_context;
+
+/** Paths of the input files, directories already expanded */
+static char **inputs;
+/** Number of input files */
+static size_t numinputs;
+/** Allocated size of inputs */
+static size_t maxinputs;
+/** Worker threads */
+static worker_context *workers;
+/** Serializes writing records to stdout */
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+/** Records waiting to be written to stdout, protected by output_lock */
+static outbuf output;
+/** Number of records printed so far */
+static int numrecords;
+/** Number of inputs that failed */
+static int failures;
+/** Number of bytes written to stdout */
+static uint64_t bytes_written;
+/** true if trace events are recorded */
+static bool tracing;
+/** Time the trace starts at, in nanoseconds of the monotonic clock */
+static uint64_t trace_start;
+/** Trace events of the main thread when it is not running a worker */
+static trace_buffer main_trace;
+/** Trace events of the calling thread */
+static _Thread_local trace_buffer *thread_trace = &main_trace;
+/** Cache of records, NULL for none */
+static cache *record_cache;
+/** Kind of the cached records, depends on the output options */
+static uint64_t record_kind;
+/** Kind of the cached 000 files extracted from CAB files */
+static uint64_t extracted_kind;
 
 /**
  * @brief Print usage and exit program
@@ -128,26 +163,44 @@ static const CE_CAB_000_HEADER *cabheader;
 void usage(int status) {
     puts(
         "Usage: " PROGRAM_NAME
-        " [-j] [-r] [-V] FILE"
+        " [-j [-C] | -n] [-r] [-c CODEPAGE] [-V] FILE..."
         "\n"
         "Print information about a CAB .000 file. Input can be either a cab file or an already extracted .000 file.\n"
-        "If a cab file is provided, cabextract is needed to handle extraction.\n"
+        "Directories are searched recursively for .cab and .000 files, without following links to directories.\n"
+        "With more than one input, one record is printed per input, tagged with its path. Inputs that fail\n"
+        "are reported on stderr and the remaining inputs are still processed.\n"
         "\n"
         "  -j, --json               print output as JSON\n"
+        "  -C, --compact            print JSON without whitespace\n"
+        "  -n, --ndjson             print one JSON record per line and input, with the input path and\n"
+        "                           the error of inputs that failed\n"
         "  -r, --reg                print output as Windows Reg format\n"
         //"  -f, --field FIELDNAME    only print the value of the field with key FIELDNAME\n"
         "                           overrides --json option\n"
+        "  -c, --codepage CODEPAGE  decode strings as CODEPAGE instead of detecting the codepage of every\n"
+        "                           input, one of CP932, CP1251, CP1252, CP936, CP949 or CP950\n"
+        "      --stats[=FILE]       print the time spent per phase and counters to stderr when done,\n"
+        "                           or write them to FILE as JSON\n"
+        "      --trace FILE         write the phases of every input as Chrome trace events to FILE\n"
+        "      --cache DIR          reuse the records of inputs printed before with the same options,\n"
+        "                           cached in DIR, inputs are identified by the hash of their contents\n"
+        "      --cache-size SIZE    evict records once the cache holds more than SIZE bytes, with an\n"
+        "                           optional K, M or G suffix, 0 for no limit (default 1G)\n"
+        "      --cache-entries N    evict records once the cache holds more than N records, 0 for no\n"
+        "                           limit (default 0)\n"
         "  -h, --help               print help\n"
         "  -v, --version            print version information\n"
 #ifndef _WIN32
         "  -p, --piped              Expect piped input\n"
 #endif
+        "  -J, --jobs N             process inputs with N threads, 0 for one per CPU (default 1)\n"
         "  -V, --verbose            print verbose logs\n"
         "\n"
         "Examples:\n"
         "  " PROGRAM_NAME
         " f.cab     Print information about file f.cab\n"
-        "  " PROGRAM_NAME " -j f.000  Print JSON formatted information about file f.000");
+        "  " PROGRAM_NAME " -j f.000  Print JSON formatted information about file f.000\n"
+        "  " PROGRAM_NAME " -j dir    Print a JSON array with information about all files in dir");
     exit(status);
 }
 
@@ -160,6 +213,59 @@ void version() {
     exit(EXIT_SUCCESS);
 }
 
+/**
+ * @brief Get the number of online CPUs
+ *
+ * @return int number of CPUs, at least 1
+ */
+static int get_num_cpus() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    return num > 0 ? (int)num : 1;
+#endif
+}
+
+/**
+ * @brief Parse a size, a number with an optional K, M or G suffix for KiB, MiB
+ * or GiB
+ *
+ * @param arg size to parse
+ * @param size set to the size
+ * @return int 0 on success, -1 if arg is not a size
+ */
+static int parse_size(const char *arg, uint64_t *size) {
+    char *end;
+    int shift = 0;
+
+    errno = 0;
+    unsigned long long value = strtoull(arg, &end, 10);
+    if (!isdigit((unsigned char)*arg) || errno) return -1;
+    switch (*end) {
+        case 'K':
+        case 'k':
+            shift = 10;
+            end++;
+            break;
+        case 'M':
+        case 'm':
+            shift = 20;
+            end++;
+            break;
+        case 'G':
+        case 'g':
+            shift = 30;
+            end++;
+            break;
+    }
+    if (*end || value > UINT64_MAX >> shift) return -1;
+    *size = (uint64_t)value << shift;
+    return 0;
+}
+
 /**
  * @brief Get the commandline options
  *
@@ -170,8 +276,11 @@ void version() {
 static struct opts options;
 static inline struct opts *get_opts(int argc, char **argv) {
     opterr = 0;
+    options.jobs = 1;
+    options.cacheLimits.max_bytes = DEFAULT_CACHE_SIZE;
 
     char c;
+    char *end;
 
     static struct option long_options[] = {{"json", no_argument, 0, 'j'},
                                            {"reg", no_argument, 0, 'r'},
@@ -180,11 +289,20 @@ static inline struct opts *get_opts(int argc, char **argv) {
                                            {"verbose", no_argument, NULL, 'V'},
                                            {"piped", no_argument, NULL, 'p'},
                                            {"field", required_argument, NULL, 'f'},
+                                           {"jobs", required_argument, NULL, 'J'},
+                                           {"codepage", required_argument, NULL, 'c'},
+                                           {"compact", no_argument, NULL, 'C'},
+                                           {"ndjson", no_argument, NULL, 'n'},
+                                           {"stats", optional_argument, NULL, 'S'},
+                                           {"trace", required_argument, NULL, 'T'},
+                                           {"cache", required_argument, NULL, 'K'},
+                                           {"cache-size", required_argument, NULL, 'Z'},
+                                           {"cache-entries", required_argument, NULL, 'E'},
                                            {NULL, 0, NULL, 0}};
     /** getopt_long stores the option index here. */
     int option_index = 0;
 
-    while ((c = getopt_long(argc, argv, "jrbhvVf:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "jrbhvVpf:J:c:Cn", long_options, &option_index)) != -1) {
         switch (c) {
             case 'j':
                 options.printJson = true;
@@ -198,12 +316,57 @@ static inline struct opts *get_opts(int argc, char **argv) {
             case 'f':
                 options.filterField = optarg;
                 break;
+            case 'c':
+                options.codepage = optarg;
+                break;
+            case 'C':
+                options.compact = true;
+                break;
+            case 'n':
+                options.ndjson = true;
+                options.printJson = true;
+                options.compact = true;
+                break;
+            case 'S':
+                options.stats = true;
+                options.statsFile = optarg;
+                break;
+            case 'T':
+                options.traceFile = optarg;
+                break;
+            case 'K':
+                options.cacheDir = optarg;
+                break;
+            case 'Z':
+                if (parse_size(optarg, &options.cacheLimits.max_bytes)) {
+                    fprintf(stderr, "Error: invalid cache size: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'E':
+                errno = 0;
+                options.cacheLimits.max_entries = strtoull(optarg, &end, 10);
+                if (!isdigit((unsigned char)*optarg) || *end || errno) {
+                    fprintf(stderr, "Error: invalid number of cache entries: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'v':
                 version();
                 break;
             case 'V':
                 options.verbose = true;
                 break;
+            case 'J': {
+                errno = 0;
+                long jobs = strtol(optarg, &end, 10);
+                if (!isdigit((unsigned char)*optarg) || *end || errno || jobs > INT_MAX) {
+                    fprintf(stderr, "Error: invalid number of jobs: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                options.jobs = jobs ? (int)jobs : get_num_cpus();
+                break;
+            }
 #ifndef _WIN32
             case 'p':
                 options.piped = true;
@@ -222,21 +385,24 @@ static inline struct opts *get_opts(int argc, char **argv) {
     /* field option overrides json option */
     if (options.filterField) {
         options.printJson = 0;
+        options.ndjson = 0;
     }
 
-    options.infile = "-";
-
     if (optind < argc) {
         if (options.piped) {
             fprintf(stderr, "Input file argument provided while piped flag is set");
             exit(EXIT_FAILURE);
-        } else {
-            options.infile = argv[optind++];
         }
+        options.infiles = argv + optind;
+        options.numInfiles = argc - optind;
     } else if (!options.piped) {
         usage(0);
     }
 
+    /* A single directory argument also yields several records */
+    struct stat s;
+    options.batch = options.numInfiles > 1 || (options.numInfiles == 1 && !stat(options.infiles[0], &s) && S_ISDIR(s.st_mode));
+
     return &options;
 }
 
@@ -276,857 +442,1054 @@ int strendswith(const char *input, const char *tail) {
     return strcmp(input + input_strlen - tail_strlen, tail) == 0;
 }
 
-#ifndef _WIN32
 /**
- * @brief Get the contents of the 000 file and return the pointer to it
+ * @brief Read a clock
  *
- * @param file_path
- * @return void*
+ * @param clock clock id
+ * @return uint64_t time in nanoseconds
  */
-int read000filecontents(const char *file_path, infile_struct *file_info) {
-    struct stat s;
-    int status;
-    const void *mapped;
-    int i;
-
-    /* try to open file */
-    FILE *in_file = fopen(file_path, "r");
-    if (!in_file) {
-        fprintf(stderr, "open %s failed: %s", file_path, strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-
-    /* Get the size of the file. */
-    if (fseek(in_file, 0, SEEK_END) == -1) {
-        fprintf(stderr, "fseek %s failed: %s\n", file_path, strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    file_info->size = ftell(in_file);
-
-    /* Memory-map the file. */
-    mapped = mmap(0, file_info->size, PROT_READ, MAP_PRIVATE, fileno(in_file), 0);
-    if (mapped == MAP_FAILED) {
-        fprintf(stderr, "mmap %s failed: %s\n", file_path, strerror(errno));
-        exit(EXIT_FAILURE);
-    }
-    fclose(in_file);
-
-    file_info->file = mapped;
-    return 1;
+static uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
-#endif
 
 /**
- * @brief Checks if a file has a 32 bit header
+ * @brief Read the clock of trace events
  *
- * @param file_path File path
- * @return uint8_t 1 is the file is a cab file, 0 if not
+ * @return uint64_t time in nanoseconds, 0 if tracing is disabled
  */
-uint8_t filehasheader(const char *file_path, const uint32_t header_signature) {
-    verbose("Checking file header for file '%s'.\n", file_path);
-    /* try to open file */
-    FILE *fp = fopen(file_path, "rb");
+static inline uint64_t trace_clock(void) {
+    return tracing ? clock_ns(CLOCK_MONOTONIC) : 0;
+}
 
-    if (!fp) {
-        fprintf(stderr, "Error: file open of \"%s\" failed: %s\n", file_path, strerror(errno));
-        exit(EXIT_FAILURE);
+/**
+ * @brief Start recording a complete event in the trace buffer of the calling
+ * thread, tagged with the current input
+ *
+ * Further arguments can be added to the args object before the event is
+ * finished with trace_finish().
+ *
+ * @param json set to a writer appending to the trace buffer
+ * @param name event name
+ * @param start start time, from trace_clock()
+ * @param end end time, from trace_clock()
+ */
+static void trace_begin(json_writer *json, const char *name, uint64_t start, uint64_t end) {
+    trace_buffer *trace = thread_trace;
+
+    json_init(json, &trace->events, false);
+    json_begin_object(json);
+    json_key(json, "name");
+    json_string(json, name);
+    json_key(json, "ph");
+    json_string(json, "X");
+    json_key(json, "ts");
+    json_double(json, (start - trace_start) / 1e3);
+    json_key(json, "dur");
+    json_double(json, (end - start) / 1e3);
+    json_key(json, "pid");
+    json_uint(json, 1);
+    json_key(json, "tid");
+    json_uint(json, trace->tid);
+    json_key(json, "args");
+    json_begin_object(json);
+    if (trace->path) {
+        json_key(json, "file");
+        json_string(json, trace->path);
     }
+}
 
-    uint32_t c;
-    fread(&c, sizeof(c), 1, fp);
-    fclose(fp);
-    return c == header_signature;
+/**
+ * @brief Finish recording an event started with trace_begin()
+ *
+ * @param json writer of the event
+ */
+static void trace_finish(json_writer *json) {
+    json_end_object(json);
+    json_end_object(json);
+    outbuf_puts(json->out, ",\n");
 }
 
 /**
- * @brief Read 000 file from an input stream
+ * @brief Record a complete event in the trace buffer of the calling thread, if
+ * tracing is enabled
  *
- * @param stream stream to read from
- * @param file_info struct to write file handle and size into
- * @return uint8_t*
+ * @param name event name
+ * @param start start time, from trace_clock()
  */
-void read000filestream(FILE *stream, infile_struct *file_info) {
-    void *buffer = malloc(CHUNK_SIZE);
+static void trace_event(const char *name, uint64_t start) {
+    json_writer json;
 
-    size_t c = 0;
-    size_t file_size = 0;
+    if (!tracing) return;
+    trace_begin(&json, name, start, clock_ns(CLOCK_MONOTONIC));
+    trace_finish(&json);
+}
 
-    int chunks = 1;
+/**
+ * @brief Record the phases of a parser context as trace events
+ *
+ * Strings are converted one at a time while the record is printed, so instead
+ * of an event per string their number and total time are added to the
+ * serialize event.
+ *
+ * @param userdata trace buffer of the worker owning the context
+ * @param phase phase that ended
+ * @param start_ns start time
+ * @param end_ns end time
+ */
+static void trace_phase(void *userdata, wcecab_phase phase, uint64_t start_ns, uint64_t end_ns) {
+    trace_buffer *trace = userdata;
+    json_writer json;
+
+    if (phase == WCECAB_PHASE_TRANSCODE) {
+        trace->transcodes++;
+        trace->transcode_ns += end_ns - start_ns;
+        return;
+    }
+    trace_begin(&json, wcecab_phase_name(phase), start_ns, end_ns);
+    trace_finish(&json);
+}
 
-    while (c = fread(buffer + file_size, 1, CHUNK_SIZE, stream)) {
-        char *old = buffer;
+/**
+ * @brief Write the trace events of all threads to the trace file, in the
+ * Chrome trace event format
+ *
+ * @param options commandline options
+ */
+static void write_trace(const struct opts *options) {
+    FILE *file = fopen(options->traceFile, "w");
+    bool failed = !file;
+
+    if (file) {
+        outbuf names = {0};
+        json_writer json;
+        char name[32];
+
+        fputs("{\"traceEvents\":[\n", file);
+        fwrite(main_trace.events.data, 1, main_trace.events.length, file);
+        for (int i = 0; i < options->jobs; i++) {
+            fwrite(workers[i].trace.events.data, 1, workers[i].trace.events.length, file);
+        }
 
-        file_size += c;
-        buffer = realloc(buffer, CHUNK_SIZE * (++chunks));
-        if (buffer == NULL) {
-            perror("Failed to reallocate content");
-            free(old);
-            exit(EXIT_FAILURE);
+        // Metadata events naming the threads
+        json_init(&json, &names, false);
+        for (int i = 0; i <= options->jobs; i++) {
+            json_begin_object(&json);
+            json_key(&json, "name");
+            json_string(&json, "thread_name");
+            json_key(&json, "ph");
+            json_string(&json, "M");
+            json_key(&json, "pid");
+            json_uint(&json, 1);
+            json_key(&json, "tid");
+            json_uint(&json, i);
+            json_key(&json, "args");
+            json_begin_object(&json);
+            json_key(&json, "name");
+            snprintf(name, sizeof(name), "worker %d", i);
+            json_string(&json, i ? name : "main");
+            json_end_object(&json);
+            json_end_object(&json);
+            outbuf_puts(&names, i < options->jobs ? ",\n" : "\n");
         }
-    }
+        fwrite(names.data, 1, names.length, file);
+        fputs("],\"displayTimeUnit\":\"ms\"}\n", file);
+        free(names.data);
 
-    if (ferror(stream)) {
-        perror("Error while reading from stream");
-        exit(EXIT_FAILURE);
+        failed = ferror(file);
+        failed |= fclose(file) != 0;
+    }
+    if (failed) {
+        fprintf(stderr, "Error: %s: %s\n", options->traceFile, strerror(errno));
+        failures++;
     }
-
-    file_info->size = file_size;
-    file_info->file = buffer;
 }
 
 /**
- * @brief Get array of strings created from the "unsupported" multistring
+ * @brief Print the information about an opened 000 file
  *
- * @param usup Unsupported multistring
- * @param len length of the unsupported multistring
- * @return char* array of unsupported strings, with the last element being a nullpointer
+ * @param options commandline options
+ * @param doc opened 000 file
+ * @param path path of the input, printed with the record in batch mode
+ * @param out output buffer to print the record into
+ * @return const char* NULL on success, an error message otherwise
  */
-const char **get_unsupported(const char *usup, uint16_t len) {
-    uint16_t numUnsupported = 1;
+static const char *print000file(const struct opts *options, wcecab *doc, const char *path, outbuf *out) {
+    const CE_CAB_000_HEADER *cabheader = wcecab_header(doc);
+
+    verbose("File was identified as a %s file by file signature\n", wcecab_is_cab(doc) ? "CAB" : "000");
+    verbose("Opened file, size: %d\n", cabheader->FileLength);
+
+    verbose("AsciiSignature: %#08X\n", cabheader->AsciiSignature);
+    verbose("Unknown1: %d\n", cabheader->Unknown1);
+    verbose("FileLength: %d\n", cabheader->FileLength);
+    verbose("Unknown2: %d\n", cabheader->Unknown2);
+    verbose("Unknown3: %d\n", cabheader->Unknown3);
+    verbose("TargetArchitecture: %d\n", cabheader->TargetArchitecture);
+    verbose("MinCEVersionMajor: %d\n", cabheader->MinCEVersionMajor);
+    verbose("MinCEVersionMinor: %d\n", cabheader->MinCEVersionMinor);
+    verbose("MaxCEVersionMajor: %d\n", cabheader->MaxCEVersionMajor);
+    verbose("MaxCEVersionMinor: %d\n", cabheader->MaxCEVersionMinor);
+    verbose("MinCEBuildNumber: %d\n", cabheader->MinCEBuildNumber);
+    verbose("MaxCEBuildNumber: %d\n", cabheader->MaxCEBuildNumber);
+    verbose("NumEntriesString: %d\n", cabheader->NumEntriesString);
+    verbose("NumEntriesDirs: %d\n", cabheader->NumEntriesDirs);
+    verbose("NumEntriesFiles: %d\n", cabheader->NumEntriesFiles);
+    verbose("NumEntriesRegHives: %d\n", cabheader->NumEntriesRegHives);
+    verbose("NumEntriesRegKeys: %d\n", cabheader->NumEntriesRegKeys);
+    verbose("NumEntriesLinks: %d\n", cabheader->NumEntriesLinks);
+    verbose("OffsetStrings: %d\n", cabheader->OffsetStrings);
+    verbose("OffsetDirs: %d\n", cabheader->OffsetDirs);
+    verbose("OffsetFiles: %d\n", cabheader->OffsetFiles);
+    verbose("OffsetRegHives: %d\n", cabheader->OffsetRegHives);
+    verbose("OffsetRegKeys: %d\n", cabheader->OffsetRegKeys);
+    verbose("OffsetLinks: %d\n", cabheader->OffsetLinks);
+    verbose("OffsetAppname: %d\n", cabheader->OffsetAppname);
+    verbose("LengthAppname: %d\n", cabheader->LengthAppname);
+    verbose("OffsetProvider: %d\n", cabheader->OffsetProvider);
+    verbose("LengthProvider: %d\n", cabheader->LengthProvider);
+    verbose("OffsetUnsupported: %d\n", cabheader->OffsetUnsupported);
+    verbose("LengthUnsupported: %d\n", cabheader->LengthUnsupported);
+    verbose("Unknown4: %d\n", cabheader->Unknown4);
+    verbose("Unknown5: %d\n", cabheader->Unknown5);
+
+    if (options->printJson) {
+        json_writer json;
+        json_init(&json, out, !options->compact);
+        json_write_record(&json, doc, options->batch || options->ndjson ? path : NULL);
 
-    for (char *ptr = (char *)usup; ptr < (usup + len); ptr++) {
-        if (*ptr == '\0') {
-            numUnsupported++;
+        // Print JSON, as an element of an array in batch mode
+        if (!options->batch || options->ndjson) {
+            outbuf_putc(out, '\n');
+        }
+    } else if (options->printReg) {
+        // The reg file first line is printed once with the first record
+        reg_write_record(out, doc, options->batch ? path : NULL);
+    } else {
+        // Print output regularily
+        const char *appName = wcecab_to_utf8_bounded(doc, wcecab_app_name(doc), cabheader->LengthAppname);
+        const char *provider = wcecab_to_utf8_bounded(doc, wcecab_provider(doc), cabheader->LengthProvider);
+        const char *codepage = wcecab_codepage(doc);
+        const char *architecture = wcecab_architecture_name(cabheader->TargetArchitecture);
+        const char **unsupported = wcecab_unsupported(doc);
+
+        if (options->batch) {
+            outbuf_printf(out, "file: %s\n", path);
+        }
+        outbuf_printf(out, "appName: %s\n", appName);
+        outbuf_printf(out, "provider: %s\n", provider);
+        if (codepage) {
+            outbuf_printf(out, "codepage: %s\n", codepage);
         }
-    }
 
-    const char **unsupported = malloc((numUnsupported + 1) * sizeof(size_t));
+        if (architecture) {
+            outbuf_printf(out, "architecture: %s\n", architecture);
+        }
 
-    uint16_t idx = 0;
-    char prevValue = '\0';
-    for (char *ptr = (char *)usup; ptr < (usup + len); ptr++) {
-        if (prevValue == '\0') {
-            unsupported[idx++] = ptr;
+        if (*unsupported) {
+            outbuf_printf(out, "unsupported: %s", unsupported[0]);
+            for (int i = 1; unsupported[i] && strlen(unsupported[i]); i++) {
+                outbuf_printf(out, ", %s", unsupported[i]);
+            }
+            outbuf_putc(out, '\n');
+        }
+        if (cabheader->MinCEVersionMajor) {
+            outbuf_printf(out, "minCeVersion: %d.%d\n", cabheader->MinCEVersionMajor, cabheader->MinCEVersionMinor);
+        }
+        if (cabheader->MaxCEVersionMajor) {
+            outbuf_printf(out, "maxCeVersion: %d.%d\n", cabheader->MaxCEVersionMajor, cabheader->MaxCEVersionMinor);
+        }
+        if (cabheader->MinCEBuildNumber) {
+            outbuf_printf(out, "minCeBuildNumber: %d\n", cabheader->MinCEBuildNumber);
+        }
+        if (cabheader->MaxCEBuildNumber) {
+            outbuf_printf(out, "maxCeBuildNumber: %d\n", cabheader->MaxCEBuildNumber);
         }
-        prevValue = *ptr;
     }
 
-    unsupported[numUnsupported - 1] = NULL;
-
-    return unsupported;
+    return NULL;
 }
 
 /**
- * @brief Get the corresponding strong for the hive id in the Reg Hives section
- * of the 000 header
+ * @brief Report the error of an input that could not be processed
+ *
+ * The error is printed to stderr. JSON output in batch mode and NDJSON output
+ * also get a record holding the path and the error message.
  *
- * @param hiveid Hive id (1-4)
- * @return const char* Returns sorresponding string, or NULL of the ID is
- * invalid
+ * @param options commandline options
+ * @param path path of the input
+ * @param message error message
+ * @param out output buffer to print the error record into
  */
-const char *get_hive(uint16_t hiveid) {
-    switch (hiveid) {
-        case 1:
-            return "HKEY_CLASSES_ROOT";
-        case 2:
-            return "HKEY_CURRENT_USER";
-        case 3:
-            return "HKEY_LOCAL_MACHINE";
-        case 4:
-            return "HKEY_USERS";
-        default:
-            return NULL;
+static void report_error(const struct opts *options, const char *path, const char *message, outbuf *out) {
+    fprintf(stderr, "Error: %s: %s\n", path, message);
+
+    if ((options->batch && options->printJson) || options->ndjson) {
+        json_writer json;
+        json_init(&json, out, !options->compact);
+        json_write_error(&json, path, message);
+        if (options->ndjson) {
+            outbuf_putc(out, '\n');
+        }
     }
 }
 
 /**
- * @brief Get the string with the specified id from the strings section of the
- * cab 000 file
- *
- * @param stringid String id to fetch
- * @return const char* pointer to the string, or NULL if string does not exist.
+ * @brief Write the buffered records to stdout
  */
-const char *get_string(uint16_t stringid) {
-    // verbose("getString(%d) = ", stringid);
-
-    CE_CAB_000_STRING_ENTRY *stringentry = (CE_CAB_000_STRING_ENTRY *)(file + cabheader->OffsetStrings);
-    for (int i = 0; i < cabheader->NumEntriesString; i++) {
-        if (stringentry->Id == stringid) {
-            // verbose("\"%s\" (length: %d)\n", &(stringentry->String), stringentry->StringLength);
-            // TODO use memcpy
-            return &(stringentry->String);
-        }
-        stringentry = ((void *)stringentry) + stringentry->StringLength + sizeof(uint16_t) + sizeof(uint16_t);
-    }
-    // verbose("NULL\n");
-    return NULL;
+static void flush_output(void) {
+    uint64_t start = trace_clock();
+
+    fwrite(output.data, 1, output.length, stdout);
+    fflush(stdout);
+    bytes_written += output.length;
+    output.length = 0;
+    trace_event("flush", start);
 }
 
 /**
- * @brief Parse a spec array which contains a list of 16-bit String IDs,
- * terminated by 0
+ * @brief Queue the record of an input for writing to stdout
+ *
+ * Records are added whole, so records printed by different workers do not
+ * interleave. The separators between records are added here, as the order of
+ * the records is only known once they are written. Records are collected in
+ * one buffer that is written to stdout once it holds OUTPUT_FLUSH_SIZE bytes,
+ * so large batches are written in few large writes.
  *
- * @param spec pointer to spec array
- * @return const char* parsed String
+ * @param options commandline options
+ * @param out record to write, reset afterwards
+ * @param failed true if the input failed
  */
-const char *parse_spec(uint16_t *spec, uint16_t speclength, char *delimiter) {
-    char *buf = (char *)malloc(256);
-    strcpy(buf, "");
-
-    for (int i = 0; i < (speclength / sizeof(uint16_t) - 1); i++) {
-        // verbose("spec[%d] = %d\n", i, spec[i]);
-        if (i) {
-            strcat(buf, delimiter);
+static void write_record(const struct opts *options, outbuf *out, bool failed) {
+    uint64_t start = trace_clock();
+
+    pthread_mutex_lock(&output_lock);
+    trace_event("wait", start);
+    start = trace_clock();
+    if (failed) {
+        failures++;
+    }
+    if (out->length) {
+        if (options->ndjson) {
+            // Records end with a newline already
+        } else if (options->printJson) {
+            if (options->batch) outbuf_puts(&output, numrecords ? ",\n" : "[\n");
+        } else if (options->printReg) {
+            if (!numrecords) outbuf_puts(&output, "REGEDIT4\n");
+        } else if (options->batch && numrecords) {
+            outbuf_putc(&output, '\n');
+        }
+        outbuf_write(&output, out->data, out->length);
+        numrecords++;
+        if (output.length >= OUTPUT_FLUSH_SIZE) {
+            flush_output();
         }
-        strcat(buf, get_string(spec[i]));
-        // verbose("buf=\"%s\"\n", buf);
     }
-
-    return buf;
+    pthread_mutex_unlock(&output_lock);
+    trace_event("write", start);
+    out->length = 0;
 }
 
 /**
- * @brief Get the basedir string corresponding to the basedir id
+ * @brief Read the clocks of a worker, minus the time its parser spent in its
+ * phases so far
+ *
+ * Taking the difference of two readings gives the time spent between them
+ * outside of the phases of the parser, e.g. in print000file(), which detects
+ * the codepage and converts strings on demand.
  *
- * @param basedirid base dir id, a number between 0 and 17
- * @return Basedir string, e.g. "%CE1%", or null if basedirid is out of range
+ * @param worker worker with statistics enabled
+ * @param wall set to the wall time
+ * @param cpu set to the CPU time of the calling thread
  */
-const char *get_basedir(uint16_t basedirid) {
-    if (basedirid >= 0 && basedirid <= sizeof(BASE_DIRS)) {
-        return BASE_DIRS[basedirid];
+static void serialize_clock(const worker_context *worker, uint64_t *wall, uint64_t *cpu) {
+    const wcecab_stats *stats = wcecab_get_stats(worker->doc);
+
+    *wall = clock_ns(CLOCK_MONOTONIC);
+    *cpu = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+    for (int i = 0; i < WCECAB_NUM_PHASES; i++) {
+        *wall -= stats->wall_ns[i];
+        *cpu -= stats->cpu_ns[i];
     }
-    return NULL;
 }
 
 /**
- * @brief Get the full directory path for a directory id
+ * @brief Warn about an input whose extension does not match its type
  *
- * @param directoryid directory id
- * @return Full path or null if there is no corresponding directory entry
+ * @param path path of the input
+ * @param is_cab true if the input is a CAB file
  */
-const char *get_dir(uint16_t directoryid) {
-    CE_CAB_000_DIRECTORY_ENTRY *direntry = (CE_CAB_000_DIRECTORY_ENTRY *)(file + cabheader->OffsetDirs);
-    for (int i = 0; i < cabheader->NumEntriesDirs; i++) {
-        if (direntry->Id == directoryid) {
-            return parse_spec(&(direntry->Spec), direntry->SpecLength, "\\");
-        }
-        direntry = ((void *)direntry) + direntry->SpecLength + sizeof(uint16_t) + sizeof(uint16_t);
+static void check_extension(const char *path, bool is_cab) {
+    const char *ext = strrchr(path, '.');
+    const char *type = is_cab ? "CAB" : "000";
+    if (!ext || strcasecmp(ext + 1, type)) {
+        fprintf(stderr, "Warning: %s: File appears to be a %s file, but does not have a .%s extension\n", path, type, type);
     }
-    return "unknown";
 }
 
 /**
- * @brief Get the file name for a file id
+ * @brief Print the start of a record up to and including the input path
+ *
+ * This is all of a record that depends on the path, so records are cached
+ * without it, and are shared by copies of an input under different paths.
  *
- * @param fileid file id
- * @return File name or null if there is no corresponding file entry
+ * @param options commandline options
+ * @param path path of the input
+ * @param out output buffer to print into
  */
-const char *get_file(uint16_t fileid) {
-    CE_CAB_000_FILE_ENTRY *fileentry = (CE_CAB_000_FILE_ENTRY *)(file + cabheader->OffsetFiles);
-    for (int i = 0; i < cabheader->NumEntriesFiles; i++) {
-        if (fileentry->Id == fileid) {
-            return &(fileentry->FileName);
+static void print_record_head(const struct opts *options, const char *path, outbuf *out) {
+    if (options->printJson) {
+        if (options->batch || options->ndjson) {
+            json_writer json;
+            json_init(&json, out, !options->compact);
+            json_begin_object(&json);
+            json_key(&json, "file");
+            json_string(&json, path);
+        }
+    } else if (options->printReg) {
+        if (options->batch) {
+            outbuf_printf(out, "\n; %s\n", path);
         }
-        fileentry = ((void *)fileentry) + fileentry->FileNameLength + sizeof(CE_CAB_000_FILE_ENTRY) - 2;
+    } else if (options->batch) {
+        outbuf_printf(out, "file: %s\n", path);
     }
-    return NULL;
 }
 
 /**
- * @brief Get string representation of the architectore for an architecture id
+ * @brief Print the cached record of an input
  *
- * @param archid architecture id
- * @return Descriptive string, such as "SH3"
+ * @param options commandline options
+ * @param worker worker processing the input
+ * @param path path of the input
+ * @param digest digest of the input
+ * @return bool true if the record was cached and printed
  */
-const char *get_architecture(uint32_t archid) {
-    switch (archid) {
-        case CE_CAB_000_ARCH_SH3:
-            return CE_ARCH_SH3;  // SHx SH3
-        case CE_CAB_000_ARCH_SH4:
-            return CE_ARCH_SH4;  // SHx SH4
-        case CE_CAB_000_ARCH_I386:
-            return CE_ARCH_X86;  // Intel 386
-        case CE_CAB_000_ARCH_I486:
-            return CE_ARCH_X86;  // Intel 486
-        case CE_CAB_000_ARCH_I586:
-            return CE_ARCH_X86;  // Intel Pentium
-        case CE_CAB_000_ARCH_PPC601:
-            return "PPC601";  // PowerPC 601
-        case CE_CAB_000_ARCH_PPC603:
-            return "PPC602";  // PowerPC 603
-        case CE_CAB_000_ARCH_PPC604:
-            return "PPC604";  // PowerPC 604
-        case CE_CAB_000_ARCH_PPC620:
-            return "PPC620";  // PowerPC 620
-        case CE_CAB_000_ARCH_MOTOROLA_821:
-            return "MOTOROLA821";  // Motorola 821
-        case CE_CAB_000_ARCH_ARM720:
-            return CE_ARCH_ARM;  // ARM 720
-        case CE_CAB_000_ARCH_ARM820:
-            return CE_ARCH_ARM;  // ARM 820
-        case CE_CAB_000_ARCH_ARM920:
-            return CE_ARCH_ARM;  // ARM 920
-        case CE_CAB_000_ARCH_STRONGARM:
-            return CE_ARCH_ARM;  // StrongARM
-        case CE_CAB_000_ARCH_R4000:
-            return CE_ARCH_MIPS;  // MIPS R4000
-        case CE_CAB_000_ARCH_HITACHI_SH3:
-            return CE_ARCH_SH3;  // Hitachi SH3
-        case CE_CAB_000_ARCH_HITACHI_SH3E:
-            return CE_ARCH_SH3;  // Hitachi SH3E
-        case CE_CAB_000_ARCH_HITACHI_SH4:
-            return CE_ARCH_SH4;  // Hitachi SH4
-        case CE_CAB_000_ARCH_ALPHA:
-            return "ALPHA";  // Alpha 21064
-        case CE_CAB_000_ARCH_ARM7TDMI:
-            return CE_ARCH_THUMB;  // ARM 7TDMI
-        default:
-            return NULL;
-    }
+static bool print_cached_record(const struct opts *options, worker_context *worker, const char *path, const cache_digest *digest) {
+    uint64_t start = trace_clock();
+    outbuf *cached = &worker->cached;
+    bool found;
+
+    cached->length = 0;
+    found = cache_get(record_cache, digest, record_kind, cached) && cached->length;
+    trace_event("cache", start);
+    if (!found) return false;
+
+    check_extension(path, cached->data[0] & CACHED_CAB);
+    print_record_head(options, path, &worker->out);
+    outbuf_write(&worker->out, cached->data + 1, cached->length - 1);
+    return true;
 }
 
 /**
- * @brief Get a string representation of a registry data type
+ * @brief Add the record of an input to the cache
+ *
+ * The record is cached without its head, prefixed with the CACHED_* flags. A
+ * record that does not start with the head print_record_head() prints is not
+ * cached.
  *
- * @param flags 32bit flags object
- * @return corresponding registry data type
+ * @param options commandline options
+ * @param worker worker that printed the record of the input
+ * @param path path of the input
+ * @param digest digest of the input
+ * @param is_cab true if the input is a CAB file
  */
-const char *get_reg_datatype(uint32_t flags) {
-    // printf("FLAGS: 0x%08x", flags);
-    uint32_t masked = flags & 0x00010001;
-    switch (masked) {
-        case TYPE_REG_DWORD:
-            return "REG_DWORD";
-        case TYPE_REG_SZ:
-            return "REG_SZ";
-        case TYPE_REG_MULTI_SZ:
-            return "REG_MULTI_SZ";
-        case TYPE_REG_BINARY:
-            return "REG_BINARY";
+static void cache_record(const struct opts *options, worker_context *worker, const char *path, const cache_digest *digest, bool is_cab) {
+    outbuf *cached = &worker->cached;
+    size_t headlength;
+
+    cached->length = 0;
+    print_record_head(options, path, cached);
+    headlength = cached->length;
+    if (worker->out.length < headlength || (headlength && memcmp(worker->out.data, cached->data, headlength))) {
+        return;
     }
-}
 
-/**
- * @brief Concat 2 strings with a \ in between
- *
- * @param path1 First path
- * @param path2 Second path
- * @return combined string of the 2 paths with a \ in between
- */
-const char *join_paths(const char *path1, const char *path2) {
-    uint16_t len = strlen(path1) + strlen(path2) + 2;
-    char *out = malloc(len);
-    sprintf(out, "%s\\%s", path1, path2);
-    return out;
+    cached->length = 0;
+    outbuf_putc(cached, is_cab ? CACHED_CAB : 0);
+    if (worker->out.length > headlength) {
+        outbuf_write(cached, worker->out.data + headlength, worker->out.length - headlength);
+    }
+    // Errors are reported when the cache is closed
+    cache_put(record_cache, digest, record_kind, cached->data, cached->length);
 }
 
 /**
- * @brief Get the full path for a file
+ * @brief Add the 000 file extracted from a CAB file to the cache
  *
- * @param fileid file id
- * @return full path of the file or nullpointer if file can not be found
+ * @param worker worker that opened the CAB file
+ * @param digest digest of the CAB file
  */
-const char *get_file_full_path(uint16_t fileid) {
-    CE_CAB_000_FILE_ENTRY *fileentry = (CE_CAB_000_FILE_ENTRY *)(file + cabheader->OffsetFiles);
-    for (int i = 0; i < cabheader->NumEntriesFiles; i++) {
-        if (fileid == fileentry->Id) {
-            return join_paths(get_dir(fileentry->DirectoryId), &(fileentry->FileName));
-        }
-        fileentry = ((void *)fileentry) + fileentry->FileNameLength + sizeof(CE_CAB_000_FILE_ENTRY) - sizeof(uint16_t);
-    }
-    return NULL;
+static void cache_extracted(worker_context *worker, const cache_digest *digest) {
+    // The 000 file starts with its header, and its length was checked when
+    // it was opened
+    const CE_CAB_000_HEADER *header = wcecab_header(worker->doc);
+    cache_put(record_cache, digest, extracted_kind, header, header->FileLength);
 }
 
 /**
- * @brief Get the registry path for hive id
+ * @brief Print the information about a single input
  *
- * @param hiveid hive id
- * @return full path of the registry hive or nullpointer if hive can not be found
+ * With a cache, the input is identified by the digest of its contents first.
+ * A cached record is printed as is, otherwise the input is parsed and the
+ * record added to the cache. CAB files are parsed from the cached 000 file
+ * if there is one, so they are extracted only once.
+ *
+ * @param options commandline options
+ * @param worker worker processing the input
+ * @param path path of the input file, "-" for stdin
  */
-const char *get_reg_path(uint16_t hiveid) {
-    CE_CAB_000_REGHIVE_ENTRY *reghiveentry = (CE_CAB_000_REGHIVE_ENTRY *)(file + cabheader->OffsetRegHives);
-    for (int i = 0; i < cabheader->NumEntriesRegHives; i++) {
-        uint16_t id = reghiveentry->Id;
-        if (id == hiveid) return join_paths(get_hive(reghiveentry->HiveRoot), parse_spec(&(reghiveentry->Spec), reghiveentry->SpecLength, "\\"));
-        reghiveentry = ((void *)reghiveentry) + reghiveentry->SpecLength + sizeof(CE_CAB_000_REGHIVE_ENTRY) - sizeof(uint16_t);
+static void process_file(const struct opts *options, worker_context *worker, const char *path) {
+    uint64_t start = trace_clock();
+    const char *message = NULL;
+    cache_input input;
+    bool identified = false, cached = false, is_cab = false;
+
+    worker->trace.path = path;
+    worker->trace.transcodes = 0;
+    worker->trace.transcode_ns = 0;
+    verbose("Processing '%s'\n", path);
+    if (record_cache && !options->piped) {
+        uint64_t identifystart = trace_clock();
+        identified = cache_identify(record_cache, path, &input) == CACHE_OK;
+        trace_event("identify", identifystart);
     }
-    return NULL;
-}
 
-int main(int argc, char **argv) {
-    /** Commandline options */
-    struct opts *options = get_opts(argc, argv);
-    size_t file_size;
-    infile_struct file_info;
-    verbose_enabled = options->verbose;
+    if (options->piped) {
+        message = wcecab_open_stream(worker->doc, stdin) ? wcecab_error(worker->doc) : NULL;
+    } else if (identified && (cached = print_cached_record(options, worker, path, &input.digest))) {
+        verbose("Printed the cached record of '%s'\n", path);
+    } else {
+        const void *extracted = NULL;
+        size_t extractedsize;
 
-    if (!options->piped) {
-        // File input it provided via argument
-        const char *ext = strrchr(options->infile, '.');
-        if (access(options->infile, R_OK) == -1) {
-            fprintf(stderr, "Error: File can not be read or does not exist.");
-            exit(EXIT_FAILURE);
+        if (identified) {
+            uint64_t cachestart = trace_clock();
+            extracted = cache_map(record_cache, &input.digest, extracted_kind, &extractedsize);
+            trace_event("cache", cachestart);
         }
 
-        if (filehasheader(options->infile, CE_CAB_HEADER_SIGNATURE)) {
-            verbose("File was identified as a CAB file by file signature\n");
-
-            // TODO use libmspack instead of cabextract/7-zip
-            // Check file extension
-            // TODO Change to use tolower
-            if (!strcasecmp(ext, "CAB")) {
-                fprintf(stderr, "Warning: File appears to be a CAB file, but does not have a .cab extension");
-            }
-            char *extractcmd = malloc(256 + strlen(options->infile));
-
-#ifndef _WIN32
-            // Linux - use cabextract
-            // Check if cabextract is available
-            if (system("which cabextract > /dev/null 2>&1")) {
-                fprintf(stderr, "cabextract not found. Please install this dependency.\nhttps://www.cabextract.org.uk/\n");
-                exit(EXIT_FAILURE);
-            }
-            // Use cabextract to extract the 000 file and read the pipe
-            sprintf(extractcmd, "cabextract --pipe --filter \"*.000\" \"%s\"", options->infile);
-            FILE *pextract = popen(extractcmd, "r");
-
-#else
-            // Win32 - use 7z
-            if (system("7z > nul 2>&1")) {
-                fprintf(stderr, "7-zip not found. Please install this dependency and add\nthe directory containing 7z.exe to the PATH environment variable.\nhttps://www.7-zip.org/\n");
-                exit(EXIT_FAILURE);
-            }
-            // Extract using 7-Zip with piping to stdout set
-            sprintf(extractcmd, "7z e -i!*.000 -so \"%s\"", options->infile);
-            FILE *pextract = popen(extractcmd, "r");
-            // Set file mode to binary, otherwise Windows might stop the stream when encountering linebreaks or end of transmission characters
-            setmode(fileno(pextract), _O_BINARY);
-#endif
-
-            // Read extracted output
-            read000filestream(pextract, &file_info);
-            // Check if extract process succeeded
-            int status = pclose(pextract);
-            verbose("Extract process exited with status %d\n", status);
-            if (status) {
-                fprintf(stderr, "Error: extract process exited with status %d\n", status);
-                exit(EXIT_FAILURE);
-            }
-        } else if (filehasheader(options->infile, CE_CAB_000_HEADER_SIGNATURE)) {
-            verbose("File was identified as a 000 file by file signature\n");
-
-            // Check file extension
-            if (!strcasecmp(ext, "000")) {
-                fprintf(stderr,
-                        "Warning: File appears to be a 000 file, but does not have "
-                        "a .000 extension");
-            }
-
-// Read file contents of the 000 file
-#ifndef _WIN32
-            read000filecontents(options->infile, &file_info);
-#else
-            read000filestream(fopen(options->infile, "r"), &file_info);
-#endif
+        // An input that was hashed is parsed from the copy in memory
+        if (extracted) {
+            verbose("Opening the cached 000 file of '%s'\n", path);
+            message = wcecab_open_buffer(worker->doc, extracted, extractedsize) ? wcecab_error(worker->doc) : NULL;
+            is_cab = true;
+        } else if (identified && input.data) {
+            message = wcecab_open_buffer(worker->doc, input.data, input.size) ? wcecab_error(worker->doc) : NULL;
         } else {
-            fprintf(stderr, "Error: Input file is neither a CAB file nor a 000 file\n");
-            exit(EXIT_FAILURE);
+            message = wcecab_open_path(worker->doc, path) ? wcecab_error(worker->doc) : NULL;
+        }
+        if (!message) {
+            is_cab = is_cab || wcecab_is_cab(worker->doc);
+            check_extension(path, is_cab);
+            if (identified && !extracted && is_cab) {
+                cache_extracted(worker, &input.digest);
+            }
+        }
+    }
+    if (!message && !cached) {
+        uint64_t startwall, startcpu, endwall, endcpu;
+        uint64_t serializestart = trace_clock();
+
+        if (options->stats) serialize_clock(worker, &startwall, &startcpu);
+        message = print000file(options, worker->doc, path, &worker->out);
+        if (options->stats) {
+            serialize_clock(worker, &endwall, &endcpu);
+            worker->serialize_wall_ns += endwall - startwall;
+            worker->serialize_cpu_ns += endcpu - startcpu;
+        }
+        if (tracing) {
+            json_writer json;
+            trace_begin(&json, "serialize", serializestart, clock_ns(CLOCK_MONOTONIC));
+            json_key(&json, "transcodes");
+            json_uint(&json, worker->trace.transcodes);
+            json_key(&json, "transcodeUs");
+            json_double(&json, worker->trace.transcode_ns / 1e3);
+            trace_finish(&json);
+        }
+        if (!message && identified) {
+            cache_record(options, worker, path, &input.digest, is_cab);
         }
-    } else {
-        // Piped input
-
-        // CAB file
-        // fprintf(stderr,("Piping in CAB files is supported at this time\n");
-        // exit(EXIT_FAILURE);
-
-        // TODO make difference between cab file and 000 file
-
-        read000filestream(stdin, &file_info);
     }
 
-    file = (void *)file_info.file;
-    file_size = (size_t)file_info.size;
-
-    verbose("Opened file, size: %d\n", file_size);
-
-    if (!file_size) {
-        fprintf(stderr, "Error: Input size is 0\n");
-        exit(EXIT_FAILURE);
+    if (message) {
+        worker->out.length = 0;
+        report_error(options, path, message, &worker->out);
+    }
+    write_record(options, &worker->out, message != NULL);
+    wcecab_close(worker->doc);
+    if (identified) {
+        cache_release_input(&input);
     }
+    trace_event("file", start);
+    worker->trace.path = NULL;
+}
 
-    cabheader = (CE_CAB_000_HEADER *)file;
+/**
+ * @brief Compare two directory entry names for qsort
+ */
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
 
-    if (cabheader->AsciiSignature != CE_CAB_000_HEADER_SIGNATURE) {
-        fprintf(stderr, "Error: Input file is not a .000 file\n");
+/**
+ * @brief Append a path to the list of input files
+ *
+ * @param path path to append, ownership is taken, NULL if allocating it
+ * failed
+ */
+static void add_input(char *path) {
+    if (!path) {
+        perror("Failed to allocate input path");
         exit(EXIT_FAILURE);
     }
-
-    if (cabheader->FileLength != file_size) {
-        fprintf(stderr, "Error: 000 header file length (%d) and actual file length (%d) don't match\n", cabheader->FileLength, (uint32_t)file_size);
-        exit(EXIT_FAILURE);
+    if (numinputs == maxinputs) {
+        maxinputs = maxinputs ? maxinputs * 2 : 64;
+        inputs = realloc(inputs, maxinputs * sizeof(char *));
+        if (!inputs) {
+            perror("Failed to allocate input list");
+            exit(EXIT_FAILURE);
+        }
     }
+    inputs[numinputs++] = path;
+}
 
-    verbose("AsciiSignature: %#08X\n", cabheader->AsciiSignature);
-    verbose("Unknown1: %d\n", cabheader->Unknown1);
-    verbose("FileLength: %d\n", cabheader->FileLength);
-    verbose("Unknown2: %d\n", cabheader->Unknown2);
-    verbose("Unknown3: %d\n", cabheader->Unknown3);
-    verbose("TargetArchitecture: %d\n", cabheader->TargetArchitecture);
-    verbose("MinCEVersionMajor: %d\n", cabheader->MinCEVersionMajor);
-    verbose("MinCEVersionMinor: %d\n", cabheader->MinCEVersionMinor);
-    verbose("MaxCEVersionMajor: %d\n", cabheader->MaxCEVersionMajor);
-    verbose("MaxCEVersionMinor: %d\n", cabheader->MaxCEVersionMinor);
-    verbose("MinCEBuildNumber: %d\n", cabheader->MinCEBuildNumber);
-    verbose("MaxCEBuildNumber: %d\n", cabheader->MaxCEBuildNumber);
-    verbose("NumEntriesString: %d\n", cabheader->NumEntriesString);
-    verbose("NumEntriesDirs: %d\n", cabheader->NumEntriesDirs);
-    verbose("NumEntriesFiles: %d\n", cabheader->NumEntriesFiles);
-    verbose("NumEntriesRegHives: %d\n", cabheader->NumEntriesRegHives);
-    verbose("NumEntriesRegKeys: %d\n", cabheader->NumEntriesRegKeys);
-    verbose("NumEntriesLinks: %d\n", cabheader->NumEntriesLinks);
-    verbose("OffsetStrings: %d\n", cabheader->OffsetStrings);
-    verbose("OffsetDirs: %d\n", cabheader->OffsetDirs);
-    verbose("OffsetFiles: %d\n", cabheader->OffsetFiles);
-    verbose("OffsetRegHives: %d\n", cabheader->OffsetRegHives);
-    verbose("OffsetRegKeys: %d\n", cabheader->OffsetRegKeys);
-    verbose("OffsetLinks: %d\n", cabheader->OffsetLinks);
-    verbose("OffsetAppname: %d\n", cabheader->OffsetAppname);
-    verbose("LengthAppname: %d\n", cabheader->LengthAppname);
-    verbose("OffsetProvider: %d\n", cabheader->OffsetProvider);
-    verbose("LengthProvider: %d\n", cabheader->LengthProvider);
-    verbose("OffsetUnsupported: %d\n", cabheader->OffsetUnsupported);
-    verbose("LengthUnsupported: %d\n", cabheader->LengthUnsupported);
-    verbose("Unknown4: %d\n", cabheader->Unknown4);
-    verbose("Unknown5: %d\n", cabheader->Unknown5);
-
-    const char *appName = convert_string((char *)(file + cabheader->OffsetAppname));
-    const char *provider = convert_string((char *)(file + cabheader->OffsetProvider));
-    const char *architecture = get_architecture(cabheader->TargetArchitecture);
-
-    const char *usup = (const char *)(file + cabheader->OffsetUnsupported);
-    const uint16_t usuplen = cabheader->LengthUnsupported;
-    const char **unsupported = get_unsupported(usup, usuplen);
-
-    if (options->printJson) {
-        char *buffer = malloc(256);
-
-        /** Root JSON Object */
-        cJSON *cabJson = cJSON_CreateObject();
-
-        /** App Name JSON Object */
-        cJSON_AddStringToObject(cabJson, "appName", appName);
+/**
+ * @brief Add a file, or all .cab and .000 files below a directory, to the list
+ * of input files
+ *
+ * Directory entries are visited in name order, so the inputs are in the same
+ * order on every run. Links to files below a directory are followed, links to
+ * directories are not.
+ *
+ * @param options commandline options
+ * @param path file or directory path
+ * @param explicit true if the path was given on the commandline, which adds it
+ * regardless of its extension
+ */
+static void collect_inputs(const struct opts *options, const char *path, bool explicit) {
+    struct stat s;
+    DIR *dir;
+    struct dirent *entry;
+    char **names = NULL;
+    size_t numnames = 0;
+    size_t maxnames = 0;
+
+    if (stat(path, &s) || !S_ISDIR(s.st_mode)) {
+        const char *ext = strrchr(path, '.');
+        if (explicit || (ext && (!strcasecmp(ext, ".cab") || !strcasecmp(ext, ".000")))) {
+            add_input(strdup(path));
+        }
+        return;
+    }
 
-        /** Provider JSON Object */
-        cJSON_AddStringToObject(cabJson, "provider", provider);
+    verbose("Searching directory '%s'\n", path);
+    if (!(dir = opendir(path))) {
+        outbuf out = {0};
+        report_error(options, path, strerror(errno), &out);
+        write_record(options, &out, true);
+        free(out.data);
+        return;
+    }
 
-        /** Provider JSON Object */
-        if (architecture) {
-            cJSON_AddStringToObject(cabJson, "architecture", architecture);
-        } else {
-            cJSON_AddItemToObject(cabJson, "architecture", cJSON_CreateNull());
-        }
+    while ((entry = readdir(dir))) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
 
-        /** Unsupported */
-        if (*unsupported) {
-            cJSON *unsupportedJson = cJSON_CreateArray();
-            for (int i = 0; unsupported[i] && strlen(unsupported[i]); i++) {
-                cJSON_AddItemToArray(unsupportedJson, cJSON_CreateString(unsupported[i]));
+        if (numnames == maxnames) {
+            maxnames = maxnames ? maxnames * 2 : 64;
+            names = realloc(names, maxnames * sizeof(char *));
+            if (!names) {
+                perror("Failed to allocate directory entries");
+                exit(EXIT_FAILURE);
             }
-            cJSON_AddItemToObject(cabJson, "unsupported", unsupportedJson);
         }
-
-        /** Min CE Version */
-        if (cabheader->MinCEVersionMajor) {
-            cJSON *minCeVersionJson = cJSON_CreateObject();
-            /** Min CE Version Major JSON Object */
-            cJSON *minCeVersionMajorJson = cJSON_CreateNumber(cabheader->MinCEVersionMajor);
-            cJSON_AddItemToObject(minCeVersionJson, "major", minCeVersionMajorJson);
-            cJSON *minCeVersionMinorJson = cJSON_CreateNumber(cabheader->MinCEVersionMinor);
-            cJSON_AddItemToObject(minCeVersionJson, "minor", minCeVersionMinorJson);
-            /** Min CE Version String */
-            sprintf(buffer, "%d.%d", cabheader->MinCEVersionMajor, cabheader->MinCEVersionMinor);
-            cJSON *minCeVersionStringJson = cJSON_CreateString(buffer);
-            cJSON_AddItemToObject(minCeVersionJson, "stringValue", minCeVersionStringJson);
-            cJSON_AddItemToObject(cabJson, "minCeVersion", minCeVersionJson);
+        names[numnames] = malloc(strlen(path) + strlen(entry->d_name) + 2);
+        if (!names[numnames]) {
+            perror("Failed to allocate directory entry");
+            exit(EXIT_FAILURE);
         }
+        sprintf(names[numnames++], strendswith(path, "/") ? "%s%s" : "%s/%s", path, entry->d_name);
+    }
+    closedir(dir);
 
-        /** Max CE Version */
-        if (cabheader->MaxCEVersionMajor) {
-            cJSON *maxCeVersionJson = cJSON_CreateObject();
-            /** Min CE Version Major JSON Object */
-            cJSON *maxCeVersionMajorJson = cJSON_CreateNumber(cabheader->MaxCEVersionMajor);
-            cJSON_AddItemToObject(maxCeVersionJson, "major", maxCeVersionMajorJson);
-            cJSON *maxCeVersionMinorJson = cJSON_CreateNumber(cabheader->MaxCEVersionMinor);
-            cJSON_AddItemToObject(maxCeVersionJson, "minor", maxCeVersionMinorJson);
-            /** Min CE Version String */
-            sprintf(buffer, "%d.%d", cabheader->MaxCEVersionMajor, cabheader->MaxCEVersionMinor);
-            cJSON *maxCeVersionStringJson = cJSON_CreateString(buffer);
-            cJSON_AddItemToObject(maxCeVersionJson, "stringValue", maxCeVersionStringJson);
-            cJSON_AddItemToObject(cabJson, "maxCeVersion", maxCeVersionJson);
-        }
+    qsort(names, numnames, sizeof(char *), compare_names);
 
-        /** Min CE build number */
-        if (cabheader->MinCEBuildNumber) {
-            cJSON *minCeBuildNumberJson = cJSON_CreateNumber(cabheader->MinCEBuildNumber);
-            cJSON_AddItemToObject(cabJson, "minCeBuildNumber", minCeBuildNumberJson);
+    for (size_t i = 0; i < numnames; i++) {
+#ifndef _WIN32
+        // Links to directories are not followed, they can form loops
+        if (!lstat(names[i], &s) && S_ISLNK(s.st_mode) && !stat(names[i], &s) && S_ISDIR(s.st_mode)) {
+            verbose("Skipping link to directory '%s'\n", names[i]);
+            free(names[i]);
+            continue;
         }
-
-        /** Max CE build number */
-        if (cabheader->MaxCEBuildNumber) {
-            cJSON *maxCeBuildNumberJson = cJSON_CreateNumber(cabheader->MaxCEBuildNumber);
-            cJSON_AddItemToObject(cabJson, "maxCeBuildNumber", maxCeBuildNumberJson);
+#endif
+        // Dangling links and entries removed in the meantime are skipped
+        if (!stat(names[i], &s)) {
+            collect_inputs(options, names[i], false);
         }
+        free(names[i]);
+    }
+    free(names);
+}
 
-        /** Directories */
-        cJSON *directoriesJson = cJSON_CreateArray();
-        CE_CAB_000_DIRECTORY_ENTRY *directoryentry = (CE_CAB_000_DIRECTORY_ENTRY *)(file + cabheader->OffsetDirs);
-        for (int i = 0; i < cabheader->NumEntriesDirs; i++) {
-            cJSON *directoryItem = cJSON_CreateObject();
-
-            // cJSON *specLength = cJSON_CreateNumber(directoryentry->SpecLength);
-            // cJSON_AddItemToObject(directoryItem, "specLength", specLength);
-
-            /** Directory ID */
-            cJSON *directoryId = cJSON_CreateNumber(directoryentry->Id);
-            cJSON_AddItemToObject(directoryItem, "id", directoryId);
-
-            /** Directory Path */
-            cJSON *directoryPath = cJSON_CreateString(convert_string(parse_spec(&(directoryentry->Spec), directoryentry->SpecLength, "\\")));
-            cJSON_AddItemToObject(directoryItem, "path", directoryPath);
-
-            directoryentry = ((void *)directoryentry) + directoryentry->SpecLength + sizeof(CE_CAB_000_DIRECTORY_ENTRY) - sizeof(uint16_t);
-            cJSON_AddItemToArray(directoriesJson, directoryItem);
+/**
+ * @brief Take the next input for a worker, stealing from other workers once
+ * its own queue is empty
+ *
+ * @param worker index of the worker
+ * @param numworkers number of workers
+ * @param index index of the input taken
+ * @return bool true if an input was taken, false if all queues are empty
+ */
+static bool take_input(int worker, int numworkers, size_t *index) {
+    worker_context *self = &workers[worker];
+
+    pthread_mutex_lock(&self->lock);
+    if (self->head < self->tail) {
+        *index = self->head++;
+        pthread_mutex_unlock(&self->lock);
+        return true;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    for (int i = 1; i < numworkers; i++) {
+        worker_context *victim = &workers[(worker + i) % numworkers];
+        size_t head, tail;
+
+        pthread_mutex_lock(&victim->lock);
+        tail = victim->tail;
+        head = tail - (tail - victim->head + 1) / 2;
+        victim->tail = head;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (head < tail) {
+            pthread_mutex_lock(&self->lock);
+            self->head = head + 1;
+            self->tail = tail;
+            pthread_mutex_unlock(&self->lock);
+            *index = head;
+            return true;
         }
-        cJSON_AddItemToObject(cabJson, "directories", directoriesJson);
+    }
+    return false;
+}
 
-        /** Files */
-        cJSON *filesJson = cJSON_CreateArray();
-        CE_CAB_000_FILE_ENTRY *fileentry = (CE_CAB_000_FILE_ENTRY *)(file + cabheader->OffsetFiles);
-        for (int i = 0; i < cabheader->NumEntriesFiles; i++) {
-            cJSON *fileItem = cJSON_CreateObject();
+/**
+ * @brief Worker thread, processes inputs until all queues are empty
+ *
+ * @param arg index of the worker
+ * @return void* NULL
+ */
+static void *run_worker(void *arg) {
+    int worker = (int)(intptr_t)arg;
+    size_t index;
 
-            /** File ID */
-            cJSON *fileId = cJSON_CreateNumber(fileentry->Id);
-            cJSON_AddItemToObject(fileItem, "id", fileId);
+    thread_trace = &workers[worker].trace;
+    while (take_input(worker, options.jobs, &index)) {
+        process_file(&options, &workers[worker], inputs[index]);
+    }
+    thread_trace = &main_trace;
+    return NULL;
+}
 
-            /** File Name */
-            cJSON *fileName = cJSON_CreateString(convert_string(&(fileentry->FileName)));
-            cJSON_AddItemToObject(fileItem, "name", fileName);
+/**
+ * @brief Add the statistics of a parser context to a total
+ *
+ * @param total statistics to add to
+ * @param stats statistics to add
+ */
+static void add_stats(wcecab_stats *total, const wcecab_stats *stats) {
+    for (int i = 0; i < WCECAB_NUM_PHASES; i++) {
+        total->wall_ns[i] += stats->wall_ns[i];
+        total->cpu_ns[i] += stats->cpu_ns[i];
+    }
+    total->bytes_read += stats->bytes_read;
+    total->bytes_extracted += stats->bytes_extracted;
+    total->string_lookups += stats->string_lookups;
+    total->transcodes += stats->transcodes;
+    total->allocations += stats->allocations;
+    total->arena_blocks += stats->arena_blocks;
+}
 
-            /** File Directory */
-            cJSON *directory = cJSON_CreateString(convert_string(get_dir(fileentry->DirectoryId)));
-            cJSON_AddItemToObject(fileItem, "directory", directory);
+/**
+ * @brief Write the time of a phase as a JSON object
+ */
+static void json_phase(json_writer *json, const char *name, uint64_t wall, uint64_t cpu) {
+    json_key(json, name);
+    json_begin_object(json);
+    json_key(json, "wallNs");
+    json_uint(json, wall);
+    json_key(json, "cpuNs");
+    json_uint(json, cpu);
+    json_end_object(json);
+}
 
-            // Flags
-            if (fileentry->FlagsUpper & 0x8000) {
-                cJSON_AddItemToObject(fileItem, "isReferenceCountingSharedFile", cJSON_CreateTrue());
-            }
-            if (fileentry->FlagsUpper & 0x4000) {
-                cJSON_AddItemToObject(fileItem, "ignoreCabFileDate", cJSON_CreateTrue());
-            }
-            if (fileentry->FlagsUpper & 0x2000) {
-                cJSON_AddItemToObject(fileItem, "doNotOverWriteIfTargetIsNewer", cJSON_CreateTrue());
-            }
-            if (fileentry->FlagsUpper & 0x1000) {
-                cJSON_AddItemToObject(fileItem, "selfRegisterDll", cJSON_CreateTrue());
-            }
-            if (fileentry->FlagsLower & 0x0400) {
-                cJSON_AddItemToObject(fileItem, "doNotCopyUnlessTargetExists", cJSON_CreateTrue());
-            }
-            if (fileentry->FlagsLower & 0x0010) {
-                cJSON_AddItemToObject(fileItem, "overWriteTargetIfExists", cJSON_CreateTrue());
-            }
-            if (fileentry->FlagsLower & 0x0002) {
-                cJSON_AddItemToObject(fileItem, "doNotSkip", cJSON_CreateTrue());
-            }
-            if (fileentry->FlagsLower & 0x0001) {
-                cJSON_AddItemToObject(fileItem, "warnIfSkipped", cJSON_CreateTrue());
-            }
+/**
+ * @brief Report the statistics of all workers, summed up
+ *
+ * The times of the phases are summed up over all workers, with more than one
+ * job they can add up to more than the wall time of the whole run.
+ *
+ * @param options commandline options
+ * @param start wall time the run started at
+ * @param cachestats counters of the cache, NULL if no cache was used
+ */
+static void print_stats(const struct opts *options, uint64_t start, const cache_stats *cachestats) {
+    uint64_t wall = clock_ns(CLOCK_MONOTONIC) - start;
+    uint64_t cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+    uint64_t serializewall = 0, serializecpu = 0;
+    wcecab_stats total = {0};
+
+    for (int i = 0; i < options->jobs; i++) {
+        add_stats(&total, wcecab_get_stats(workers[i].doc));
+        serializewall += workers[i].serialize_wall_ns;
+        serializecpu += workers[i].serialize_cpu_ns;
+    }
 
-            fileentry = ((void *)fileentry) + fileentry->FileNameLength + sizeof(CE_CAB_000_FILE_ENTRY) - 2;
-            cJSON_AddItemToArray(filesJson, fileItem);
+    if (!options->statsFile) {
+        fprintf(stderr, "inputs: %zu, failures: %d, jobs: %d\n", numinputs, failures, options->jobs);
+        fprintf(stderr, "%-10s %12s %12s\n", "phase", "wall ms", "cpu ms");
+        for (int i = 0; i < WCECAB_NUM_PHASES; i++) {
+            fprintf(stderr, "%-10s %12.3f %12.3f\n", wcecab_phase_name(i), total.wall_ns[i] / 1e6, total.cpu_ns[i] / 1e6);
         }
-        cJSON_AddItemToObject(cabJson, "files", filesJson);
-
-        /** Registry Entries */
-        cJSON *registryEntriesJson = cJSON_CreateArray();
-        CE_CAB_000_REGKEY_ENTRY *regkeyentry = (CE_CAB_000_REGKEY_ENTRY *)(file + cabheader->OffsetRegKeys);
-        for (int i = 0; i < cabheader->NumEntriesRegKeys; i++) {
-            const char *name = &(regkeyentry->KeyName);
-            const char *value = &(regkeyentry->KeyName) + strlen(&(regkeyentry->KeyName)) + 1;
-            const char *datatype = get_reg_datatype(regkeyentry->TypeFlagsUpper << 16 | regkeyentry->TypeFlagsLower);
-            const uint16_t datalength = regkeyentry->DataLength - strlen(&(regkeyentry->KeyName)) - 1;
-            uint32_t regtype = (regkeyentry->TypeFlagsUpper << 16 | regkeyentry->TypeFlagsLower) & TYPE_REG_MASK;
-            const char *path = get_reg_path(regkeyentry->HiveId);
-            uint8_t *ptr = (uint8_t *)value;
-
-            /** Reg Key Item */
-            cJSON *regKeyItem = cJSON_CreateObject();
-
-            /** Reg path */
-            cJSON *pathJson = cJSON_CreateString(convert_string(path));
-            cJSON_AddItemToObject(regKeyItem, "path", pathJson);
-
-            /** Reg Item name. Null if default */
-            cJSON *nameJson = strlen(name) ? cJSON_CreateString(convert_string(name)) : cJSON_CreateNull();
-            cJSON_AddItemToObject(regKeyItem, "name", nameJson);
-
-            /** Reg value data type */
-            cJSON *dataTypeJson = cJSON_CreateString(datatype);
-            cJSON_AddItemToObject(regKeyItem, "dataType", dataTypeJson);
-
-            /** Reg item data */
-            char *val;
-            switch (regtype) {
-                case TYPE_REG_DWORD:
-                    val = malloc(16);
-                    sprintf(val, "dword:%08X", read_uint32_le(value));
-                    break;
-                case TYPE_REG_SZ:
-                    val = (char *)convert_string(value);
-                    break;
-                case TYPE_REG_MULTI_SZ:
-                    val = malloc(8 + datalength * 3);
-                    sprintf(val, "hex(7):");
-                    for (uint16_t i = 0; i < datalength; i++) {
-                        if (i) strcat(val, ",");
-                        sprintf(val, "%02X", ptr[i]);
-                    }
-                    break;
-                case TYPE_REG_BINARY:
-                    val = malloc(8 + datalength * 3);
-                    sprintf(val, "hex:");
-                    for (uint16_t i = 0; i < datalength; i++) {
-                        if (i) strcat(val, ",");
-                        sprintf(val, "%02X", ptr[i]);
-                    }
-                    break;
-            }
-            cJSON *valueJson = cJSON_CreateString(val);
-            cJSON_AddItemToObject(regKeyItem, "value", valueJson);
-
-            regkeyentry = ((void *)regkeyentry) + regkeyentry->DataLength + sizeof(CE_CAB_000_REGKEY_ENTRY) - sizeof(uint16_t);
-            cJSON_AddItemToArray(registryEntriesJson, regKeyItem);
+        fprintf(stderr, "%-10s %12.3f %12.3f\n", "serialize", serializewall / 1e6, serializecpu / 1e6);
+        fprintf(stderr, "%-10s %12.3f %12.3f\n", "total", wall / 1e6, cpu / 1e6);
+        fprintf(stderr, "bytes read: %llu\n", (unsigned long long)total.bytes_read);
+        fprintf(stderr, "bytes extracted: %llu\n", (unsigned long long)total.bytes_extracted);
+        fprintf(stderr, "bytes written: %llu\n", (unsigned long long)bytes_written);
+        fprintf(stderr, "string lookups: %llu\n", (unsigned long long)total.string_lookups);
+        fprintf(stderr, "transcodes: %llu\n", (unsigned long long)total.transcodes);
+        fprintf(stderr, "allocations: %llu\n", (unsigned long long)total.allocations);
+        fprintf(stderr, "arena blocks: %llu\n", (unsigned long long)total.arena_blocks);
+        if (cachestats) {
+            fprintf(stderr, "cache hits: %llu\n", (unsigned long long)cachestats->hits);
+            fprintf(stderr, "cache misses: %llu\n", (unsigned long long)cachestats->misses);
+            fprintf(stderr, "cache stores: %llu\n", (unsigned long long)cachestats->stores);
+            fprintf(stderr, "cache evictions: %llu\n", (unsigned long long)cachestats->evictions);
+            fprintf(stderr, "inputs identified by stat: %llu\n", (unsigned long long)cachestats->identity_hits);
+            fprintf(stderr, "inputs hashed: %llu\n", (unsigned long long)cachestats->identity_misses);
+            fprintf(stderr, "bytes hashed: %llu\n", (unsigned long long)cachestats->bytes_hashed);
         }
-        cJSON_AddItemToObject(cabJson, "registryEntries", registryEntriesJson);
+        return;
+    }
 
-        /** Links */
-        cJSON *linksJson = cJSON_CreateArray();
-        CE_CAB_000_LINK_ENTRY *linkentry = (CE_CAB_000_LINK_ENTRY *)(file + cabheader->OffsetLinks);
-        for (int i = 0; i < cabheader->NumEntriesLinks; i++) {
-            const char *basedir = get_basedir(linkentry->BaseDirectory);
-            const char *linkspec = parse_spec(&(linkentry->Spec), linkentry->SpecLength + 2, "\\");
+    outbuf out = {0};
+    json_writer json;
+    json_init(&json, &out, true);
+    json_begin_object(&json);
+    json_key(&json, "inputs");
+    json_uint(&json, numinputs);
+    json_key(&json, "failures");
+    json_uint(&json, failures);
+    json_key(&json, "jobs");
+    json_uint(&json, options->jobs);
+    json_key(&json, "wallNs");
+    json_uint(&json, wall);
+    json_key(&json, "cpuNs");
+    json_uint(&json, cpu);
+    json_key(&json, "phases");
+    json_begin_object(&json);
+    for (int i = 0; i < WCECAB_NUM_PHASES; i++) {
+        json_phase(&json, wcecab_phase_name(i), total.wall_ns[i], total.cpu_ns[i]);
+    }
+    json_phase(&json, "serialize", serializewall, serializecpu);
+    json_end_object(&json);
+    json_key(&json, "counters");
+    json_begin_object(&json);
+    json_key(&json, "bytesRead");
+    json_uint(&json, total.bytes_read);
+    json_key(&json, "bytesExtracted");
+    json_uint(&json, total.bytes_extracted);
+    json_key(&json, "bytesWritten");
+    json_uint(&json, bytes_written);
+    json_key(&json, "stringLookups");
+    json_uint(&json, total.string_lookups);
+    json_key(&json, "transcodes");
+    json_uint(&json, total.transcodes);
+    json_key(&json, "allocations");
+    json_uint(&json, total.allocations);
+    json_key(&json, "arenaBlocks");
+    json_uint(&json, total.arena_blocks);
+    json_end_object(&json);
+    if (cachestats) {
+        json_key(&json, "cache");
+        json_begin_object(&json);
+        json_key(&json, "hits");
+        json_uint(&json, cachestats->hits);
+        json_key(&json, "misses");
+        json_uint(&json, cachestats->misses);
+        json_key(&json, "stores");
+        json_uint(&json, cachestats->stores);
+        json_key(&json, "evictions");
+        json_uint(&json, cachestats->evictions);
+        json_key(&json, "identifiedByStat");
+        json_uint(&json, cachestats->identity_hits);
+        json_key(&json, "hashed");
+        json_uint(&json, cachestats->identity_misses);
+        json_key(&json, "bytesHashed");
+        json_uint(&json, cachestats->bytes_hashed);
+        json_end_object(&json);
+    }
+    json_end_object(&json);
+    outbuf_putc(&out, '\n');
 
-            cJSON *linkItem = cJSON_CreateObject();
+    FILE *file = fopen(options->statsFile, "w");
+    if (!file || fwrite(out.data, 1, out.length, file) != out.length) {
+        fprintf(stderr, "Error: %s: %s\n", options->statsFile, strerror(errno));
+        failures++;
+    }
+    if (file && fclose(file)) {
+        fprintf(stderr, "Error: %s: %s\n", options->statsFile, strerror(errno));
+        failures++;
+    }
+    free(out.data);
+}
 
-            // cJSON *specLength = cJSON_CreateNumber(linkentry->SpecLength);
-            // cJSON_AddItemToObject(linkItem, "specLength", specLength);
+/**
+ * @brief Get the kind of cached blobs with the given description
+ *
+ * @param description description of the blobs
+ * @return uint64_t kind of the blobs
+ */
+static uint64_t get_kind(const char *description) {
+    cache_digest digest;
+    cache_digest_bytes(description, strlen(description), &digest);
+    return digest.lo;
+}
 
-            // cJSON *linkId = cJSON_CreateNumber(linkentry->Id);
-            // cJSON_AddItemToObject(linkItem, "linkId", linkId);
+/**
+ * @brief Get the kind of the cached records printed with the given options
+ *
+ * Records printed with other output options, or by another version, are of
+ * another kind.
+ *
+ * @param options commandline options
+ * @return uint64_t kind of the records
+ */
+static uint64_t get_record_kind(const struct opts *options) {
+    char description[256];
 
-            cJSON_AddBoolToObject(linkItem, "isFile", linkentry->LinkType);
-            cJSON_AddNumberToObject(linkItem, "targetId", linkentry->TargetId);
-            cJSON_AddStringToObject(linkItem, "linkPath", convert_string(join_paths(basedir, linkspec)));
+    snprintf(description, sizeof(description), "record " PROGRAM_VERSION " json=%d compact=%d ndjson=%d reg=%d batch=%d codepage=%s", options->printJson,
+             options->compact, options->ndjson, options->printReg, options->batch, options->codepage ? options->codepage : "");
+    return get_kind(description);
+}
 
-            if (linkentry->LinkType) {
-                cJSON_AddStringToObject(linkItem, "targetPath", convert_string(get_file_full_path(linkentry->TargetId)));
-            } else {
-                cJSON_AddStringToObject(linkItem, "targetPath", convert_string(get_dir(linkentry->TargetId)));
-            }
+int main(int argc, char **argv) {
+    /** Commandline options */
+    struct opts *options = get_opts(argc, argv);
+    verbose_enabled = options->verbose;
+    uint64_t start = clock_ns(CLOCK_MONOTONIC);
+    tracing = options->traceFile != NULL;
+    trace_start = start;
 
-            linkentry = ((void *)linkentry) + linkentry->SpecLength + sizeof(CE_CAB_000_LINK_ENTRY) - sizeof(uint16_t);
+    if (options->piped) {
+        // Piped input
+        add_input(strdup("-"));
+    } else {
+        // File and directory inputs provided via arguments
+        for (int i = 0; i < options->numInfiles; i++) {
+            collect_inputs(options, options->infiles[i], true);
+        }
+    }
 
-            cJSON_AddItemToArray(linksJson, linkItem);
+    // Piped input can not be identified without reading it
+    if (options->cacheDir && !options->piped) {
+        int status = cache_open(options->cacheDir, &options->cacheLimits, &record_cache);
+        if (status != CACHE_OK) {
+            fprintf(stderr, "Warning: %s: %s, continuing without cache\n", options->cacheDir, cache_strerror(status));
+            record_cache = NULL;
         }
-        cJSON_AddItemToObject(cabJson, "links", linksJson);
+        record_kind = get_record_kind(options);
+        extracted_kind = get_kind("000 " PROGRAM_VERSION);
+    }
 
-        /** Stringified JSON Object */
-        const char *stringJson = cJSON_Print(cabJson);
-        if (stringJson == NULL) {
-            fprintf(stderr, "Failed to print json.\n");
+    // jobs is at least 1 once the options are parsed
+    if ((size_t)options->jobs > numinputs) {
+        options->jobs = numinputs ? numinputs : 1;
+    }
+    verbose("Processing %d inputs with %d threads\n", (int)numinputs, options->jobs);
+
+    // The inputs are split evenly between the workers, the work stealing
+    // balances out differences in file sizes
+    workers = calloc(options->jobs, sizeof(worker_context));
+    for (int i = 0; i < options->jobs; i++) {
+        workers[i].head = numinputs * i / options->jobs;
+        workers[i].tail = numinputs * (i + 1) / options->jobs;
+        pthread_mutex_init(&workers[i].lock, NULL);
+        if (!(workers[i].doc = wcecab_new())) {
+            perror("Failed to allocate parser context");
             exit(EXIT_FAILURE);
         }
-
-        // Print JSON
-        puts(stringJson);
-    } else if (options->printReg) {
-        // Reg file first line
-        fprintf(stdout, "REGEDIT4\n");
-
-        int previoushiveid = -1;
-
-        CE_CAB_000_REGKEY_ENTRY *regkeyentry = (CE_CAB_000_REGKEY_ENTRY *)(file + cabheader->OffsetRegKeys);
-        for (int i = 0; i < cabheader->NumEntriesRegKeys; i++) {
-            const char *name = &(regkeyentry->KeyName);
-            const uint16_t hiveid = regkeyentry->HiveId;
-            const void *value = &(regkeyentry->KeyName) + strlen(&(regkeyentry->KeyName)) + 1;
-            const char *datatype = get_reg_datatype(regkeyentry->TypeFlagsUpper << 16 | regkeyentry->TypeFlagsLower);
-            const char *path = get_reg_path(regkeyentry->HiveId);
-            const uint16_t datalength = regkeyentry->DataLength - strlen(&(regkeyentry->KeyName)) - 1;
-            uint8_t *ptr = (uint8_t *)value;
-            uint32_t regtype = (regkeyentry->TypeFlagsUpper << 16 | regkeyentry->TypeFlagsLower) & TYPE_REG_MASK;
-
-            if (previoushiveid != hiveid) {
-                fprintf(stdout, "\n[%s]\n", path);
-            }
-            // fprintf(stdout, "HideId: %d\n", regkeyentry->HiveId);
-            // fprintf(stdout, "DataLength: %d\n", datalength);
-
-            fprintf(stdout, strlen(name) ? "\"%s\"=" : "@=", name);
-            switch (regtype) {
-                case TYPE_REG_DWORD:
-                    fprintf(stdout, "dword:%08X", *((uint32_t *)value));
-                    break;
-                case TYPE_REG_SZ:
-                    fprintf(stdout, "\"%s\"", (char *)value);
-                    break;
-                case TYPE_REG_MULTI_SZ:
-                    fprintf(stdout, "hex(7):");
-                    for (uint16_t i = 0; i < datalength; i++) {
-                        if (i) putc(',', stdout);
-                        fprintf(stdout, "%02X", ptr[i]);
-                    }
-                    break;
-                case TYPE_REG_BINARY:
-                    fprintf(stdout, "hex:");
-                    for (uint16_t i = 0; i < datalength; i++) {
-                        if (i) putc(',', stdout);
-                        fprintf(stdout, "%02X", ptr[i]);
-                    }
-                    break;
-            }
-
-            putc('\n', stdout);
-
-            previoushiveid = hiveid;
-            regkeyentry = ((void *)regkeyentry) + regkeyentry->DataLength + sizeof(CE_CAB_000_REGKEY_ENTRY) - sizeof(uint16_t);
+        if (wcecab_set_codepage(workers[i].doc, options->codepage) != WCECAB_OK) {
+            fprintf(stderr, "Error: unknown codepage: %s\n", options->codepage);
+            exit(EXIT_FAILURE);
         }
-
-    } else {
-        // Print output regularily
-
-        printf("appName: %s\n", appName);
-        printf("provider: %s\n", provider);
-
-        if (architecture) {
-            printf("architecture: %s\n", architecture);
+        if (options->stats && wcecab_enable_stats(workers[i].doc) != WCECAB_OK) {
+            perror("Failed to allocate statistics");
+            exit(EXIT_FAILURE);
+        }
+        if (tracing) {
+            workers[i].trace.tid = i + 1;
+            wcecab_set_phase_callback(workers[i].doc, trace_phase, &workers[i].trace);
         }
+    }
 
-        if (*unsupported) {
-            printf("unsupported: %s", unsupported[0]);
-            for (int i = 1; unsupported[i] && strlen(unsupported[i]); i++) {
-                printf(", %s", unsupported[i]);
+    if (options->jobs == 1) {
+        run_worker((void *)0);
+    } else {
+        for (int i = 0; i < options->jobs; i++) {
+            if (pthread_create(&workers[i].thread, NULL, run_worker, (void *)(intptr_t)i)) {
+                perror("Failed to create worker thread");
+                exit(EXIT_FAILURE);
             }
-            putc('\n', stdout);
         }
-        if (cabheader->MinCEVersionMajor) {
-            printf("minCeVersion: %d.%d\n", cabheader->MinCEVersionMajor, cabheader->MinCEVersionMinor);
-        }
-        if (cabheader->MaxCEVersionMajor) {
-            printf("maxCeVersion: %d.%d\n", cabheader->MaxCEVersionMajor, cabheader->MaxCEVersionMinor);
+        for (int i = 0; i < options->jobs; i++) {
+            pthread_join(workers[i].thread, NULL);
         }
-        if (cabheader->MinCEBuildNumber) {
-            printf("minCeBuildNumber: %d\n", cabheader->MinCEBuildNumber);
-        }
-        if (cabheader->MaxCEBuildNumber) {
-            printf("maxCeBuildNumber: %d\n", cabheader->MaxCEBuildNumber);
+    }
+
+    // Close the JSON array of batch mode
+    if (options->batch && options->printJson && !options->ndjson) {
+        outbuf_puts(&output, numrecords ? "\n]\n" : "[]\n");
+    }
+    // A .reg file without keys still has its header
+    if (options->printReg && !numrecords) {
+        outbuf_puts(&output, "REGEDIT4\n");
+    }
+    flush_output();
+
+    cache_stats cachestats;
+    bool cached = record_cache != NULL;
+    if (cached) {
+        uint64_t cachestart = trace_clock();
+        int status = cache_close(record_cache, &cachestats);
+        if (status != CACHE_OK) {
+            fprintf(stderr, "Warning: %s: %s\n", options->cacheDir, cache_strerror(status));
         }
+        trace_event("cache", cachestart);
     }
 
-#ifndef _WIN32
-    // Unmap input file. Will do nothing if input file is not actually
-    // memory mapped.
-    munmap(file, file_size);
-#endif
+    if (options->stats) {
+        print_stats(options, start, cached ? &cachestats : NULL);
+    }
+    if (tracing) {
+        write_trace(options);
+    }
+
+    for (int i = 0; i < options->jobs; i++) {
+        wcecab_free(workers[i].doc);
+        free(workers[i].out.data);
+        free(workers[i].cached.data);
+        free(workers[i].trace.events.data);
+        pthread_mutex_destroy(&workers[i].lock);
+    }
+    free(workers);
+    free(output.data);
+    free(main_trace.events.data);
+    for (size_t i = 0; i < numinputs; i++) {
+        free(inputs[i]);
+    }
+    free(inputs);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,589 @@
+#ifndef WCECABINFO_H
+#define WCECABINFO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "WinCECab000Header.h"
+
+/* Status codes returned by the wcecab functions */
+
+#define WCECAB_OK 0
+/** The input could not be read */
+#define WCECAB_ERR_IO 1
+/** The input is neither a CAB file nor a 000 file */
+#define WCECAB_ERR_FORMAT 2
+/** The 000 file could not be extracted from the CAB file */
+#define WCECAB_ERR_CAB 3
+/** The 000 file is truncated or its header is inconsistent */
+#define WCECAB_ERR_CORRUPT 4
+/** Memory allocation failed */
+#define WCECAB_ERR_NOMEM 5
+/** The codepage is not one of the built-in codepages */
+#define WCECAB_ERR_CODEPAGE 6
+
+/** Sections of a 000 file */
+typedef enum wcecab_section {
+    WCECAB_SECTION_STRINGS,
+    WCECAB_SECTION_DIRS,
+    WCECAB_SECTION_FILES,
+    WCECAB_SECTION_REGHIVES,
+    WCECAB_SECTION_REGKEYS,
+    WCECAB_SECTION_LINKS,
+} wcecab_section;
+
+/** Phases of processing a file, timed when statistics are enabled */
+typedef enum wcecab_phase {
+    /** Reading or mapping the input */
+    WCECAB_PHASE_LOAD,
+    /** Telling CAB files from 000 files, and parsing the CAB header to locate
+     * the 000 file in it */
+    WCECAB_PHASE_DETECT,
+    /** Extracting the 000 file from a CAB file */
+    WCECAB_PHASE_EXTRACT,
+    /** Decoding the sections into the document model, indexing the entries
+     * looked up by id on the way */
+    WCECAB_PHASE_DECODE,
+    /** Detecting the codepage of the strings */
+    WCECAB_PHASE_CODEPAGE,
+    /** Converting strings to UTF-8 */
+    WCECAB_PHASE_TRANSCODE,
+    WCECAB_NUM_PHASES
+} wcecab_phase;
+
+/**
+ * Function called at the end of every phase of a context, with the times the
+ * phase started and ended at. The times are read from the monotonic clock, in
+ * nanoseconds.
+ */
+typedef void (*wcecab_phase_callback)(void *userdata, wcecab_phase phase, uint64_t start_ns, uint64_t end_ns);
+
+/**
+ * Statistics of a context, summed up over all files opened with it since
+ * statistics were enabled. Times are in nanoseconds, CPU times are those of the
+ * calling thread.
+ */
+typedef struct wcecab_stats {
+    /** Wall time spent in each phase */
+    uint64_t wall_ns[WCECAB_NUM_PHASES];
+    /** CPU time spent in each phase */
+    uint64_t cpu_ns[WCECAB_NUM_PHASES];
+    /** Bytes of input read */
+    uint64_t bytes_read;
+    /** Bytes of 000 files extracted from CAB files */
+    uint64_t bytes_extracted;
+    /** Strings looked up by id */
+    uint64_t string_lookups;
+    /** Strings converted to UTF-8, not counting ASCII strings */
+    uint64_t transcodes;
+    /** Allocations from the arena of the context */
+    uint64_t allocations;
+    /** Blocks the arena allocated from the heap */
+    uint64_t arena_blocks;
+} wcecab_stats;
+
+/**
+ * A parsed 000 file. A context holds no state shared with other contexts, so
+ * different contexts can be used from different threads. Opening another file
+ * with the same context reuses its buffers.
+ */
+typedef struct wcecab wcecab;
+
+/**
+ * Iterator over the entries of a section. The entries are returned as pointers
+ * to the CE_CAB_000_*_ENTRY struct of the section.
+ */
+typedef struct wcecab_iter {
+    /** Section being iterated */
+    wcecab_section section;
+    /** Next entry */
+    const uint8_t *entry;
+    /** End of the 000 file */
+    const uint8_t *end;
+    /** Number of entries left */
+    int remaining;
+} wcecab_iter;
+
+/**
+ * Document model of an opened 000 file. Every section is decoded once when the
+ * file is opened into a table holding one array per field, so row i of each
+ * array describes the i-th entry of the section in file order. Strings and
+ * spec arrays are stored as byte offsets into the 000 file, see
+ * wcecab_model_at().
+ */
+typedef struct wcecab_string_table {
+    /** Number of rows */
+    uint32_t count;
+    /** String id */
+    const uint16_t *id;
+    /** File offset of the string */
+    const uint32_t *offset;
+    /** Length of the string in bytes, without the terminating 0 */
+    const uint16_t *length;
+} wcecab_string_table;
+
+typedef struct wcecab_dir_table {
+    /** Number of rows */
+    uint32_t count;
+    /** Directory id */
+    const uint16_t *id;
+    /** File offset of the spec array */
+    const uint32_t *spec;
+    /** Length of the spec array in bytes, including the terminating 0 */
+    const uint16_t *speclength;
+} wcecab_dir_table;
+
+typedef struct wcecab_file_table {
+    /** Number of rows */
+    uint32_t count;
+    /** File id */
+    const uint16_t *id;
+    /** Id of the directory the file is installed to */
+    const uint16_t *directory;
+    /** Flags, FlagsUpper in the upper and FlagsLower in the lower 16 bits */
+    const uint32_t *flags;
+    /** File offset of the file name */
+    const uint32_t *name;
+    /** Length of the file name in bytes, without the terminating 0 */
+    const uint16_t *namelength;
+} wcecab_file_table;
+
+typedef struct wcecab_hive_table {
+    /** Number of rows */
+    uint32_t count;
+    /** Hive id */
+    const uint16_t *id;
+    /** Root key, 1 to 4 */
+    const uint16_t *root;
+    /** File offset of the spec array */
+    const uint32_t *spec;
+    /** Length of the spec array in bytes, including the terminating 0 */
+    const uint16_t *speclength;
+} wcecab_hive_table;
+
+typedef struct wcecab_regkey_table {
+    /** Number of rows */
+    uint32_t count;
+    /** Registry entry id */
+    const uint16_t *id;
+    /** Id of the hive holding the value */
+    const uint16_t *hive;
+    /** Type flags, TypeFlagsUpper in the upper and TypeFlagsLower in the lower
+     * 16 bits */
+    const uint32_t *flags;
+    /** File offset of the value name, empty for the default value */
+    const uint32_t *name;
+    /** File offset of the value data, following the name */
+    const uint32_t *data;
+    /** Length of the value data in bytes */
+    const uint16_t *datalength;
+} wcecab_regkey_table;
+
+typedef struct wcecab_link_table {
+    /** Number of rows */
+    uint32_t count;
+    /** Link id */
+    const uint16_t *id;
+    /** Base directory id, see wcecab_basedir_name() */
+    const uint16_t *basedir;
+    /** Id of the file or directory the link points to */
+    const uint16_t *target;
+    /** Link type, non-zero if the target is a file */
+    const uint16_t *type;
+    /** File offset of the spec array */
+    const uint32_t *spec;
+    /** Length of the spec array in bytes, including the terminating 0 */
+    const uint16_t *speclength;
+} wcecab_link_table;
+
+typedef struct wcecab_model {
+    /** Contents of the 000 file */
+    const uint8_t *file;
+    /** Size of the 000 file */
+    size_t size;
+    wcecab_string_table strings;
+    wcecab_dir_table dirs;
+    wcecab_file_table files;
+    wcecab_hive_table hives;
+    wcecab_regkey_table regkeys;
+    wcecab_link_table links;
+} wcecab_model;
+
+/**
+ * @brief Get the data at an offset of the 000 file of a model
+ *
+ * @param model document model
+ * @param offset file offset, as stored in the tables
+ * @return const char* pointer into the 000 file
+ */
+static inline const char *wcecab_model_at(const wcecab_model *model, uint32_t offset) {
+    return (const char *)model->file + offset;
+}
+
+/**
+ * @brief Create a context
+ *
+ * @return wcecab* new context, or NULL if memory allocation failed
+ */
+wcecab *wcecab_new(void);
+
+/**
+ * @brief Release a context and everything opened with it
+ *
+ * @param doc context to release, may be NULL
+ */
+void wcecab_free(wcecab *doc);
+
+/**
+ * @brief Open a 000 file or CAB file held in memory
+ *
+ * The data is not copied, it has to stay valid until the context is closed.
+ *
+ * @param doc context
+ * @param data file contents
+ * @param size size of the file in bytes
+ * @return int WCECAB_OK on success, one of WCECAB_ERR_* otherwise
+ */
+int wcecab_open_buffer(wcecab *doc, const void *data, size_t size);
+
+/**
+ * @brief Open a 000 file or CAB file
+ *
+ * @param doc context
+ * @param path path of the file
+ * @return int WCECAB_OK on success, one of WCECAB_ERR_* otherwise
+ */
+int wcecab_open_path(wcecab *doc, const char *path);
+
+/**
+ * @brief Open a 000 file or CAB file read from a stream, e.g. stdin
+ *
+ * @param doc context
+ * @param stream stream to read until its end
+ * @return int WCECAB_OK on success, one of WCECAB_ERR_* otherwise
+ */
+int wcecab_open_stream(wcecab *doc, FILE *stream);
+
+/**
+ * @brief Close the file opened with a context, releasing all strings returned
+ * for it and all memory from wcecab_alloc(). The context itself can be used
+ * for another file.
+ *
+ * @param doc context
+ */
+void wcecab_close(wcecab *doc);
+
+/**
+ * @brief Allocate memory that lives as long as the open file
+ *
+ * The memory comes from the arena of the context, which also holds all paths
+ * and strings returned for the file. It can not be released on its own, all of
+ * it is released at once when the file is closed. The arena is kept for the
+ * next file, so a context that is reused for many files stops allocating once
+ * it has grown to the largest one.
+ *
+ * @param doc context
+ * @param size size in bytes
+ * @return void* memory aligned for any type, or NULL if memory allocation
+ * failed
+ */
+void *wcecab_alloc(wcecab *doc, size_t size);
+
+/**
+ * @brief Get a description of a status code
+ *
+ * @param status status code
+ * @return const char* description
+ */
+const char *wcecab_strerror(int status);
+
+/**
+ * @brief Start collecting statistics for a context
+ *
+ * Timing the phases adds two clock reads per phase, and per string that is
+ * converted to UTF-8. Without statistics enabled nothing is measured.
+ *
+ * @param doc context
+ * @return int WCECAB_OK on success, WCECAB_ERR_NOMEM if memory allocation
+ * failed
+ */
+int wcecab_enable_stats(wcecab *doc);
+
+/**
+ * @brief Get the statistics collected for a context
+ *
+ * @param doc context
+ * @return const wcecab_stats* statistics, or NULL if they are not enabled
+ */
+const wcecab_stats *wcecab_get_stats(const wcecab *doc);
+
+/**
+ * @brief Set a function to call at the end of every phase of a context, e.g.
+ * to trace the phases on a timeline
+ *
+ * The function is called on the thread using the context. It is called once
+ * per string that is converted to UTF-8, so it should be cheap.
+ *
+ * @param doc context
+ * @param callback function to call, NULL to stop calling it
+ * @param userdata passed to callback
+ */
+void wcecab_set_phase_callback(wcecab *doc, wcecab_phase_callback callback, void *userdata);
+
+/**
+ * @brief Get the name of a phase
+ *
+ * @param phase phase
+ * @return const char* name such as "extract"
+ */
+const char *wcecab_phase_name(wcecab_phase phase);
+
+/**
+ * @brief Get the detailed error message of the last failed open
+ *
+ * @param doc context
+ * @return const char* error message, empty if there was no error
+ */
+const char *wcecab_error(const wcecab *doc);
+
+/**
+ * @brief Check whether the opened file was a CAB file
+ *
+ * @param doc context
+ * @return bool true if the 000 file was extracted from a CAB file
+ */
+bool wcecab_is_cab(const wcecab *doc);
+
+/**
+ * @brief Get the header of the opened 000 file
+ *
+ * @param doc context
+ * @return const CE_CAB_000_HEADER* header
+ */
+const CE_CAB_000_HEADER *wcecab_header(const wcecab *doc);
+
+/**
+ * @brief Get the application name
+ *
+ * @param doc context
+ * @return const char* application name, in the codepage of the file
+ */
+const char *wcecab_app_name(const wcecab *doc);
+
+/**
+ * @brief Get the provider
+ *
+ * @param doc context
+ * @return const char* provider, in the codepage of the file
+ */
+const char *wcecab_provider(const wcecab *doc);
+
+/**
+ * @brief Get the list of unsupported platforms
+ *
+ * @param doc context
+ * @return const char** array of strings, terminated by a NULL pointer. The
+ * last string before the NULL pointer can be empty.
+ */
+const char **wcecab_unsupported(wcecab *doc);
+
+/**
+ * @brief Get the document model of the opened file
+ *
+ * @param doc context
+ * @return const wcecab_model* model, valid until the context is closed
+ */
+const wcecab_model *wcecab_get_model(const wcecab *doc);
+
+/**
+ * @brief Start iterating over the entries of a section
+ *
+ * @param doc context
+ * @param section section to iterate
+ * @param it iterator to initialize
+ */
+void wcecab_iter_init(const wcecab *doc, wcecab_section section, wcecab_iter *it);
+
+/**
+ * @brief Get the next entry of a section
+ *
+ * Iteration stops early at an entry that would reach past the end of the file.
+ *
+ * @param it iterator
+ * @return const void* pointer to the entry struct, NULL after the last entry
+ */
+const void *wcecab_iter_next(wcecab_iter *it);
+
+/**
+ * @brief Get the string with the specified id from the STRINGS section
+ *
+ * Strings are looked up in an index built when the file is opened, so a lookup
+ * takes constant time regardless of the number of strings.
+ *
+ * @param doc context
+ * @param stringid string id
+ * @return const char* the string, or NULL if there is no string with that id
+ */
+const char *wcecab_string(const wcecab *doc, uint16_t stringid);
+
+/**
+ * @brief Join the strings of a spec array, a list of 16-bit string ids
+ * terminated by 0, with backslashes
+ *
+ * @param doc context
+ * @param spec spec array
+ * @param speclength length of the spec array in bytes, including the
+ * terminating 0
+ * @return const char* joined path
+ */
+const char *wcecab_spec_path(wcecab *doc, const uint16_t *spec, uint16_t speclength);
+
+/**
+ * @brief Get the path of a directory
+ *
+ * The path of every directory is built once per file, later calls return the
+ * same string.
+ *
+ * @param doc context
+ * @param directoryid directory id
+ * @return const char* path, "unknown" if there is no directory with that id
+ */
+const char *wcecab_dir_path(wcecab *doc, uint16_t directoryid);
+
+/**
+ * @brief Get the name of a file
+ *
+ * @param doc context
+ * @param fileid file id
+ * @return const char* file name, or NULL if there is no file with that id
+ */
+const char *wcecab_file_name(const wcecab *doc, uint16_t fileid);
+
+/**
+ * @brief Get the full path of a file, its directory path and file name
+ *
+ * @param doc context
+ * @param fileid file id
+ * @return const char* path, or NULL if there is no file with that id
+ */
+const char *wcecab_file_path(wcecab *doc, uint16_t fileid);
+
+/**
+ * @brief Get the registry path of a hive, including the root key
+ *
+ * The path of every hive is built once per file, later calls return the same
+ * string.
+ *
+ * @param doc context
+ * @param hiveid hive id
+ * @return const char* path, or NULL if there is no hive with that id
+ */
+const char *wcecab_hive_path(wcecab *doc, uint16_t hiveid);
+
+/**
+ * @brief Get the path of a link, its base directory and link spec
+ *
+ * @param doc context
+ * @param link row of the link in the links table of the model
+ * @return const char* path
+ */
+const char *wcecab_link_path(wcecab *doc, uint32_t link);
+
+/**
+ * @brief Set the codepage strings are converted from, instead of detecting it
+ * per file
+ *
+ * The codepage is kept for all files opened with the context afterwards.
+ *
+ * @param doc context
+ * @param name codepage name such as "CP932" or "932", NULL to detect the
+ * codepage of every file again
+ * @return int WCECAB_OK, WCECAB_ERR_CODEPAGE if there is no built-in table for
+ * the codepage
+ */
+int wcecab_set_codepage(wcecab *doc, const char *name);
+
+/**
+ * @brief Get the codepage of the opened file
+ *
+ * Unless set with wcecab_set_codepage(), the codepage is detected once per
+ * file: the strings that are not plain ASCII in the STRINGS section, the app
+ * name and the provider are scored against all built-in codepages and the
+ * best scoring one is chosen. If those are all ASCII, file names and registry
+ * strings are scored instead. The codepage is settled before any string is
+ * converted, and does not change while the file is printed.
+ *
+ * @param doc context
+ * @return const char* codepage name such as "CP932", NULL if no codepage was
+ * set and all strings of the file are ASCII
+ */
+const char *wcecab_codepage(wcecab *doc);
+
+/**
+ * @brief Convert a string of the opened file to UTF-8
+ *
+ * Strings that are not plain ASCII are decoded in the codepage of the file,
+ * see wcecab_codepage(). If the file has none, as all of its strings are
+ * ASCII, a string from elsewhere is decoded in the codepage it scores best
+ * in. Sequences that are not valid in the codepage are replaced with U+FFFD.
+ *
+ * @param doc context
+ * @param str string to convert, or NULL, e.g. the path of a missing file
+ * @return const char* UTF-8 string, str itself if it was ASCII, NULL or memory
+ * for the converted string could not be allocated
+ */
+const char *wcecab_to_utf8(wcecab *doc, const char *str);
+
+/**
+ * @brief Convert a string of the opened file that does not have to be
+ * terminated to UTF-8
+ *
+ * Like wcecab_to_utf8(), but reads at most maxlen bytes of str, e.g. the
+ * length of a file name or the data length of a registry value, so a string
+ * at the end of the input is not read past it.
+ *
+ * @param doc context
+ * @param str string to convert, or NULL
+ * @param maxlen most bytes of the string, which ends earlier at a 0
+ * @return const char* terminated UTF-8 string, str itself if it was ASCII and
+ * terminated, NULL if str was NULL, "" or str if memory for the string could
+ * not be allocated
+ */
+const char *wcecab_to_utf8_bounded(wcecab *doc, const char *str, size_t maxlen);
+
+/**
+ * @brief Get the name of a target architecture
+ *
+ * @param archid architecture id
+ * @return const char* name such as "SH3", or NULL for an unknown id
+ */
+const char *wcecab_architecture_name(uint32_t archid);
+
+/**
+ * @brief Get the name of a registry root key
+ *
+ * @param hiveroot root id, 1 to 4
+ * @return const char* name such as "HKEY_LOCAL_MACHINE", or NULL for an
+ * invalid id
+ */
+const char *wcecab_hive_root_name(uint16_t hiveroot);
+
+/**
+ * @brief Get the name of a link base directory
+ *
+ * @param basedirid base directory id, 0 to 17
+ * @return const char* name such as "%CE1%", or NULL for an invalid id
+ */
+const char *wcecab_basedir_name(uint16_t basedirid);
+
+/**
+ * @brief Get the registry data type of a registry entry
+ *
+ * @param flags type flags of the entry
+ * @return const char* data type such as "REG_SZ"
+ */
+const char *wcecab_reg_datatype(uint32_t flags);
+
+#endif
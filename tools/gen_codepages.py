@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Generate src/codepage_tables.c, the transcoding tables of the codepages
+found in .000 files, from the codecs of Python.
+
+Every codepage gets a table of the characters of the bytes 0x80 to 0xFF.
+Double byte codepages additionally get one row of 191 characters, for the
+trail bytes 0x40 to 0xFE, per lead byte. All characters of these codepages
+are in the Basic Multilingual Plane, so they are stored as 16-bit values.
+
+Usage: tools/gen_codepages.py > src/codepage_tables.c
+"""
+
+CODEPAGES = [
+    # enum value, name, Python codec
+    ("CODEPAGE_932", "CP932", "cp932"),
+    ("CODEPAGE_1251", "CP1251", "cp1251"),
+    ("CODEPAGE_1252", "CP1252", "cp1252"),
+    ("CODEPAGE_936", "CP936", "cp936"),
+    ("CODEPAGE_949", "CP949", "cp949"),
+    ("CODEPAGE_950", "CP950", "cp950"),
+]
+
+# Characters the Python codecs leave out, but Windows defines
+EXTRA = {
+    "cp936": {b"\x80": 0x20AC},
+}
+
+TRAIL_MIN = 0x40
+TRAIL_MAX = 0xFE
+LEAD = 0xFFFF
+
+
+def decode(data, codec):
+    if data in EXTRA.get(codec, {}):
+        return EXTRA[codec][data]
+    try:
+        chars = data.decode(codec)
+    except UnicodeDecodeError:
+        return None
+    return ord(chars) if len(chars) == 1 else None
+
+
+def array(ctype, name, values):
+    lines = [f"static const {ctype} {name}[{len(values)}] = {{"]
+    for i in range(0, len(values), 16):
+        lines.append("    " + ", ".join(f"0x{v:04X}" if ctype == "uint16_t" else str(v) for v in values[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    print("/* Generated by tools/gen_codepages.py, do not edit */")
+    print()
+    print('#include "codepage.h"')
+    tables = []
+    for enum, name, codec in CODEPAGES:
+        prefix = name.lower()
+        high = []
+        rows = []
+        dbcs = []
+        for byte in range(0x80, 0x100):
+            row = [decode(bytes([byte, trail]), codec) or 0 for trail in range(TRAIL_MIN, TRAIL_MAX + 1)]
+            single = decode(bytes([byte]), codec)
+            if single is None and any(row):
+                high.append(LEAD)
+                dbcs.extend(row)
+                rows.append(len(dbcs) // len(row))
+            else:
+                high.append(single or 0)
+                rows.append(0)
+        print()
+        print(array("uint16_t", f"{prefix}_high", high))
+        if dbcs:
+            print()
+            print(array("uint8_t", f"{prefix}_rows", rows))
+            print()
+            print(array("uint16_t", f"{prefix}_dbcs", dbcs))
+            tables.append((enum, name, f"{prefix}_high", f"{prefix}_rows", f"{prefix}_dbcs"))
+        else:
+            tables.append((enum, name, f"{prefix}_high", "NULL", "NULL"))
+    print()
+    print("const codepage_table CODEPAGE_TABLES[NUM_CODEPAGES] = {")
+    for enum, name, high, rows, dbcs in tables:
+        print(f'    [{enum}] = {{"{name}", {high}, {rows}, {dbcs}}},')
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,2 @@
+export const WinCECodepages = ["CP932", "CP1251", "CP1252", "CP936", "CP949", "CP950"] as const;
+export type WinCECodepage = typeof WinCECodepages[number];
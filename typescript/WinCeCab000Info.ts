@@ -1,4 +1,5 @@
 import { WinCEArchitecture } from "./WinCEArchitecture";
+import { WinCECodepage } from "./WinCECodepage";
 
 export type unsupported = "PALM-SIZE PC" | "HPC" | "PALM PC" | "PALM PC2" | "POCKETPC" | "JUPITER";
 
@@ -69,8 +70,12 @@ export const DIRECTORY_MAPPINGS_PPC: WindowsCeCab000DirectoryMappings = {
 };
 
 export type WinCeCab000Header = {
+    /** Input path, only present in batch mode */
+    file?: string;
     appName: string;
     provider: string;
+    /** Codepage the strings were decoded from, null if all strings are ASCII */
+    codepage: WinCECodepage | null;
     architecture: WinCEArchitecture | null;
     unsupported?: string[];
 
@@ -135,4 +140,13 @@ export type WinCeCab000Header = {
         targetPath: string;
     }[];
 
-};
\ No newline at end of file
+};
+
+/** Record of an input that could not be processed in batch mode */
+export type WinCeCab000Error = {
+    file: string;
+    error: string;
+};
+
+/** Output of a batch run, one element per input */
+export type WinCeCab000Batch = (WinCeCab000Header | WinCeCab000Error)[];